@@ -0,0 +1,86 @@
+// Settings for the benchmarks and tests. They link the components they
+// exercise but not the real ConfigManager, which brings in the
+// application's logger.
+// This keeps the same interface over an in-memory table: a program sets
+// what it wants with setValue(), and every other key reads as unset, so
+// components fall back to their defaults.
+
+#include "config/ConfigManager.hpp"
+
+#include <string>
+
+ConfigManager& ConfigManager::getInstance() {
+    static ConfigManager instance;
+    return instance;
+}
+
+void ConfigManager::setValue(const std::string& section, const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    raw_data_[section][key] = value;
+}
+
+void ConfigManager::setValue(const std::string& section, const std::string& key, int value) {
+    setValue(section, key, std::to_string(value));
+}
+
+void ConfigManager::setValue(const std::string& section, const std::string& key, bool value) {
+    setValue(section, key, std::string(value ? "true" : "false"));
+}
+
+std::optional<std::string> ConfigManager::getRawString(const std::string& section,
+                                                       const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = raw_data_.find(section);
+    if (found == raw_data_.end()) {
+        return std::nullopt;
+    }
+    const auto value = found->second.find(key);
+    if (value == found->second.end()) {
+        return std::nullopt;
+    }
+    return value->second;
+}
+
+std::optional<std::string> ConfigManager::getString(const std::string& section, const std::string& key) const {
+    return getRawString(section, key);
+}
+
+std::optional<int> ConfigManager::getInt(const std::string& section, const std::string& key) const {
+    const auto value = getRawString(section, key);
+    if (!value) {
+        return std::nullopt;
+    }
+    try {
+        size_t used = 0;
+        const int number = std::stoi(*value, &used);
+        return used == value->size() ? std::optional<int>(number) : std::nullopt;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::optional<bool> ConfigManager::getBool(const std::string& section, const std::string& key) const {
+    const auto value = getRawString(section, key);
+    if (!value) {
+        return std::nullopt;
+    }
+    if (*value == "true") {
+        return true;
+    }
+    if (*value == "false") {
+        return false;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> ConfigManager::getKeys(const std::string& section) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> keys;
+    const auto found = raw_data_.find(section);
+    if (found != raw_data_.end()) {
+        for (const auto& [key, value] : found->second) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
@@ -0,0 +1,202 @@
+// Heap allocations and time per packet along the path a stored packet
+// takes, on one thread: the capture side copies each frame into a Packet,
+// which moves through the analysis ring and the store ring to the writer,
+// which takes batches of DataStore::BATCH_SIZE and drops them where the
+// real one inserts them. Frames are a mix of sizes from 64 to 1514 bytes
+// and the capture profile keeps them whole. Runs once with a PacketPool,
+// as capture workers use, and once allocating every packet.
+//
+//   pipeline_allocations [--packets 1000000] [--pool 8192] [--ring 8192]
+//
+// Allocations are counted by replacing the global operator new, so they
+// include every container the pipeline touches, not only the packets.
+
+#include "core/CaptureProfile.hpp"
+#include "protocols/Packet.hpp"
+#include "protocols/PacketPool.hpp"
+#include "protocols/PacketView.hpp"
+#include "utils/MpscRing.hpp"
+#include "utils/SpscRing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Same as DataStore's
+constexpr size_t WRITER_BATCH = 1000;
+
+struct Options {
+    uint64_t packets = 1000000;
+    size_t pool = 8192;
+    size_t ring = 8192;
+};
+
+struct Result {
+    double allocations_per_packet = 0.0;
+    double nanoseconds_per_packet = 0.0;
+    uint64_t pool_hits = 0;
+    uint64_t pool_misses = 0;
+};
+
+// UDP frames of the sizes in a typical mix: mostly small and full-sized,
+// some in between
+std::vector<std::vector<uint8_t>> buildFrames() {
+    const size_t sizes[] = {64, 64, 64, 128, 256, 576, 1024, 1514, 1514, 1514};
+    std::vector<std::vector<uint8_t>> frames;
+    for (size_t i = 0; i < 64; ++i) {
+        std::vector<uint8_t> frame(sizes[i % std::size(sizes)], 0);
+        frame[12] = 0x08;
+        uint8_t* ip = frame.data() + 14;
+        const size_t ip_length = frame.size() - 14;
+        ip[0] = 0x45;
+        ip[2] = static_cast<uint8_t>(ip_length >> 8);
+        ip[3] = static_cast<uint8_t>(ip_length);
+        ip[8] = 64;
+        ip[9] = 17;
+        ip[12] = 10;
+        ip[15] = static_cast<uint8_t>(i);
+        ip[16] = 10;
+        ip[19] = 200;
+        uint8_t* udp = ip + 20;
+        udp[0] = 0xc0;
+        udp[1] = static_cast<uint8_t>(i);
+        udp[3] = 53;
+        udp[4] = static_cast<uint8_t>((ip_length - 20) >> 8);
+        udp[5] = static_cast<uint8_t>(ip_length - 20);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+Result run(const Options& options, bool pooled) {
+    const std::vector<std::vector<uint8_t>> frames = buildFrames();
+    const CaptureProfile profile;
+    auto pool = pooled ? std::make_unique<PacketPool>(options.pool) : nullptr;
+    SpscRing<Packet> analysis(options.ring);
+    MpscRing<Packet> store(options.ring);
+    std::vector<Packet> batch;
+    batch.reserve(WRITER_BATCH);
+
+    // Analysis thread: hands every queued packet on to the store
+    auto analyze = [&] {
+        while (auto packet = analysis.tryPop()) {
+            store.tryPush(std::move(*packet));
+        }
+    };
+    // Writer: a full batch is written and dropped
+    auto write = [&] {
+        while (auto packet = store.tryPop()) {
+            batch.push_back(std::move(*packet));
+            if (batch.size() == WRITER_BATCH) {
+                batch.clear();
+            }
+        }
+    };
+
+    const auto now = std::chrono::system_clock::now();
+    const uint64_t allocated = allocations.load();
+    const auto began = Clock::now();
+    for (uint64_t i = 0; i < options.packets; ++i) {
+        const std::vector<uint8_t>& frame = frames[i % frames.size()];
+        const PacketView view(frame.data(), frame.size(), frame.size(), now);
+        Packet packet = pool ? pool->acquire() : Packet();
+        packet.assign(view, &profile);
+        analysis.tryPush(std::move(packet));
+        // The other stages run as often as a poll on another thread would
+        // find work, so each ring holds up to a capture batch
+        if (i % 64 == 63) {
+            analyze();
+            write();
+        }
+    }
+    analyze();
+    write();
+    batch.clear();
+    const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - began).count();
+
+    Result result;
+    result.allocations_per_packet =
+        static_cast<double>(allocations.load() - allocated) / static_cast<double>(options.packets);
+    result.nanoseconds_per_packet = elapsed / static_cast<double>(options.packets);
+    if (pool) {
+        result.pool_hits = pool->getHits();
+        result.pool_misses = pool->getMisses();
+    }
+    return result;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string name = argv[i];
+        const long long value = std::atoll(argv[i + 1]);
+        if (value < 1) {
+            return false;
+        }
+        if (name == "--packets") {
+            options.packets = static_cast<uint64_t>(value);
+        } else if (name == "--pool") {
+            options.pool = static_cast<size_t>(value);
+        } else if (name == "--ring") {
+            options.ring = static_cast<size_t>(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--packets N] [--pool N] [--ring N]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%llu packets, rings of %zu, writer batches of %zu\n",
+                static_cast<unsigned long long>(options.packets), options.ring, WRITER_BATCH);
+    std::printf("            allocs/pkt   ns/pkt  pool hits\n");
+    for (const bool pooled : {false, true}) {
+        const Result result = run(options, pooled);
+        std::printf("%-10s  %10.3f  %7.0f", pooled ? "pool" : "no pool", result.allocations_per_packet,
+                    result.nanoseconds_per_packet);
+        if (const uint64_t acquired = result.pool_hits + result.pool_misses) {
+            std::printf("  %.1f%%", static_cast<double>(result.pool_hits) * 100.0 / static_cast<double>(acquired));
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
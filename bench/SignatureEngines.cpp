@@ -0,0 +1,167 @@
+// Scan throughput of each PatternMatcher engine against growing sets of
+// strings, on synthetic payloads of printable text where few of the
+// strings occur. Every engine's answer for every payload is checked
+// against the memmem reference, so the benchmark also catches an engine
+// that disagrees.
+//
+//   signature_engines [--strings 8,32,64,128,512] [--payloads 20000] [--seconds 1]
+//
+// This measures the matchers alone. For real traffic, replay a capture
+// with [analysis] signature_engine = memmem and then auto, and compare the
+// streams stage in the replay report.
+
+#include "protocols/PatternMatcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<size_t> strings{8, 32, 64, 128, 512};
+    size_t payloads = 20000;
+    double seconds = 1.0;
+};
+
+// Words and separators of the kind HTTP headers and text bodies hold, so
+// strings drawn from the same alphabet share prefixes with the payload
+std::string randomText(std::mt19937& random, size_t length) {
+    static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz0123456789 /:.-";
+    std::uniform_int_distribution<size_t> pick(0, sizeof(ALPHABET) - 2);
+    std::string text(length, ' ');
+    for (char& c : text) {
+        c = ALPHABET[pick(random)];
+    }
+    return text;
+}
+
+std::vector<std::vector<uint8_t>> buildPayloads(size_t count) {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<size_t> length(64, 1460);
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string text = randomText(random, length(random));
+        payloads.emplace_back(text.begin(), text.end());
+    }
+    return payloads;
+}
+
+// Unanchored strings of 6 to 12 bytes; a few are planted in the payloads
+std::vector<PatternMatcher::Pattern> buildPatterns(size_t count, std::vector<std::vector<uint8_t>>& payloads) {
+    std::mt19937 random(static_cast<unsigned>(count));
+    std::uniform_int_distribution<size_t> length(6, 12);
+    std::vector<PatternMatcher::Pattern> patterns;
+    for (size_t i = 0; i < count; ++i) {
+        patterns.push_back({randomText(random, length(random)), false});
+    }
+    for (size_t i = 0; i < payloads.size(); i += 100) {
+        const std::string& bytes = patterns[i % count].bytes;
+        std::vector<uint8_t>& payload = payloads[i];
+        std::copy(bytes.begin(), bytes.end(), payload.begin() + static_cast<long>(payload.size() / 2));
+    }
+    return patterns;
+}
+
+// Megabytes scanned per second, and how many payloads got a different
+// answer from expected
+double measure(const PatternMatcher& matcher, const std::vector<std::vector<uint8_t>>& payloads,
+               const std::vector<size_t>& expected, double seconds, size_t& mismatches) {
+    mismatches = 0;
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        if (matcher.find(payloads[i]) != expected[i]) {
+            ++mismatches;
+        }
+    }
+
+    size_t bytes = 0;
+    size_t found = 0;
+    const auto began = Clock::now();
+    double elapsed = 0.0;
+    do {
+        for (const auto& payload : payloads) {
+            found += matcher.find(payload) != PatternMatcher::NO_MATCH;
+            bytes += payload.size();
+        }
+        elapsed = std::chrono::duration<double>(Clock::now() - began).count();
+    } while (elapsed < seconds);
+    volatile size_t keep = found;
+    (void)keep;
+    return static_cast<double>(bytes) / elapsed / 1e6;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--strings") {
+            options.strings.clear();
+            std::stringstream list(value);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                options.strings.push_back(static_cast<size_t>(std::max(1, std::atoi(count.c_str()))));
+            }
+        } else if (name == "--payloads") {
+            options.payloads = static_cast<size_t>(std::max(1, std::atoi(value)));
+        } else if (name == "--seconds") {
+            options.seconds = std::atof(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && !options.strings.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--strings 8,32,64,128,512] [--payloads N] [--seconds S]\n", argv[0]);
+        return 1;
+    }
+
+    const PatternMatcher::Engine engines[] = {
+        PatternMatcher::Engine::MEMMEM, PatternMatcher::Engine::AHO_CORASICK, PatternMatcher::Engine::TEDDY};
+    std::printf("%zu payloads of 64 to 1460 bytes, MB/s\n", options.payloads);
+    std::printf("strings");
+    for (const auto engine : engines) {
+        const PatternMatcher matcher({{"x", false}}, engine);
+        std::printf("  %14s", matcher.getEngine());
+    }
+    std::printf("\n");
+
+    int status = 0;
+    for (const size_t count : options.strings) {
+        std::vector<std::vector<uint8_t>> payloads = buildPayloads(options.payloads);
+        const std::vector<PatternMatcher::Pattern> patterns = buildPatterns(count, payloads);
+
+        const PatternMatcher reference(patterns, PatternMatcher::Engine::MEMMEM);
+        std::vector<size_t> expected;
+        for (const auto& payload : payloads) {
+            expected.push_back(reference.find(payload));
+        }
+
+        std::printf("%7zu", count);
+        for (const auto engine : engines) {
+            const PatternMatcher matcher(patterns, engine);
+            size_t mismatches = 0;
+            const double rate = measure(matcher, payloads, expected, options.seconds, mismatches);
+            std::printf("  %14.0f", rate);
+            if (mismatches != 0) {
+                std::printf(" (%zu wrong)", mismatches);
+                status = 1;
+            }
+        }
+        std::printf("\n");
+    }
+    return status;
+}
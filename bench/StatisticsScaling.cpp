@@ -0,0 +1,249 @@
+// How statistics counting scales with capture workers. Each worker thread
+// counts synthetic TCP packets over its own set of flows into a
+// StatisticsShard, as a capture thread does, while a reader refreshes a
+// merged view the way the GUI does. Reports packets per second, the
+// capture thread's CPU time per packet (which includes publishing) and the
+// CPU time each refresh took. Times are per thread, so they stay meaningful
+// with more threads than cores.
+//
+//   statistics_scaling [--threads 1,2,4,8,16] [--flows 100000] [--seconds 3]
+//                      [--interval 1000] [--poll 100] [--snapshot 1000]
+//
+// --flows is per worker. --snapshot 0 publishes every connection and host.
+
+#include "analysis/Statistics.hpp"
+#include "analysis/StatisticsShard.hpp"
+#include "protocols/PacketView.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// CPU time the calling thread has used
+double threadNanoseconds() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1e9 + static_cast<double>(now.tv_nsec);
+}
+
+struct Options {
+    std::vector<int> threads{1, 2, 4, 8, 16};
+    uint32_t flows = 100000;
+    double seconds = 3.0;
+    int interval_ms = 1000;
+    int poll_ms = 100;
+    size_t snapshot = 1000;
+};
+
+struct Result {
+    double packets_per_second = 0.0;
+    double nanoseconds_per_packet = 0.0;
+    uint64_t refreshes = 0;
+    double refresh_mean_ms = 0.0;
+    double refresh_max_ms = 0.0;
+};
+
+// Ethernet, IPv4 and TCP headers followed by 200 bytes of payload. Only
+// the addresses and ports change per packet.
+constexpr size_t FRAME_SIZE = 14 + 20 + 20 + 200;
+
+void buildFrame(uint8_t* frame) {
+    std::memset(frame, 0, FRAME_SIZE);
+    frame[12] = 0x08;
+    uint8_t* ip = frame + 14;
+    ip[0] = 0x45;
+    ip[2] = static_cast<uint8_t>((FRAME_SIZE - 14) >> 8);
+    ip[3] = static_cast<uint8_t>(FRAME_SIZE - 14);
+    ip[8] = 64;
+    ip[9] = 6;
+    uint8_t* tcp = ip + 20;
+    tcp[12] = 0x50;
+    tcp[13] = 0x18;
+}
+
+// Flow number flow of worker, spread over many client addresses and 64
+// servers so the host table grows too
+void setFlow(uint8_t* frame, uint32_t worker, uint32_t flow, uint32_t sequence) {
+    uint8_t* ip = frame + 14;
+    const uint32_t client = 0x0a000000 | (worker << 16) | (flow & 0xffff);
+    const uint32_t server = 0xc0a80001 + (flow & 63);
+    const uint16_t port = static_cast<uint16_t>(1024 + (flow >> 16));
+    for (int i = 0; i < 4; ++i) {
+        ip[12 + i] = static_cast<uint8_t>(client >> (24 - 8 * i));
+        ip[16 + i] = static_cast<uint8_t>(server >> (24 - 8 * i));
+    }
+    uint8_t* tcp = ip + 20;
+    tcp[0] = static_cast<uint8_t>(port >> 8);
+    tcp[1] = static_cast<uint8_t>(port);
+    tcp[2] = 443 >> 8;
+    tcp[3] = 443 & 0xff;
+    for (int i = 0; i < 4; ++i) {
+        tcp[4 + i] = static_cast<uint8_t>(sequence >> (24 - 8 * i));
+    }
+}
+
+Result run(const Options& options, int threads) {
+    std::vector<std::unique_ptr<StatisticsShard>> shards;
+    for (int i = 0; i < threads; ++i) {
+        shards.push_back(std::make_unique<StatisticsShard>(std::chrono::milliseconds(options.interval_ms)));
+        shards.back()->setSnapshotEntries(options.snapshot);
+        shards.back()->getWorkingCopy().setChecksumValidation(false);
+    }
+
+    std::atomic<bool> start{false};
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> counts(static_cast<size_t>(threads));
+    std::vector<double> cpu(static_cast<size_t>(threads));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] {
+            uint8_t frame[FRAME_SIZE];
+            buildFrame(frame);
+            StatisticsShard& shard = *shards[static_cast<size_t>(i)];
+            Statistics& statistics = shard.getWorkingCopy();
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            const double began = threadNanoseconds();
+            uint64_t packets = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto now = std::chrono::system_clock::now();
+                for (int batch = 0; batch < 64; ++batch, ++packets) {
+                    setFlow(frame, static_cast<uint32_t>(i), static_cast<uint32_t>(packets % options.flows),
+                            static_cast<uint32_t>(packets * 200));
+                    statistics.update(PacketView(frame, FRAME_SIZE, FRAME_SIZE, now));
+                }
+                shard.tick(Clock::now());
+            }
+            counts[static_cast<size_t>(i)] = packets;
+            cpu[static_cast<size_t>(i)] = threadNanoseconds() - began;
+        });
+    }
+
+    // What NetworkMonitor::getStatistics() and a GUI refresh do
+    Result result;
+    double refresh_total_ms = 0.0;
+    std::thread reader([&] {
+        std::shared_ptr<const Statistics> merged;
+        uint64_t merged_generation = UINT64_MAX;
+        while (!start.load()) {
+            std::this_thread::yield();
+        }
+        auto next = Clock::now();
+        for (;;) {
+            next += std::chrono::milliseconds(options.poll_ms);
+            std::this_thread::sleep_until(next);
+            if (stop.load()) {
+                break;
+            }
+            const double began = threadNanoseconds();
+            uint64_t generation = 0;
+            for (const auto& shard : shards) {
+                generation += shard->getGeneration();
+            }
+            if (!merged || generation != merged_generation) {
+                auto statistics = std::make_shared<Statistics>();
+                for (const auto& shard : shards) {
+                    statistics->merge(*shard->getSnapshot());
+                }
+                merged = statistics;
+                merged_generation = generation;
+            }
+            volatile size_t shown = merged->getTopConnections(10).size() + merged->getTopHosts(10).size();
+            (void)shown;
+            const double elapsed = (threadNanoseconds() - began) / 1e6;
+            refresh_total_ms += elapsed;
+            result.refresh_max_ms = std::max(result.refresh_max_ms, elapsed);
+            ++result.refreshes;
+        }
+    });
+
+    const auto began = Clock::now();
+    start = true;
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    stop = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    reader.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - began).count();
+
+    uint64_t packets = 0;
+    double packets_cpu = 0.0;
+    for (int i = 0; i < threads; ++i) {
+        packets += counts[static_cast<size_t>(i)];
+        packets_cpu += cpu[static_cast<size_t>(i)];
+    }
+    result.packets_per_second = static_cast<double>(packets) / elapsed;
+    result.nanoseconds_per_packet = packets_cpu / static_cast<double>(std::max<uint64_t>(packets, 1));
+    result.refresh_mean_ms = result.refreshes ? refresh_total_ms / static_cast<double>(result.refreshes) : 0.0;
+    return result;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--threads") {
+            options.threads.clear();
+            std::stringstream list(value);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                options.threads.push_back(std::max(1, std::atoi(count.c_str())));
+            }
+        } else if (name == "--flows") {
+            options.flows = static_cast<uint32_t>(std::max(1, std::atoi(value)));
+        } else if (name == "--seconds") {
+            options.seconds = std::atof(value);
+        } else if (name == "--interval") {
+            options.interval_ms = std::max(1, std::atoi(value));
+        } else if (name == "--poll") {
+            options.poll_ms = std::max(1, std::atoi(value));
+        } else if (name == "--snapshot") {
+            options.snapshot = static_cast<size_t>(std::max(0, std::atoi(value)));
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && !options.threads.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--threads 1,2,4,8,16] [--flows N] [--seconds S] "
+                             "[--interval MS] [--poll MS] [--snapshot N]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%u flows per worker, publish every %d ms, refresh every %d ms, %zu hardware threads\n",
+                options.flows, options.interval_ms, options.poll_ms,
+                static_cast<size_t>(std::thread::hardware_concurrency()));
+    std::printf("threads      Mpps   ns/pkt  refreshes  refresh CPU ms (mean / max)\n");
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    for (int threads : options.threads) {
+        const Result result = run(options, threads);
+        // Workers and the reader share the cores beyond this point, so
+        // packets per second shows time-slicing rather than scaling
+        std::printf("%7d  %8.2f  %7.0f  %9llu  %8.2f / %.2f%s\n", threads, result.packets_per_second / 1e6,
+                    result.nanoseconds_per_packet, static_cast<unsigned long long>(result.refreshes),
+                    result.refresh_mean_ms, result.refresh_max_ms,
+                    cores > 0 && threads + 1 > cores ? "  (more threads than cores)" : "");
+    }
+    return 0;
+}
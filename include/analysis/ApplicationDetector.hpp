@@ -0,0 +1,16 @@
+#pragma once
+
+#include "analysis/StreamAnalyzer.hpp"
+
+// Names a connection's application protocol from the first bytes either
+// side sends: an HTTP/1.x request or status line, the HTTP/2 preface, or a
+// TLS handshake record (HTTPS on port 443, TLS elsewhere). Whatever it
+// finds replaces the port-based guess for the rest of the connection.
+class ApplicationDetector : public StreamAnalyzer {
+public:
+    Verdict onData(TcpFlow& flow, StreamDirection direction,
+                   std::span<const uint8_t> stream, size_t fresh) override;
+
+    // Longest request or status line waited for before giving up
+    static constexpr size_t MAX_LINE = 2048;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "analysis/StreamAnalyzer.hpp"
+
+// Keeps the server name (SNI) and ALPN protocol of the ClientHello that
+// opens a TLS connection on its flow, so HTTPS traffic can be accounted
+// per service without decoding anything past the handshake. Only the
+// client's first bytes are read, and only until the ClientHello is
+// complete. An ALPN of h2 or http/1.1 also turns TLS on a port other than
+// 443 into HTTPS.
+class ClientHelloAnalyzer : public StreamAnalyzer {
+public:
+    Verdict onData(TcpFlow& flow, StreamDirection direction,
+                   std::span<const uint8_t> stream, size_t fresh) override;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "analysis/StreamAnalyzer.hpp"
+#include "protocols/PatternMatcher.hpp"
+
+// Labels a connection with the first payload signature found in the first
+// signature_depth bytes of either direction. Signatures come from the
+// [signatures] section of the config: each key is a label and each value a
+// comma-separated list of byte strings, any of which marks the label. A
+// label that names an application protocol (HTTP, HTTPS, TLS, DNS, DHCP)
+// also sets the connection's protocol if nothing else has.
+//
+// Only the bytes added since the last call are searched, plus enough
+// before them to catch a string that straddles the two.
+class SignatureAnalyzer : public StreamAnalyzer {
+public:
+    // Built once from the config and shared by every worker's analyzer
+    struct Signatures {
+        PatternMatcher matcher;
+        std::vector<std::string> labels;            // By pattern index
+        std::vector<Packet::Protocol> protocols;    // By pattern index; UNKNOWN unless the label names one
+        size_t depth;                               // Stream bytes searched per direction
+
+        Signatures(std::vector<PatternMatcher::Pattern> patterns, PatternMatcher::Engine engine)
+            : matcher(std::move(patterns), engine) {}
+    };
+
+    explicit SignatureAnalyzer(std::shared_ptr<const Signatures> signatures);
+
+    // Reads [signatures] and the [analysis] signature_engine and
+    // signature_depth keys. Null when there are no signatures. Throws
+    // std::runtime_error for a malformed string or an unknown engine.
+    static std::shared_ptr<const Signatures> fromConfig();
+
+    // One byte string. A leading ^ anchors it at the start of the stream.
+    // \xNN, \\, \, and \^ stand for bytes, and surrounding spaces are
+    // trimmed, so write a space at either end as \x20.
+    static PatternMatcher::Pattern parsePattern(std::string_view text);
+
+    Verdict onData(TcpFlow& flow, StreamDirection direction,
+                   std::span<const uint8_t> stream, size_t fresh) override;
+
+private:
+    std::shared_ptr<const Signatures> signatures_;
+};
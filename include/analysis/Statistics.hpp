@@ -1,46 +1,171 @@
 #pragma once
 
+#include <array>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <functional>
 #include <chrono>
 #include <mutex>
 #include <atomic>
 #include <vector>
+#include "analysis/TcpAnalyzer.hpp"
+#include "protocols/FlowKey.hpp"
+#include "protocols/IpAddress.hpp"
 #include "protocols/Packet.hpp"
+#include "protocols/PacketView.hpp"
+#include "utils/FlowTable.hpp"
+#include "utils/TimeSeries.hpp"
+#include "utils/TimerWheel.hpp"
 
+// Per-entry counters are only modified under Statistics::mutex_, or by the
+// one thread that owns an unlocked instance, so they are plain integers;
+// this keeps the entries copyable for snapshots and merging.
 struct ProtocolStats {
-    std::atomic<uint64_t> packet_count{0};
-    std::atomic<uint64_t> byte_count{0};
-    std::atomic<uint64_t> error_count{0};
+    uint64_t packet_count = 0;
+    uint64_t byte_count = 0;
+    uint64_t error_count = 0;
     std::chrono::system_clock::time_point first_seen;
     std::chrono::system_clock::time_point last_seen;
 };
 
+// Totals per capture interface
+using InterfaceStats = ProtocolStats;
+
+// String-keyed map that can be probed with a std::string_view, so updating
+// an entry that already exists doesn't build a std::string
+struct StringKeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+};
+template <typename T>
+using StringKeyMap = std::unordered_map<std::string, T, StringKeyHash, std::equal_to<>>;
+
 struct HostStats {
-    std::atomic<uint64_t> packet_count{0};
-    std::atomic<uint64_t> byte_count{0};
+    uint64_t packet_count = 0;
+    uint64_t byte_count = 0;
     std::unordered_map<Packet::Protocol, ProtocolStats> protocol_stats;
+    uint64_t interfaces = 0;               // Bit per Statistics::getInterfaceNames()
     std::chrono::system_clock::time_point first_seen;
     std::chrono::system_clock::time_point last_seen;
 };
 
 struct ConnectionStats {
-    std::atomic<uint64_t> packet_count{0};
-    std::atomic<uint64_t> byte_count{0};
-    std::atomic<uint64_t> retransmission_count{0};
+    uint64_t packet_count = 0;
+    uint64_t byte_count = 0;
+    uint64_t interfaces = 0;               // Bit per Statistics::getInterfaceNames(); both halves
+                                           // of a flow can arrive on different SPAN ports
     std::chrono::system_clock::time_point start_time;
     std::chrono::system_clock::time_point last_seen;
-    bool is_active;
+    TcpAnalyzer tcp;                       // Round trip, retransmissions and the like; TCP only
+    bool is_active = false;
+};
+
+// A connection that has ended, as handed to the flow record handler
+struct FlowRecord {
+    FlowKey connection;
+    ConnectionStats stats;
+    std::vector<std::string> interfaces;   // Names of the bits set in stats.interfaces
+};
+
+// DNS lookups answered by one resolver, as DnsTracker timed them. Latency
+// is kept as a histogram whose buckets double from LATENCY_BASE, the last
+// one open-ended, so percentiles are read to within a factor of two.
+struct DnsResolverStats {
+    static constexpr size_t LATENCY_BUCKETS = 16;
+    static constexpr std::chrono::microseconds LATENCY_BASE{125};
+
+    uint64_t queries = 0;
+    uint64_t responses = 0;
+    uint64_t timeouts = 0;          // Queries left unanswered
+    std::array<uint64_t, 16> rcodes{};                  // Responses by RCODE
+    std::array<uint64_t, LATENCY_BUCKETS> latency{};    // Responses by latency bucket
+    std::chrono::nanoseconds total_latency{0};
+    std::chrono::nanoseconds max_latency{0};
+    std::chrono::system_clock::time_point last_seen;
+
+    // Upper bound of the given bucket; the last has none and reports its
+    // lower bound
+    static std::chrono::microseconds getBucketLimit(size_t bucket);
+    static size_t getBucket(std::chrono::nanoseconds latency);
+
+    // Latency that fraction (0-1) of responses came within, to the bucket
+    std::chrono::microseconds getLatencyPercentile(double fraction) const;
+    std::chrono::nanoseconds getMeanLatency() const;
 };
 
 class Statistics {
 public:
     Statistics();
+    // A copy is a snapshot: it keeps the connections but not their expiry
+    // timers or the flow record handler
+    Statistics(const Statistics& other);
+    Statistics& operator=(const Statistics& other);
     ~Statistics() = default;
 
-    void update(const Packet& packet);
+    // Copies other like operator=, but keeps only its entries busiest
+    // connections and hosts by packet count, so a snapshot costs the same
+    // however many are open. getConnectionCount() still counts the
+    // connections left out.
+    void assignSnapshot(const Statistics& other, size_t entries);
+
+    // weight is the number of packets this one stands for under flow
+    // sampling. Aggregate counters are scaled by it; a sampled connection is
+    // seen in full, so its own counters are not. Only allocates when a new
+    // protocol, interface, host or connection shows up.
+    void update(const PacketView& packet, uint32_t weight = 1);
+    void update(const Packet& packet, uint32_t weight = 1);
+
+    // How deep update() decodes packets. NETWORK counts totals, interfaces,
+    // hosts and L3 protocols without touching transport headers; TRANSPORT
+    // adds connections and TCP/UDP/ICMP; APPLICATION (the default) adds
+    // port-based protocols such as HTTP and DNS.
+    void setDepth(PacketView::Layer depth);
+    PacketView::Layer getDepth() const;
+
+    // When on (the default), packets with a bad IPv4, TCP, UDP or ICMP
+    // checksum count as errors alongside malformed ones. Transport
+    // checksums are only checked from TRANSPORT depth.
+    void setChecksumValidation(bool enabled);
     void reset();
 
+    // When off, updates take no lock, so only one thread may use the
+    // instance at all; a StatisticsShard turns it off for its working copy.
+    // On by default, and not carried over by copies.
+    void setLocking(bool enabled);
+
+    // Connections expire once idle for this long, judged by packet
+    // timestamps; 300 seconds by default
+    void setConnectionTimeout(std::chrono::seconds timeout);
+
+    // Hosts and connections record the interfaces they were seen on as bits, numbered
+    // in the order interfaces are first seen, so each instance has its own
+    // numbering. Listing the capture interfaces up front gives them the
+    // same bits in every instance. Only the first MAX_INTERFACES get one.
+    static constexpr size_t MAX_INTERFACES = 64;
+    void setInterfaces(const std::vector<std::string>& names);
+    std::vector<std::string> getInterfaceNames(uint64_t interfaces) const;
+
+    // Called with each connection that expires, and by flushConnections()
+    using FlowRecordHandler = std::function<void(FlowRecord&&)>;
+    void setFlowRecordHandler(FlowRecordHandler handler);
+
+    // update() expires connections as packet time passes; this does the
+    // same when no packets arrive, e.g. with the wall clock on an idle link
+    void expireConnections(std::chrono::system_clock::time_point now);
+
+    // update() moves bandwidth on to the next second as packets arrive;
+    // this does the same without one, so on an idle link the second that
+    // ended goes into the history and current reads zero
+    void advanceBandwidth(std::chrono::system_clock::time_point now);
+
+    // Hands every open connection to the flow record handler as it stands,
+    // e.g. when capture ends. The connections are kept.
+    void flushConnections();
+
+    // Folds another instance (e.g. a capture worker's shard) into this one
+    void merge(const Statistics& other);
+
     // Protocol statistics
     uint64_t getTotalPackets() const;
     uint64_t getTotalBytes() const;
@@ -48,48 +173,112 @@ public:
     uint64_t getProtocolByteCount(Packet::Protocol protocol) const;
     std::vector<std::pair<Packet::Protocol, uint64_t>> getTopProtocols(size_t count) const;
 
-    // Host statistics
-    std::vector<std::pair<std::string, uint64_t>> getTopHosts(size_t count) const;
-    HostStats getHostStats(const std::string& host) const;
-    std::vector<std::string> getActiveHosts() const;
+    // Interface statistics, sorted by interface name
+    std::vector<std::pair<std::string, InterfaceStats>> getInterfaceStats() const;
+
+    // Traffic of connections that matched each payload signature, busiest
+    // first
+    std::vector<std::pair<std::string, ProtocolStats>> getSignatureStats() const;
 
-    // Connection statistics
-    std::vector<std::pair<std::string, uint64_t>> getTopConnections(size_t count) const;
-    ConnectionStats getConnectionStats(const std::string& connection_id) const;
-    std::vector<std::string> getActiveConnections() const;
+    // Traffic of TLS connections by the server name their ClientHello asked
+    // for, most bytes first
+    std::vector<std::pair<std::string, ProtocolStats>> getTopServices(size_t count) const;
 
-    // Bandwidth statistics
+    // DNS lookups, fed by the capture worker's DnsTracker rather than by
+    // update(). weight is the query's, as with update().
+    void recordDnsQuery(const IpAddress& resolver, uint32_t weight,
+                        std::chrono::system_clock::time_point timestamp);
+    void recordDnsResponse(const IpAddress& resolver, std::chrono::nanoseconds latency,
+                           uint8_t rcode, uint32_t weight,
+                           std::chrono::system_clock::time_point timestamp);
+    void recordDnsTimeout(const IpAddress& resolver, uint32_t weight);
+
+    // Resolvers, slowest 95th percentile first
+    std::vector<std::pair<IpAddress, DnsResolverStats>> getDnsResolverStats() const;
+
+    // Host statistics; hosts are kept and returned in binary form, format
+    // them with IpAddress::toString() for display. A snapshot only holds
+    // the busiest.
+    std::vector<std::pair<IpAddress, uint64_t>> getTopHosts(size_t count) const;
+    HostStats getHostStats(const IpAddress& host) const;
+    std::vector<IpAddress> getActiveHosts() const;
+
+    // Connection statistics; connections are TCP and UDP flows keyed in
+    // binary form, format them with FlowKey::toString() for display. A
+    // snapshot only holds the busiest; getConnectionCount() counts them all.
+    std::vector<std::pair<FlowKey, uint64_t>> getTopConnections(size_t count) const;
+    ConnectionStats getConnectionStats(const FlowKey& connection) const;
+    std::vector<FlowKey> getActiveConnections() const;
+    size_t getConnectionCount() const;
+
+    // Bandwidth statistics. Current is the bits counted so far this second,
+    // average the mean rate over the last hour.
     double getCurrentBandwidth() const;
     double getAverageBandwidth() const;
-    std::vector<std::pair<std::chrono::system_clock::time_point, double>> getBandwidthHistory() const;
+
+    // Bits per second, oldest first, each paired with the start of its
+    // interval. Kept per second for an hour, per minute for a day, per hour
+    // for 30 days and per day for a year; the finest of those at least
+    // resolution is returned.
+    std::vector<std::pair<std::chrono::system_clock::time_point, double>> getBandwidthHistory(
+        std::chrono::seconds resolution = std::chrono::seconds(1)) const;
 
     // Error statistics
     uint64_t getErrorCount() const;
     std::vector<std::pair<std::string, uint64_t>> getTopErrors(size_t count) const;
 
+    // True once any sampled (weight > 1) packet has been counted
+    bool isEstimated() const;
+
 private:
-    std::string generateConnectionId(const Packet& packet) const;
-    void updateProtocolStats(const Packet& packet);
-    void updateHostStats(const Packet& packet);
-    void updateConnectionStats(const Packet& packet);
-    void updateBandwidthStats(const Packet& packet);
-    void updateErrorStats(const Packet& packet);
-    void cleanupInactiveConnections();
+    void updateProtocolStats(const PacketView& packet, uint32_t weight);
+    void updateInterfaceStats(const PacketView& packet, uint32_t weight);
+    void updateSignatureStats(const PacketView& packet, uint32_t weight);
+    void updateServiceStats(const PacketView& packet, uint32_t weight);
+    void updateHostStats(const PacketView& packet, const IpAddress& source,
+                         const IpAddress& destination, uint64_t interface, uint32_t weight);
+    void updateConnectionStats(const PacketView& packet, const IpAddress& source,
+                               const IpAddress& destination, uint64_t interface);
+    void updateBandwidthStats(const PacketView& packet, uint32_t weight,
+                              std::chrono::system_clock::time_point now);
+    void rollBandwidth(std::chrono::system_clock::time_point now);
+    void updateErrorStats(const PacketView& packet, uint32_t weight);
+    bool hasError(const PacketView& packet) const;
+    void expire(std::chrono::system_clock::time_point now);
+    uint64_t interfaceBit(std::string_view interface);
+    std::vector<std::string> interfaceNames(uint64_t interfaces) const;
+    FlowRecord makeFlowRecord(const FlowKey& connection, ConnectionStats&& stats) const;
+    std::unique_lock<std::mutex> lockForUpdate() const;
 
     mutable std::mutex mutex_;
+    bool locking_ = true;
     std::atomic<uint64_t> total_packets_{0};
     std::atomic<uint64_t> total_bytes_{0};
     std::atomic<uint64_t> total_errors_{0};
+    bool estimated_ = false;
+    PacketView::Layer depth_ = PacketView::Layer::APPLICATION;
+    bool verify_checksums_ = true;
 
     std::unordered_map<Packet::Protocol, ProtocolStats> protocol_stats_;
-    std::unordered_map<std::string, HostStats> host_stats_;
-    std::unordered_map<std::string, ConnectionStats> connection_stats_;
+    StringKeyMap<InterfaceStats> interface_stats_;
+    std::vector<std::string> interface_names_;  // By ConnectionStats::interfaces bit
+    StringKeyMap<ProtocolStats> signature_stats_;
+    StringKeyMap<ProtocolStats> service_stats_;
+    std::unordered_map<IpAddress, HostStats> host_stats_;
+    FlowTable<FlowKey, ConnectionStats> connection_stats_;
+    size_t omitted_connections_ = 0;            // Left out of this snapshot
+    TimerWheel<FlowKey> connection_timers_;     // One timer per connection
+    std::chrono::seconds connection_timeout_{300};
+    FlowRecordHandler flow_record_handler_;
+    std::unordered_map<IpAddress, DnsResolverStats> dns_stats_;
 
-    std::vector<std::pair<std::chrono::system_clock::time_point, double>> bandwidth_history_;
-    std::chrono::system_clock::time_point last_bandwidth_update_;
+    // Bits per interval; about 48 KB whatever the uptime
+    TimeSeries bandwidth_history_{
+        {std::chrono::seconds(1), 3600},
+        {std::chrono::minutes(1), 1440},
+        {std::chrono::hours(1), 720},
+        {std::chrono::hours(24), 365}};
+    std::chrono::system_clock::time_point bandwidth_second_;    // That current_bandwidth_ counts
     std::atomic<double> current_bandwidth_{0.0};
     std::atomic<double> average_bandwidth_{0.0};
-
-    static constexpr size_t MAX_BANDWIDTH_HISTORY = 3600; // 1 hour at 1-second intervals
-    static constexpr std::chrono::seconds CONNECTION_TIMEOUT{300}; // 5 minutes
 }; 
\ No newline at end of file
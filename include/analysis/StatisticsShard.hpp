@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "analysis/Statistics.hpp"
+
+// One capture worker's statistics. The worker counts into a working copy
+// that takes no lock and that nothing else reads, and every interval
+// publishes a copy of it for readers to share. A reader merging shards for
+// the GUI or CLI only ever touches published copies, so it can't stall
+// capture and capture can't stall it; what it sees is at most one interval
+// old.
+//
+// A snapshot keeps only the busiest connections and hosts (1000 of each by
+// default), so publishing costs the same whether the worker tracks a
+// thousand flows or a million; everything else is copied whole. Publishing copies into the
+// snapshot before last when no reader still holds it, so once the tables
+// stop growing it doesn't allocate.
+class StatisticsShard {
+public:
+    explicit StatisticsShard(std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+    StatisticsShard(const StatisticsShard&) = delete;
+    StatisticsShard& operator=(const StatisticsShard&) = delete;
+
+    // Reads [analysis] statistics_interval, in seconds
+    static std::chrono::milliseconds intervalFromSettings();
+    void setInterval(std::chrono::milliseconds interval);
+
+    // Reads [analysis] snapshot_entries; 0 keeps every connection and host
+    static size_t snapshotEntriesFromSettings();
+    void setSnapshotEntries(size_t entries);
+
+    // Owning thread only
+    Statistics& getWorkingCopy() { return working_; }
+
+    // Publishes when an interval has passed since the last time; otherwise
+    // just a comparison, so it can be called per batch
+    void tick(std::chrono::steady_clock::time_point now);
+    void publish();
+
+    // Any thread. Never null; a new snapshot is a new object, so one that
+    // was handed out never changes.
+    std::shared_ptr<const Statistics> getSnapshot() const;
+
+    // Bumped by every publish
+    uint64_t getGeneration() const { return generation_.load(std::memory_order_acquire); }
+
+private:
+    Statistics working_;
+    std::chrono::milliseconds interval_;
+    std::chrono::steady_clock::time_point next_publish_;
+    size_t snapshot_entries_ = 1000;
+    std::shared_ptr<Statistics> spare_;        // The snapshot before last
+
+    mutable std::mutex mutex_;                 // Guards the pointer, not what it points to
+    std::shared_ptr<Statistics> snapshot_;
+    std::atomic<uint64_t> generation_{0};
+};
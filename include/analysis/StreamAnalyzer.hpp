@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "protocols/IpAddress.hpp"
+#include "protocols/Packet.hpp"
+
+// Side of a TCP connection a stream comes from; the client is the side
+// that opened it
+enum class StreamDirection : uint8_t { CLIENT, SERVER };
+
+// One TCP connection as StreamReassembler tracks it. Analyzers write what
+// they find here, and it stays until the connection closes or is dropped.
+struct TcpFlow {
+    IpAddress client;
+    IpAddress server;
+    uint16_t client_port = 0;
+    uint16_t server_port = 0;
+    bool midstream = false;     // No handshake seen, so client and server are a guess
+    std::chrono::system_clock::time_point first_seen;
+    std::chrono::system_clock::time_point last_seen;
+
+    // Filled in by analyzers
+    Packet::Protocol application = Packet::Protocol::UNKNOWN;
+    std::string_view signature;     // Label of the payload signature found, owned by its analyzer
+
+    // From the TLS ClientHello, kept here since the connection outlives
+    // the stream bytes. Lower-cased; a longer name keeps its last
+    // MAX_SERVER_NAME bytes from a label boundary, the part that names
+    // the service.
+    static constexpr size_t MAX_SERVER_NAME = 128;
+    static constexpr size_t MAX_ALPN = 16;
+    char server_name[MAX_SERVER_NAME];
+    uint8_t server_name_length = 0;
+    char alpn[MAX_ALPN];            // First protocol the client offered
+    uint8_t alpn_length = 0;
+
+    std::string_view getServerName() const { return std::string_view(server_name, server_name_length); }
+    std::string_view getAlpn() const { return std::string_view(alpn, alpn_length); }
+};
+
+// Application-layer analysis over reassembled TCP. Each direction of a
+// connection is handed over in order from its first byte, up to
+// StreamReassembler's cutoff, however it was segmented on the wire.
+// Called on the capture thread, so it must not block or allocate per call.
+class StreamAnalyzer {
+public:
+    enum class Verdict : uint8_t {
+        MORE,       // Call again when more of this direction arrives
+        DONE        // Seen enough of this direction
+    };
+
+    virtual ~StreamAnalyzer() = default;
+
+    // stream is every byte of the direction received in order so far; the
+    // last fresh of them are new since the previous call. Only valid
+    // during the call.
+    virtual Verdict onData(TcpFlow& flow, StreamDirection direction,
+                           std::span<const uint8_t> stream, size_t fresh) = 0;
+};
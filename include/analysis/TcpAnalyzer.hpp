@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "protocols/PacketView.hpp"
+
+// How one TCP connection is faring, worked out from its headers alone as
+// packets go by: handshake round trip, retransmissions, out-of-order
+// segments, duplicate ACKs and zero-window stalls. It sits inline in the
+// connection's ConnectionStats and keeps a fixed handful of fields per
+// direction, so each packet costs the same whatever the connection has
+// carried. Unlike the StreamAnalyzers it never looks at payload.
+//
+// Each direction remembers the sequence number after the highest byte it
+// has sent and the last gap it left. A segment that only carries bytes
+// from before that point either fills the gap, arriving within a round
+// trip of it, and is out of order, or was seen before and is a
+// retransmission. Only the latest gap is tracked, so data filling an
+// older one also counts as retransmitted.
+class TcpAnalyzer {
+public:
+    // End of the connection a packet came from, by FlowKey order
+    enum class Side : uint8_t { FIRST, SECOND };
+
+    struct Counters {
+        uint64_t segments = 0;          // Segments that carried sequence space: data, SYN or FIN
+        uint64_t retransmissions = 0;
+        uint64_t out_of_order = 0;
+        uint64_t duplicate_acks = 0;
+        uint64_t zero_windows = 0;      // Times the receive window closed
+
+        // Share of segments sent again, as an estimate of the loss rate
+        double getLossRate() const;
+    };
+
+    void update(const PacketView& packet, Side side);
+
+    // Folds in the same connection as seen by another worker
+    void merge(const TcpAnalyzer& other);
+
+    // Round trips measured on the handshake, zero until seen. The server
+    // side runs from SYN to SYN/ACK, the client side from SYN/ACK to the
+    // ACK that answers it; together they are the end-to-end round trip.
+    std::chrono::microseconds getServerRtt() const;
+    std::chrono::microseconds getClientRtt() const;
+    std::chrono::microseconds getHandshakeRtt() const;
+
+    // What side sent, or both directions together
+    Counters getCounters(Side side) const;
+    Counters getCounters() const;
+
+private:
+    // Per-direction flags
+    static constexpr uint8_t SEEN = 0x01;          // next is valid
+    static constexpr uint8_t ACKED = 0x02;         // last_ack and window are valid
+    static constexpr uint8_t GAP = 0x04;           // gap_begin..gap_end is missing
+    static constexpr uint8_t WINDOW_CLOSED = 0x08;
+
+    struct Direction {
+        uint32_t next = 0;                  // Sequence number after the highest byte sent
+        uint32_t last_ack = 0;
+        uint32_t gap_begin = 0;
+        uint32_t gap_end = 0;
+        std::chrono::system_clock::time_point gap_time;     // When the gap opened
+        uint32_t segments = 0;
+        uint32_t retransmissions = 0;
+        uint32_t out_of_order = 0;
+        uint32_t duplicate_acks = 0;
+        uint32_t zero_windows = 0;
+        uint16_t window = 0;
+        uint8_t flags = 0;
+    };
+
+    void trackHandshake(const PacketView& packet, uint8_t tcp_flags, Side side);
+    void trackSequence(Direction& direction, uint32_t begin, uint32_t end,
+                       std::chrono::system_clock::time_point time);
+    void trackAck(Direction& direction, uint8_t tcp_flags, uint32_t ack, uint16_t window,
+                  bool carries_data);
+
+    std::array<Direction, 2> directions_{};
+    std::chrono::system_clock::time_point syn_time_;
+    std::chrono::system_clock::time_point syn_ack_time_;
+    std::chrono::system_clock::time_point ack_time_;
+    Side client_ = Side::FIRST;
+};
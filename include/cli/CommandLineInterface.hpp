@@ -22,7 +22,7 @@ private:
     void displayStatistics() const;
     void displayConnections() const;
     void displayPackets() const;
-    void displayBandwidth() const;
+    void displayBandwidth(const std::string& resolution) const;
     void displayErrors() const;
     void setFilter(const std::string& filter);
     void clearFilter();
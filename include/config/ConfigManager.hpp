@@ -2,6 +2,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -22,6 +23,13 @@ public:
     std::optional<int> getInt(const std::string& section, const std::string& key) const;
     std::optional<bool> getBool(const std::string& section, const std::string& key) const;
     std::optional<double> getDouble(const std::string& section, const std::string& key) const;
+    // The value as written in the file, whatever type it was read as, for
+    // text such as patterns where "1.0" or "true" is meant literally
+    std::optional<std::string> getRawString(const std::string& section, const std::string& key) const;
+
+    // [monitoring] interface holds one name or a comma-separated list
+    std::vector<std::string> getInterfaces() const;
+    void setInterface(const std::string& interfaces);
 
     bool hasSection(const std::string& section) const;
     bool hasKey(const std::string& section, const std::string& key) const;
@@ -44,6 +52,7 @@ private:
     ConfigValue parseValue(const std::string& value) const;
 
     ConfigData config_data_;
+    std::unordered_map<std::string, std::unordered_map<std::string, std::string>> raw_data_;   // From the file
     std::string current_config_file_;
     mutable std::mutex mutex_;
 }; 
\ No newline at end of file
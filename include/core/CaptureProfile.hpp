@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// How much of each frame the pipeline keeps. Only the copy into Packet and
+// the store are bounded; byte counters always use the wire length.
+//
+//   full    - every captured byte
+//   headers - the first header_snaplen bytes, no payload
+//   budget  - full frames from the kernel, payload copied per port
+//             (e.g. all of DNS, the first 256 bytes of HTTP)
+class CaptureProfile {
+public:
+    enum class Mode { FULL, HEADERS, BUDGET };
+
+    static constexpr uint32_t FULL_SNAPLEN = 65535;
+    static constexpr size_t UNLIMITED = SIZE_MAX;
+
+    CaptureProfile();
+
+    // Reads capture_profile, header_snaplen, payload_budget and
+    // default_payload_budget from [monitoring]. Throws std::runtime_error
+    // on an unknown profile or a malformed budget list.
+    static CaptureProfile fromConfig();
+
+    Mode getMode() const { return mode_; }
+    std::string getName() const;
+
+    // Bytes per frame to request from the kernel
+    uint32_t getSnaplen() const { return snaplen_; }
+
+    // Payload bytes to keep for a flow between these ports; the larger
+    // budget wins when both ports have one
+    size_t getPayloadBudget(uint16_t source_port, uint16_t destination_port) const;
+
+private:
+    void parseBudgets(const std::string& spec);
+
+    Mode mode_;
+    uint32_t snaplen_;
+    size_t default_budget_;
+    std::unordered_map<uint16_t, size_t> port_budgets_;
+};
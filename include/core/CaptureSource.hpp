@@ -0,0 +1,63 @@
+#pragma once
+
+#include <sys/time.h>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+class PacketFilter;
+
+/// A single captured frame. The data pointer refers to memory owned by the
+/// capture source and is only valid for the duration of the batch callback.
+struct CaptureFrame {
+    const uint8_t* data = nullptr;
+    uint32_t caplen = 0;        // Bytes available at data
+    uint32_t wire_length = 0;   // Original length of the frame on the wire
+    struct timeval timestamp{};
+    // Transport checksum status, for backends whose kernel reports it
+    bool checksum_verified = false; // Already checked by the NIC or kernel
+    bool checksum_partial = false;  // Left for offload; the field isn't final
+};
+
+struct CaptureStats {
+    std::string interface;          // Filled in by NetworkMonitor
+    uint64_t packets_received = 0;
+    uint64_t packets_dropped = 0;   // Dropped by the kernel before we saw them
+    uint64_t batches = 0;           // Blocks / batches handed to the pipeline
+
+    // Descriptor ring occupancy, for backends with user/kernel rings (AF_XDP)
+    int queue_id = -1;
+    uint32_t ring_size = 0;
+    uint32_t fill_ring_used = 0;
+    uint32_t completion_ring_used = 0;
+};
+
+class CaptureSource {
+public:
+    using BatchHandler = std::function<void(const CaptureFrame* frames, size_t count)>;
+
+    virtual ~CaptureSource() = default;
+
+    virtual bool open(const std::string& interface) = 0;
+    virtual void close() = 0;
+
+    // Waits up to timeout_ms for traffic and hands at most one batch to the
+    // handler. Return codes mirror pcap_next_ex: >0 frames delivered,
+    // 0 timeout, -1 error, -2 end of input.
+    virtual int dispatch(const BatchHandler& handler, int timeout_ms) = 0;
+
+    // Installs the filter below the pipeline (kernel socket filter or
+    // libpcap). Returns false if the backend cannot, in which case the caller
+    // filters in user space. Only called from the capture thread.
+    virtual bool setFilter(const PacketFilter& /*filter*/) { return false; }
+
+    // Whether frames this host sent come with checksum_partial set when the
+    // kernel left their transport checksum to the NIC. Backends that can't
+    // tell hand those frames over with the field not yet filled in.
+    virtual bool reportsChecksumOffload() const { return false; }
+
+    virtual CaptureStats getStats() const = 0;
+    virtual std::string getName() const = 0;
+    virtual std::string getLastError() const = 0;
+};
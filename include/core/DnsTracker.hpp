@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "protocols/IpAddress.hpp"
+#include "protocols/PacketView.hpp"
+#include "utils/LruTable.hpp"
+
+struct DnsTrackerConfig {
+    size_t queries = 16384;              // Outstanding queries tracked at once
+    std::chrono::seconds timeout{5};     // Wait before a query counts as unanswered
+};
+
+// Times DNS lookups. Queries over UDP or TCP to port 53 are remembered by
+// client address and port, resolver address and transaction id, and the
+// response that matches one reports how long the resolver took and what
+// it answered. One per capture worker, used only by its capture thread.
+//
+// Messages are decoded with DnsMessage, which doesn't allocate, and the
+// table of outstanding queries is allocated up front. When it is full the
+// oldest query is dropped to make room, which reports it as timed out, and
+// queries time out after config.timeout of packet time. A response only matches a query with the
+// same question, so a reused transaction id is never timed against the
+// wrong lookup; one that carries no question matches on the transaction id
+// and addresses alone. A query sent again before its answer keeps its first
+// send time, since that is what the client waited from.
+class DnsTracker {
+public:
+    struct Event {
+        enum class Kind : uint8_t { QUERY, RESPONSE, TIMEOUT };
+
+        Kind kind = Kind::QUERY;
+        IpAddress resolver;
+        uint32_t weight = 1;                     // The query's, under flow sampling
+        std::chrono::nanoseconds latency{0};     // RESPONSE only
+        uint8_t rcode = 0;                       // RESPONSE only
+        std::chrono::system_clock::time_point timestamp;
+    };
+    using Handler = std::function<void(const Event& event)>;
+
+    struct Stats {
+        uint64_t queries = 0;       // New queries tracked
+        uint64_t retried = 0;       // Queries sent again before their answer
+        uint64_t answered = 0;
+        uint64_t timed_out = 0;
+        uint64_t evicted = 0;       // Dropped to make room for another, and reported as timed out
+        uint64_t unmatched = 0;     // Responses to no tracked query
+        uint64_t malformed = 0;     // Messages that didn't parse, or were cut short by the capture
+        size_t pending = 0;         // Queries waiting for an answer now
+    };
+
+    explicit DnsTracker(const DnsTrackerConfig& config = DnsTrackerConfig());
+
+    DnsTracker(const DnsTracker&) = delete;
+    DnsTracker& operator=(const DnsTracker&) = delete;
+
+    // Reads the [analysis] dns_* keys
+    static DnsTrackerConfig configFromSettings();
+
+    // Takes any packet and tracks the DNS ones. New queries, answers, and
+    // queries that timed out before this packet go to handler. A TCP
+    // segment is only read when it holds exactly one length-prefixed
+    // message.
+    void add(const PacketView& packet, uint32_t weight, const Handler& handler);
+
+    // Times out queries sent before now - config.timeout
+    void expire(std::chrono::system_clock::time_point now, const Handler& handler);
+
+    // Any thread
+    Stats getStats() const;
+
+    static constexpr uint16_t PORT = 53;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Slot {
+        // Key
+        IpAddress client;
+        IpAddress resolver;
+        uint16_t client_port = 0;
+        uint16_t id = 0;
+
+        uint64_t question = 0;          // Hash of the question's name, type and class
+        uint32_t weight = 1;
+        std::chrono::system_clock::time_point sent;
+    };
+
+    uint32_t find(const IpAddress& client, uint16_t client_port, const IpAddress& resolver,
+                  uint16_t id, size_t bucket) const;
+    void release(uint32_t index);
+    void timeOut(uint32_t index, std::atomic<uint64_t>& counter, const Handler& handler);
+    size_t bucketOf(const IpAddress& client, uint16_t client_port, const IpAddress& resolver,
+                    uint16_t id) const;
+
+    DnsTrackerConfig config_;
+    LruTable<Slot> slots_;              // Oldest query first
+
+    std::atomic<uint64_t> queries_{0};
+    std::atomic<uint64_t> retried_{0};
+    std::atomic<uint64_t> answered_{0};
+    std::atomic<uint64_t> timed_out_{0};
+    std::atomic<uint64_t> evicted_{0};
+    std::atomic<uint64_t> unmatched_{0};
+    std::atomic<uint64_t> malformed_{0};
+    std::atomic<size_t> pending_{0};
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "protocols/IpAddress.hpp"
+#include "protocols/PacketView.hpp"
+#include "utils/LruTable.hpp"
+
+struct FragmentReassemblerConfig {
+    size_t slots = 1024;                 // Datagrams held at once
+    size_t memory = 16 * 1024 * 1024;    // Bytes of fragment data held at once
+    std::chrono::seconds timeout{30};    // From a datagram's first fragment
+};
+
+// Rebuilds IPv4 and IPv6 datagrams from their fragments so that ports,
+// connections and application protocols are seen for the whole datagram.
+// One per capture worker, used only by its capture thread.
+//
+// Everything is allocated up front: a fixed table of datagram slots and an
+// arena of fragment data carved into blocks. A fragment flood can't grow
+// it; when the table or the arena is full the oldest datagram is dropped to
+// make room, and datagrams time out after config.timeout of packet time.
+// Overlapping fragments, datagrams over 64 KB and datagrams with more holes
+// than a slot can track are dropped as invalid.
+//
+// Every datagram leaves through the handler exactly once: whole, or, when it
+// is dropped, as a view of its first header flagged INCOMPLETE that carries
+// the wire bytes of the fragments that did arrive. Views handed out are only
+// valid during the call.
+class FragmentReassembler {
+public:
+    // weight is the one the datagram's first fragment was admitted with
+    using Handler = std::function<void(const PacketView& datagram, uint32_t weight)>;
+
+    struct Stats {
+        uint64_t fragments = 0;     // Taken in
+        uint64_t reassembled = 0;   // Datagrams completed
+        uint64_t timed_out = 0;
+        uint64_t evicted = 0;       // Dropped to free a slot or memory
+        uint64_t invalid = 0;       // Overlapping, oversized or too fragmented
+        uint64_t passed = 0;        // Fragments handed on alone (truncated capture)
+        size_t pending = 0;         // Datagrams waiting for fragments
+        size_t memory_used = 0;     // Bytes of arena held by them
+        size_t memory_capacity = 0;
+    };
+
+    explicit FragmentReassembler(const FragmentReassemblerConfig& config = FragmentReassemblerConfig());
+
+    FragmentReassembler(const FragmentReassembler&) = delete;
+    FragmentReassembler& operator=(const FragmentReassembler&) = delete;
+
+    // Reads the [monitoring] reassembly_* keys
+    static FragmentReassemblerConfig configFromSettings();
+
+    // Takes a frame for which isFragmented() is true. Datagrams it completes
+    // or pushes out, and any that timed out before it, go to handler.
+    void add(const PacketView& fragment, uint32_t weight, const Handler& handler);
+
+    // Drops datagrams that timed out by now, for when no fragments arrive
+    void expire(std::chrono::system_clock::time_point now, const Handler& handler);
+
+    // Drops every pending datagram, e.g. at the end of capture
+    void flush(const Handler& handler);
+
+    // Any thread
+    Stats getStats() const;
+
+    static constexpr size_t BLOCK_SIZE = 2048;
+    static constexpr size_t MAX_DATAGRAM = 65535;
+    static constexpr size_t MAX_HEADER = 192;   // Link and IP headers up to the fragment data
+    static constexpr size_t MAX_RANGES = 16;    // Disjoint runs of data per datagram
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr size_t BLOCKS_PER_DATAGRAM = (MAX_DATAGRAM + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct Slot {
+        // Key
+        IpAddress source;
+        IpAddress destination;
+        uint32_t id = 0;
+        uint8_t protocol = 0;           // IPv4 only; IPv6 ids are unique per address pair
+
+        std::string_view interface;
+        uint32_t weight = 1;
+        std::chrono::system_clock::time_point first_seen;
+        std::chrono::system_clock::time_point last_seen;
+        uint64_t wire_bytes = 0;        // Of every fragment taken, duplicates included
+        bool have_last = false;
+        uint32_t total = 0;             // Data length, once the last fragment is in
+        uint32_t received = 0;          // Data bytes held
+        size_t range_count = 0;
+        Range ranges[MAX_RANGES];       // Sorted, disjoint and not adjacent
+        uint32_t blocks[BLOCKS_PER_DATAGRAM];
+
+        // Frame bytes before the data of the first fragment to arrive,
+        // replaced by the offset-0 fragment's when that comes
+        size_t header_length = 0;
+        size_t network_offset = 0;
+        size_t next_header_offset = 0;
+        bool have_first = false;
+        uint8_t header[MAX_HEADER];
+    };
+
+    uint32_t find(const IpAddress& source, const IpAddress& destination,
+                  uint32_t id, uint8_t protocol, size_t bucket) const;
+    uint32_t allocate(const PacketView& fragment, size_t bucket, uint32_t weight,
+                      const Handler& handler);
+    bool insertRange(Slot& slot, uint32_t begin, uint32_t end, bool& duplicate) const;
+    bool store(uint32_t index, const uint8_t* data, uint32_t begin, uint32_t end,
+               const Handler& handler);
+    void complete(uint32_t index, const PacketView& last, const Handler& handler);
+    void drop(uint32_t index, std::atomic<uint64_t>& counter, const Handler& handler);
+    void release(uint32_t index);
+    size_t bucketOf(const IpAddress& source, const IpAddress& destination,
+                    uint32_t id, uint8_t protocol) const;
+
+    FragmentReassemblerConfig config_;
+    LruTable<Slot> slots_;              // Oldest first
+
+    std::vector<uint8_t> arena_;
+    std::vector<uint32_t> free_blocks_;
+    std::vector<uint8_t> output_;       // The rebuilt frame handed to the handler
+
+    std::atomic<uint64_t> fragments_{0};
+    std::atomic<uint64_t> reassembled_{0};
+    std::atomic<uint64_t> timed_out_{0};
+    std::atomic<uint64_t> evicted_{0};
+    std::atomic<uint64_t> invalid_{0};
+    std::atomic<uint64_t> passed_{0};
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> blocks_used_{0};
+};
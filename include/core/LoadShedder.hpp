@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/CaptureSource.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct LoadShedConfig {
+    bool enabled = true;
+    double drop_watermark = 0.01;        // Kernel drop ratio per interval
+    uint64_t backlog_watermark = 100000; // Packets queued for the data store
+    uint32_t max_rate = 64;              // Keep at least one flow in this many
+    std::chrono::milliseconds interval{1000};
+    int recover_intervals = 5;           // Calm intervals before stepping down
+};
+
+// Switches the pipeline to deterministic 1-in-N flow sampling when the
+// kernel starts dropping or the store falls behind. N is a power of two and
+// the hash is symmetric, so a sampled flow is seen in both directions and the
+// flows kept at 1-in-2N are a subset of those kept at 1-in-N.
+class LoadShedder {
+public:
+    explicit LoadShedder(const LoadShedConfig& config = LoadShedConfig());
+
+    // Reads the [monitoring] shed_* keys
+    static LoadShedConfig configFromSettings();
+
+    // Weight to count the frame with: 0 to skip it, N for a sampled flow.
+    // Frames without a flow (ARP, unknown ethertypes) are always kept at 1.
+    uint32_t admit(const CaptureFrame& frame) const;
+
+    // Feeds cumulative kernel counters and the current backlog, once per
+    // interval from a single thread. Returns true when the sampling rate
+    // changed, with the cause in reason.
+    bool update(uint64_t received, uint64_t dropped, size_t backlog, std::string& reason);
+
+    const LoadShedConfig& getConfig() const { return config_; }
+    uint32_t getRate() const { return rate_.load(std::memory_order_relaxed); }
+    bool isSampling() const { return getRate() > 1; }
+    uint64_t getTransitions() const { return transitions_.load(); }
+
+    // Symmetric hash of addresses, ports and protocol; has_flow is false
+    // for frames that are not IPv4/IPv6
+    static uint32_t flowHash(const CaptureFrame& frame, bool& has_flow);
+
+private:
+    LoadShedConfig config_;
+    std::atomic<uint32_t> rate_{1};
+    std::atomic<uint64_t> transitions_{0};
+
+    // Only touched by the thread calling update()
+    uint64_t last_received_ = 0;
+    uint64_t last_dropped_ = 0;
+    int calm_intervals_ = 0;
+};
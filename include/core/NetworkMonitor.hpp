@@ -1,23 +1,246 @@
 #pragma once
-#include "protocols/Packet.hpp"
-#include <vector>
-#include <functional>
+
+#include <QObject>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/CaptureProfile.hpp"
+#include "core/CaptureSource.hpp"
+#include "core/DnsTracker.hpp"
+#include "core/FragmentReassembler.hpp"
+#include "core/LoadShedder.hpp"
+#include "core/PacketFilter.hpp"
+#include "core/StreamReassembler.hpp"
+#include "core/XdpCaptureSource.hpp"
+#include "analysis/SignatureAnalyzer.hpp"
+#include "protocols/Packet.hpp"
+#include "protocols/PacketPool.hpp"
+#include "protocols/PacketView.hpp"
+#include "analysis/Statistics.hpp"
+#include "analysis/StatisticsShard.hpp"
+#include "storage/DataStore.hpp"
+#include "utils/SpscRing.hpp"
+
+class NetworkMonitor : public QObject {
+    Q_OBJECT
 
-class NetworkMonitor {
 public:
-    using PacketCallback = std::function<void(const Packet&)>;
+    explicit NetworkMonitor(QObject* parent = nullptr);
+    ~NetworkMonitor() override;
+
+    bool initialize();
+    void start();
+    void stop();
+
+    // Compiles a BPF expression and swaps it in on every capture worker
+    // without restarting capture. Throws std::runtime_error on a bad
+    // expression; an empty expression clears the filter.
+    void setFilter(const std::string& expression);
+    std::string getFilter() const;
+    uint64_t getFilteredPackets() const;
+
+    // Flow sampling rate chosen by load shedding: 1 means every packet is
+    // counted, N means statistics are estimates scaled up from 1 flow in N
+    uint32_t getSamplingRate() const;
+    uint64_t getShedPackets() const;
+
+    bool isRunning() const;
+    uint64_t getTotalPackets() const;
+    uint64_t getTotalBytes() const;
+    std::string getInterface() const;                  // Comma-separated for display
+    const std::vector<std::string>& getInterfaces() const { return m_interfaces; }
+    std::string getCaptureBackend() const;
+    const CaptureProfile& getCaptureProfile() const { return m_captureProfile; }
+    CaptureStats getCaptureStats() const;
+    std::vector<CaptureStats> getCaptureQueueStats() const;
+    std::string getCaptureReport() const;
+    bool isReplay() const;
+
+    // All workers' statistics as last published, merged. Safe to call at
+    // any rate: it never waits on capture, and until a worker publishes
+    // again every caller shares the same merged copy.
+    std::shared_ptr<const Statistics> getStatistics() const;
+
+    // Occupancy and overflow counts of the capture -> analysis rings
+    // (summed over workers) and the analysis -> store ring
+    struct PipelineStats {
+        size_t analysis_queued = 0;
+        size_t analysis_capacity = 0;
+        uint64_t analysis_overflows = 0;
+        size_t store_queued = 0;
+        size_t store_capacity = 0;
+        uint64_t store_overflows = 0;
+        uint64_t pool_hits = 0;         // Packets reused from the worker pools
+        uint64_t pool_misses = 0;       // Packets allocated because a pool was empty
+    };
+    PipelineStats getPipelineStats() const;
 
-    NetworkMonitor();
-    ~NetworkMonitor();
+    // Summed over workers; all zero when reassembly is off
+    bool isReassembling() const;
+    FragmentReassembler::Stats getReassemblyStats() const;
 
-    void registerPacketCallback(PacketCallback callback);
-    void unregisterPacketCallback(PacketCallback callback);
-    void processPacket(const Packet& packet);
-    void start() { /* Implementation */ }
-    void stop() { /* Implementation */ }
+    // Summed over workers; all zero when stream reassembly is off
+    bool isFollowingStreams() const;
+    StreamReassembler::Stats getStreamStats() const;
+
+    // Summed over workers; all zero when DNS tracking is off. Per-resolver
+    // latency is in getStatistics().
+    bool isTrackingDns() const;
+    DnsTracker::Stats getDnsStats() const;
+
+signals:
+    void packetCaptured(const Packet& packet);
+    void statsUpdated();
+    void monitoringStarted();
+    void monitoringStopped();
+    void captureFinished();   // All capture threads have exited (EOF, error or stop)
+    void samplingChanged(unsigned int rate);
 
 private:
-    std::vector<PacketCallback> packet_callbacks_;
-    std::mutex callback_mutex_;
-};
\ No newline at end of file
+    class StageClock;
+
+    // Cumulative time spent in each pipeline stage, filled when
+    // profile_stages is set (always on for replay)
+    struct StageTimings {
+        std::atomic<uint64_t> parse_ns{0};
+        std::atomic<uint64_t> reassembly_ns{0};
+        std::atomic<uint64_t> streams_ns{0};
+        std::atomic<uint64_t> dns_ns{0};
+        std::atomic<uint64_t> statistics_ns{0};
+        std::atomic<uint64_t> materialize_ns{0};
+        std::atomic<uint64_t> store_ns{0};
+        std::atomic<uint64_t> notify_ns{0};
+    };
+
+    // One capture socket with its own parse -> statistics -> store pipeline.
+    // Each interface gets capture_workers of these; with more than one the
+    // interface's sockets share a PACKET_FANOUT group, or bind consecutive
+    // NIC queues for AF_XDP. All workers feed the same data store.
+    //
+    // The capture thread runs every stage that reads the frame: parsing,
+    // fragment and stream reassembly, the stream analyzers, DNS and TCP
+    // tracking, statistics, connection expiry and publishing snapshots. The
+    // frame goes back to the kernel after its batch, so these work on it in
+    // place; behind the ring they would need a full copy of every frame.
+    // Only then is a Packet materialized for the ring. Storage and
+    // notification, which keep packets, run on the worker's analysis
+    // thread, so a slow consumer shows up as ring overflows. Analysis that
+    // can't keep up shows up as kernel drops instead, which load shedding
+    // answers the same way.
+    // What a worker's source->getStats() last returned. The source's handle
+    // belongs to the capture thread, so that thread reads it and publishes
+    // the result here for everyone else.
+    struct CaptureCounters {
+        std::atomic<uint64_t> received{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> batches{0};
+        std::atomic<int> queueId{-1};
+        std::atomic<uint32_t> ringSize{0};
+        std::atomic<uint32_t> fillRingUsed{0};
+        std::atomic<uint32_t> completionRingUsed{0};
+    };
+
+    struct CaptureWorker {
+        size_t index = 0;
+        size_t interfaceIndex = 0;
+        std::string interface;
+        std::unique_ptr<CaptureSource> source;
+        StatisticsShard statistics;
+        std::thread thread;
+        std::thread analysisThread;
+        std::unique_ptr<PacketPool> pool;        // Null when packet_pool_size is 0
+        std::unique_ptr<SpscRing<Packet>> ring;  // After pool, so it empties into it
+        std::unique_ptr<FragmentReassembler> reassembler;   // Null when reassembly is off
+        std::unique_ptr<StreamReassembler> streams;         // Null when stream reassembly is off
+        std::unique_ptr<DnsTracker> dns;                    // Null when DNS tracking is off
+        DnsTracker::Handler dnsEvents;                      // Into this worker's statistics
+        std::atomic<bool> captureDone{false};
+        std::atomic<uint64_t> frames{0};         // Delivered by the backend
+        std::atomic<uint64_t> packets{0};        // Counted into statistics
+        std::atomic<uint64_t> bytes{0};          // Wire length, whatever the profile kept
+        std::atomic<uint64_t> copiedBytes{0};    // Frame bytes copied into Packet
+        // Packets by the deepest layer decoded before materialize, indexed
+        // by PacketView::Layer
+        std::array<std::atomic<uint64_t>, 5> decodedLayers{};
+        std::atomic<bool> finished{false};
+        // The backend can't flag offloaded checksums, so frames from one of
+        // m_localAddresses skip the transport checksum check
+        bool skipLocalChecksums = false;
+        StageTimings timings;
+        CaptureCounters captureCounters;
+        std::chrono::steady_clock::time_point nextCaptureCounters;   // Capture thread only
+
+        // Filter state, owned by the capture thread
+        uint64_t filterGeneration = UINT64_MAX;
+        std::shared_ptr<const PacketFilter> userFilter;   // Set when the backend can't filter
+        std::atomic<bool> kernelFilter{false};
+        std::atomic<uint64_t> filtered{0};                // Rejected by userFilter
+        std::atomic<uint64_t> shed{0};                    // Skipped by flow sampling
+    };
+
+    // Counters captured when a kernel filter is installed, used to estimate
+    // how many frames it rejected
+    struct FilterBaseline {
+        bool valid = false;
+        uint64_t interface_packets = 0;
+        uint64_t captured = 0;
+        uint64_t dropped = 0;
+    };
+
+    std::unique_ptr<CaptureSource> openCaptureSource(size_t interfaceIndex, size_t workerIndex,
+                                                     uint16_t fanoutGroup);
+    void captureLoop(CaptureWorker& worker);
+    void processBatch(CaptureWorker& worker, const CaptureFrame* frames, size_t count);
+    void processPacket(CaptureWorker& worker, const CaptureFrame& frame, uint32_t weight);
+    // Statistics and hand-off for one datagram: a whole frame, or one the
+    // worker's reassembler put together or gave up on
+    void countPacket(CaptureWorker& worker, const PacketView& view, uint32_t weight,
+                     StageClock& clock);
+    void analysisLoop(CaptureWorker& worker);
+    void analyzePacket(CaptureWorker& worker, Packet& packet);
+    void checkLoad();
+    void publishCaptureCounters(CaptureWorker& worker);
+    static CaptureStats readCaptureCounters(const CaptureWorker& worker);
+    uint64_t getDeliveredFrames() const;
+
+    void finishWorker(CaptureWorker& worker);
+    void applyFilter(CaptureWorker& worker);
+    FilterBaseline takeFilterBaseline() const;
+
+    std::atomic<bool> m_running;
+    bool m_profileStages;
+    bool m_eagerDecode;                          // Decode every layer up front
+    uint16_t m_fanoutGroup;                      // First interface's PACKET_FANOUT group, never 0
+    PacketView::Layer m_statisticsDepth;
+    bool m_retainPackets;                        // Materialize for storage or listeners
+    CaptureProfile m_captureProfile;
+    std::shared_ptr<const SignatureAnalyzer::Signatures> m_signatures;   // Null without [signatures]
+    std::string m_readFile;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::chrono::steady_clock::time_point m_finishTime;
+    std::atomic<size_t> m_finishedWorkers;
+
+    mutable std::mutex m_filterMutex;
+    std::shared_ptr<const PacketFilter> m_filter;
+    FilterBaseline m_filterBaseline;
+    std::atomic<uint64_t> m_filterGeneration;
+    std::vector<std::unique_ptr<CaptureWorker>> m_workers;
+
+    mutable std::mutex m_statisticsMutex;
+    mutable std::shared_ptr<const Statistics> m_statistics;   // Merged shards, by generation
+    mutable uint64_t m_statisticsGeneration = 0;
+    std::vector<std::shared_ptr<XdpRedirectProgram>> m_xdpPrograms;   // Per interface
+    std::unique_ptr<LoadShedder> m_loadShedder;
+    std::chrono::steady_clock::time_point m_nextLoadCheck;   // Worker 0 only
+    std::vector<std::string> m_interfaces;
+    std::vector<IpAddress> m_localAddresses;     // This host's, read at start()
+
+    DataStore m_dataStore;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core/CaptureSource.hpp"
+#include <pcap.h>
+#include <memory>
+#include <string>
+
+// A compiled classic-BPF filter expression. Immutable once compiled so it
+// can be shared between capture workers and swapped in as a whole.
+class PacketFilter {
+public:
+    static constexpr uint32_t MAX_SNAPLEN = 65535;
+
+    // Throws std::runtime_error if the expression does not compile. The
+    // program returns snaplen for accepted frames, so a kernel socket
+    // filter also truncates them to that length.
+    static std::shared_ptr<const PacketFilter> compile(const std::string& expression,
+                                                       uint32_t snaplen = MAX_SNAPLEN);
+
+    ~PacketFilter();
+    PacketFilter(const PacketFilter&) = delete;
+    PacketFilter& operator=(const PacketFilter&) = delete;
+
+    const std::string& getExpression() const { return expression_; }
+    bool isEmpty() const { return expression_.empty(); }
+    uint32_t getSnaplen() const { return snaplen_; }
+    const struct bpf_program* getProgram() const { return &program_; }
+
+    // User-space evaluation for backends that cannot attach the program
+    bool matches(const CaptureFrame& frame) const;
+
+private:
+    PacketFilter() = default;
+
+    std::string expression_;
+    uint32_t snaplen_ = MAX_SNAPLEN;
+    struct bpf_program program_{};
+};
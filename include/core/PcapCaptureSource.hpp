@@ -0,0 +1,30 @@
+#pragma once
+
+#include "core/CaptureSource.hpp"
+#include <pcap.h>
+#include <atomic>
+
+// libpcap-backed capture, one frame per dispatch. Portable fallback for
+// platforms or privileges where the ring backends are unavailable.
+class PcapCaptureSource : public CaptureSource {
+public:
+    PcapCaptureSource(int snaplen, bool promiscuous, int timeout_ms);
+    ~PcapCaptureSource() override;
+
+    bool open(const std::string& interface) override;
+    void close() override;
+    int dispatch(const BatchHandler& handler, int timeout_ms) override;
+    bool setFilter(const PacketFilter& filter) override;
+
+    CaptureStats getStats() const override;
+    std::string getName() const override { return "pcap"; }
+    std::string getLastError() const override { return last_error_; }
+
+private:
+    pcap_t* handle_;
+    int snaplen_;
+    bool promiscuous_;
+    int timeout_ms_;
+    std::atomic<uint64_t> batches_;
+    std::string last_error_;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/CaptureSource.hpp"
+#include <pcap.h>
+#include <atomic>
+#include <chrono>
+
+// Feeds a pcap or pcapng file through the capture pipeline. A speed of 0
+// replays as fast as possible; otherwise inter-packet gaps from the file are
+// reproduced, divided by the speed factor (1.0 = original timing).
+class ReplayCaptureSource : public CaptureSource {
+public:
+    explicit ReplayCaptureSource(double speed);
+    ~ReplayCaptureSource() override;
+
+    bool open(const std::string& path) override;
+    void close() override;
+    int dispatch(const BatchHandler& handler, int timeout_ms) override;
+    bool setFilter(const PacketFilter& filter) override;
+
+    CaptureStats getStats() const override;
+    std::string getName() const override { return "replay"; }
+    std::string getLastError() const override { return last_error_; }
+
+private:
+    void pace(const struct timeval& ts);
+
+    pcap_t* handle_;
+    double speed_;
+    bool started_;
+    struct timeval first_ts_;
+    std::chrono::steady_clock::time_point wall_start_;
+    std::atomic<uint64_t> packets_{0};
+    std::string last_error_;
+};
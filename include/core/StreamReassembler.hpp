@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "analysis/StreamAnalyzer.hpp"
+#include "protocols/IpAddress.hpp"
+#include "protocols/PacketView.hpp"
+#include "utils/LruTable.hpp"
+
+struct StreamReassemblerConfig {
+    size_t flows = 65536;                // Connections tracked at once
+    size_t cutoff = 8192;                // Bytes of each direction handed to analyzers
+    size_t memory = 32 * 1024 * 1024;    // Bytes of stream buffers held at once
+    std::chrono::seconds timeout{120};   // Idle time before a connection is forgotten
+};
+
+// Follows TCP connections and hands each direction to the analyzers as an
+// in-order byte stream, however the sender segmented it and whatever order
+// the segments arrived in. Only the first config.cutoff bytes of a
+// direction are reassembled, and only while some analyzer still wants
+// more. One per capture worker, used only by its capture thread.
+//
+// Everything is allocated up front: a fixed table of connections and a
+// pool of cutoff-sized stream buffers. A direction only takes a buffer
+// once its analyzers need more than the first segment, and gives it back
+// when they are done, so most connections never hold one. When the table
+// is full the least recently active connection is dropped; when the pool
+// is empty the stream idle longest gives up its buffer. Connections are
+// forgotten after a FIN from both sides, a RST, or config.timeout of
+// packet time without traffic.
+class StreamReassembler {
+public:
+    struct Stats {
+        uint64_t flows = 0;         // Connections tracked
+        uint64_t closed = 0;        // By FIN or RST
+        uint64_t timed_out = 0;
+        uint64_t evicted = 0;       // Dropped to make room for another
+        uint64_t delivered = 0;     // Stream bytes handed to analyzers
+        uint64_t out_of_order = 0;  // Segments held for a gap before them to fill
+        uint64_t truncated = 0;     // Directions given up on while analyzers wanted more
+        size_t active = 0;          // Connections tracked now
+        size_t memory_used = 0;     // Bytes of stream buffers held
+        size_t memory_capacity = 0;
+    };
+
+    StreamReassembler(const StreamReassemblerConfig& config,
+                      std::vector<std::unique_ptr<StreamAnalyzer>> analyzers);
+
+    StreamReassembler(const StreamReassembler&) = delete;
+    StreamReassembler& operator=(const StreamReassembler&) = delete;
+
+    // Reads the [analysis] stream_* keys
+    static StreamReassemblerConfig configFromSettings();
+
+    // Takes any packet and follows the TCP ones. Returns the connection
+    // the packet belongs to, valid until the next call, or nullptr when it
+    // isn't tracked (not TCP, or no SYN or payload to start tracking on).
+    const TcpFlow* add(const PacketView& packet);
+
+    // Forgets connections idle since before now - config.timeout
+    void expire(std::chrono::system_clock::time_point now);
+
+    // Any thread
+    Stats getStats() const;
+
+    static constexpr size_t MAX_ANALYZERS = 16;
+    static constexpr size_t MAX_RANGES = 8;     // Out-of-order runs held per direction
+    static constexpr size_t STEAL_SCAN = 64;    // Connections searched for a buffer to take
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // One direction. Offsets count from the byte after the SYN, or from
+    // the first payload seen when the handshake was missed.
+    struct Stream {
+        uint32_t base = 0;              // Sequence number of offset 0
+        bool have_base = false;
+        bool fin = false;
+        uint16_t pending = 0;           // Analyzers still reading, one bit each
+        uint32_t delivered = 0;         // Bytes handed on in order
+        uint32_t buffer = NONE;         // Holds offsets 0 to cutoff once taken
+        size_t range_count = 0;
+        Range ranges[MAX_RANGES];       // Held past delivered: sorted, disjoint, not adjacent
+    };
+
+    struct Slot {
+        TcpFlow flow;
+        Stream streams[2];              // Indexed by StreamDirection
+    };
+
+    uint32_t find(const IpAddress& source, uint16_t source_port,
+                  const IpAddress& destination, uint16_t destination_port, size_t bucket) const;
+    uint32_t allocate(const PacketView& packet, uint8_t flags, size_t bucket);
+    void receive(uint32_t index, StreamDirection direction, const PacketView& packet, uint32_t sequence);
+    void deliver(Slot& slot, StreamDirection direction, const uint8_t* data, size_t fresh);
+    bool takeBuffer(uint32_t index, Stream& stream);
+    void finish(Stream& stream, bool truncated);
+    bool insertRange(Stream& stream, uint32_t begin, uint32_t end) const;
+    void release(uint32_t index, std::atomic<uint64_t>& counter);
+    size_t bucketOf(const IpAddress& a, uint16_t a_port, const IpAddress& b, uint16_t b_port) const;
+
+    StreamReassemblerConfig config_;
+    std::vector<std::unique_ptr<StreamAnalyzer>> analyzers_;
+    uint16_t all_analyzers_ = 0;
+
+    LruTable<Slot> slots_;              // Least recently active first
+
+    std::vector<uint8_t> arena_;        // Stream buffers, config.cutoff bytes each
+    std::vector<uint32_t> free_buffers_;
+
+    std::atomic<uint64_t> flows_{0};
+    std::atomic<uint64_t> closed_{0};
+    std::atomic<uint64_t> timed_out_{0};
+    std::atomic<uint64_t> evicted_{0};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> out_of_order_{0};
+    std::atomic<uint64_t> truncated_{0};
+    std::atomic<size_t> active_{0};
+    std::atomic<size_t> buffers_used_{0};
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/CaptureSource.hpp"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Minimal XDP program that redirects every frame on a queue to the AF_XDP
+// socket registered for that queue (falling back to XDP_PASS). One instance
+// is attached per interface and shared by all of its queue sockets.
+class XdpRedirectProgram {
+public:
+    XdpRedirectProgram() = default;
+    ~XdpRedirectProgram();
+    XdpRedirectProgram(const XdpRedirectProgram&) = delete;
+    XdpRedirectProgram& operator=(const XdpRedirectProgram&) = delete;
+
+    bool attach(unsigned int ifindex, bool skb_mode);
+    bool registerSocket(uint32_t queue_id, int xsk_fd);
+    void detach();
+
+    bool isAttached() const { return link_fd_ >= 0; }
+    std::string getLastError() const { return last_error_; }
+
+private:
+    int map_fd_ = -1;
+    int prog_fd_ = -1;
+    int link_fd_ = -1;
+    std::string last_error_;
+
+    static constexpr uint32_t MAX_QUEUES = 64;
+};
+
+struct XdpConfig {
+    uint32_t queue_id = 0;
+    uint32_t frame_size = 2048;    // UMEM chunk size, power of two >= 2048
+    uint32_t frame_count = 4096;   // UMEM chunks
+    uint32_t ring_size = 2048;     // RX / fill / completion descriptors, power of two
+    uint32_t batch_size = 64;      // Max descriptors handed to the pipeline per dispatch
+    bool skb_mode = true;          // Generic XDP: works on veth and any driver
+    bool zero_copy = false;        // Needs native mode and driver support
+    std::shared_ptr<XdpRedirectProgram> program;
+};
+
+// Whether interface's RSS sends both directions of a flow to the same
+// queue, which takes a Toeplitz hash with a key of repeated 0x6d5a. If not,
+// or if the NIC won't say, why is set.
+bool hasSymmetricRss(const std::string& interface, std::string& why);
+
+// AF_XDP (XSK) capture. Frames are DMA'd / copied into a UMEM region we own,
+// handed to the parser in place, and recycled into the fill ring once the
+// batch handler returns.
+class XdpCaptureSource : public CaptureSource {
+public:
+    explicit XdpCaptureSource(const XdpConfig& config);
+    ~XdpCaptureSource() override;
+
+    bool open(const std::string& interface) override;
+    void close() override;
+    int dispatch(const BatchHandler& handler, int timeout_ms) override;
+    // Receive only, so it never sees a frame this host sent
+    bool reportsChecksumOffload() const override { return true; }
+
+    CaptureStats getStats() const override;
+    std::string getName() const override { return "af_xdp"; }
+    std::string getLastError() const override { return last_error_; }
+
+private:
+    struct Ring {
+        uint32_t* producer = nullptr;
+        uint32_t* consumer = nullptr;
+        uint32_t* flags = nullptr;
+        void* descs = nullptr;
+        void* map = nullptr;
+        size_t map_size = 0;
+        uint32_t mask = 0;
+    };
+
+    bool setupUmem();
+    bool mapRing(Ring& ring, uint64_t pgoff, const void* offsets, size_t desc_size);
+    void unmapRing(Ring& ring);
+    void kick();
+    void fail(const std::string& what);
+
+    XdpConfig config_;
+    int fd_;
+    uint8_t* umem_;
+    size_t umem_size_;
+    Ring rx_;
+    Ring fill_;
+    Ring completion_;
+    std::vector<CaptureFrame> frames_;
+    std::vector<uint64_t> addrs_;
+    std::string last_error_;
+
+    std::atomic<uint64_t> packets_received_{0};
+    std::atomic<uint64_t> batches_{0};
+};
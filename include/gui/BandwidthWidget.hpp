@@ -33,6 +33,7 @@ private:
     QLabel* current_bandwidth_label_;
     QLabel* average_bandwidth_label_;
     QComboBox* time_range_combo_;
+    int time_range_ = 0;        // Index into the ranges the combo box offers
 
     void setupUI();
     void updateLabels();
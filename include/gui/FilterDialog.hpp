@@ -12,6 +12,7 @@ class FilterDialog : public QDialog {
 public:
     explicit FilterDialog(QWidget* parent = nullptr);
     QString getFilter() const { return filter_edit_->text(); }
+    void setFilter(const QString& filter) { filter_edit_->setText(filter); }
 
 private:
     QLineEdit* filter_edit_;
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// RFC 1071 Internet checksum. Sums are taken over 16-bit words in host byte
+// order, which gives the same folded result as network order byte-swapped
+// (RFC 1071, section 2); a region that includes its own checksum field
+// verifies when the folded sum is 0xffff, in either order. Partial sums of
+// even-length pieces can be added together before folding, e.g. a
+// pseudo-header and a segment.
+//
+// The summing loop uses AVX2 or SSE2 when the CPU has them, chosen once at
+// startup, and a portable loop otherwise.
+class InternetChecksum {
+public:
+    // Ones' complement sum of length bytes, not yet folded. An odd trailing
+    // byte is padded with zero, as the RFC requires.
+    static uint64_t sum(const uint8_t* data, size_t length, uint64_t initial = 0);
+
+    // Folds a sum to 16 bits, without complementing it
+    static uint16_t fold(uint64_t sum);
+
+    // "avx2", "sse2" or "scalar"
+    static const char* getImplementation();
+};
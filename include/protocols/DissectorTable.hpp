@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Flat dispatch table built at compile time from a list of dissector types.
+// Each dissector lists the keys it handles (ethertypes, IP protocol numbers
+// or ports) and the member of Context to run for them:
+//
+//     struct IPv4 {
+//         static constexpr uint16_t keys[] = {0x0800};
+//         static constexpr auto handler = &PacketView::parseIPv4;
+//     };
+//
+// Keys are folded into Slots buckets, and two keys landing in the same
+// bucket fail the build, so a lookup is one load, one compare and one
+// direct-to-the-parser indirect call however many dissectors are
+// registered. Dissectors left out of the list have no entry and cost
+// nothing at run time.
+template <typename Context, typename Key, size_t Slots, typename... Dissectors>
+class DissectorTable {
+    static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+public:
+    struct Entry {
+        void (*dissect)(const Context&) = nullptr;
+        Key key{};
+        uint8_t rank = 0;       // Position of the dissector in the list
+    };
+
+    // Null when no dissector handles key
+    static const Entry* find(Key key) {
+        const Entry& entry = entries_[slot(key)];
+        return entry.dissect != nullptr && entry.key == key ? &entry : nullptr;
+    }
+
+    // Runs the dissector for key; false when there is none
+    static bool dispatch(Key key, const Context& context) {
+        const Entry* entry = find(key);
+        if (entry == nullptr) {
+            return false;
+        }
+        entry->dissect(context);
+        return true;
+    }
+
+private:
+    static constexpr size_t slot(Key key) {
+        const size_t value = static_cast<size_t>(key);
+        return (value ^ (value >> 8)) & (Slots - 1);
+    }
+
+    // A plain function per dissector, so the handler is inlined into it and
+    // the table holds ordinary function pointers
+    template <typename Dissector>
+    static void invoke(const Context& context) {
+        (context.*Dissector::handler)();
+    }
+
+    static constexpr std::array<Entry, Slots> build() {
+        std::array<Entry, Slots> entries{};
+        uint8_t rank = 0;
+        auto add = [&]<typename Dissector>() {
+            for (const Key key : Dissector::keys) {
+                Entry& entry = entries[slot(key)];
+                if (entry.dissect != nullptr) {
+                    // Reached only during constant evaluation, where it
+                    // stops the build
+                    throw "dissector keys collide; increase Slots";
+                }
+                entry = Entry{&invoke<Dissector>, key, rank};
+            }
+            ++rank;
+        };
+        (add.template operator()<Dissectors>(), ...);
+        return entries;
+    }
+
+    static constexpr std::array<Entry, Slots> entries_ = build();
+};
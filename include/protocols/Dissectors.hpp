@@ -0,0 +1,66 @@
+#pragma once
+
+#include <netinet/in.h>      // IPPROTO_* constants
+#include "protocols/DissectorTable.hpp"
+#include "protocols/PacketView.hpp"
+
+// The dissectors compiled into PacketView, one table per layer. To support
+// a new protocol, give PacketView a parser for it and list it here; the
+// decode loop looks handlers up by key and needs no change. Only
+// PacketView.cpp includes this.
+struct PacketView::Dissectors {
+    using Handler = void (PacketView::*)() const;
+    template <typename Key, size_t Slots, typename... List>
+    using Table = DissectorTable<PacketView, Key, Slots, List...>;
+
+    // Network layer, keyed by ethertype after any VLAN tags
+    struct IPv4 {
+        static constexpr uint16_t keys[] = {0x0800};
+        static constexpr Handler handler = &PacketView::parseIPv4;
+    };
+    struct IPv6 {
+        static constexpr uint16_t keys[] = {0x86dd};
+        static constexpr Handler handler = &PacketView::parseIPv6;
+    };
+    struct ARP {
+        static constexpr uint16_t keys[] = {0x0806};
+        static constexpr Handler handler = &PacketView::parseARP;
+    };
+    using Network = Table<uint16_t, 16, IPv4, IPv6, ARP>;
+
+    // Transport layer, keyed by IP protocol number
+    struct TCP {
+        static constexpr uint8_t keys[] = {IPPROTO_TCP};
+        static constexpr Handler handler = &PacketView::parseTCP;
+    };
+    struct UDP {
+        static constexpr uint8_t keys[] = {IPPROTO_UDP};
+        static constexpr Handler handler = &PacketView::parseUDP;
+    };
+    struct ICMP {
+        static constexpr uint8_t keys[] = {IPPROTO_ICMP, IPPROTO_ICMPV6};
+        static constexpr Handler handler = &PacketView::parseICMP;
+    };
+    using Transport = Table<uint8_t, 32, TCP, UDP, ICMP>;
+
+    // Application layer, keyed by either port. When the two ports name
+    // different protocols, the one listed first wins.
+    struct HTTP {
+        static constexpr uint16_t keys[] = {80, 8080};
+        static constexpr Handler handler = &PacketView::classify<Packet::Protocol::HTTP>;
+    };
+    struct HTTPS {
+        static constexpr uint16_t keys[] = {443};
+        static constexpr Handler handler = &PacketView::classify<Packet::Protocol::HTTPS>;
+    };
+    struct DNS {
+        static constexpr uint16_t keys[] = {53};
+        static constexpr Handler handler = &PacketView::classify<Packet::Protocol::DNS>;
+    };
+    struct DHCP {
+        static constexpr uint16_t keys[] = {67, 68};
+        static constexpr Handler handler = &PacketView::classify<Packet::Protocol::DHCP>;
+    };
+    using TcpApplication = Table<uint16_t, 64, HTTP, HTTPS, DNS>;
+    using UdpApplication = Table<uint16_t, 64, DNS, DHCP>;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// The header and first question of a DNS message (RFC 1035), decoded in
+// place. Nothing is allocated: the question name is expanded, compression
+// pointers and all, into a buffer inside the object, so one parsed on the
+// stack costs no heap. Only the question is decoded; records after it are
+// left alone.
+class DnsMessage {
+public:
+    static constexpr size_t HEADER_LENGTH = 12;
+    static constexpr size_t MAX_NAME_LENGTH = 253;  // Dotted text of a 255-byte wire name
+    static constexpr size_t MAX_LABEL_LENGTH = 63;
+
+    enum Rcode : uint8_t {
+        NOERROR  = 0,
+        FORMERR  = 1,
+        SERVFAIL = 2,
+        NXDOMAIN = 3,
+        NOTIMP   = 4,
+        REFUSED  = 5
+    };
+
+    // False when message is shorter than a header or its question is
+    // malformed. A message without a question parses with an empty name.
+    bool parse(std::span<const uint8_t> message);
+
+    uint16_t getId() const { return id_; }
+    bool isResponse() const { return flags_ & 0x8000; }
+    uint8_t getOpcode() const { return (flags_ >> 11) & 0x0f; }
+    bool isTruncated() const { return flags_ & 0x0200; }
+    uint8_t getRcode() const { return flags_ & 0x0f; }
+    uint16_t getQuestionCount() const { return question_count_; }
+    uint16_t getAnswerCount() const { return answer_count_; }
+
+    // First question; the name is dotted, without the root's trailing dot,
+    // and only valid as long as this object
+    std::string_view getName() const { return std::string_view(name_, name_length_); }
+    uint16_t getType() const { return type_; }
+    uint16_t getClass() const { return class_; }
+
+    // Expands the name at offset into name, which must hold
+    // MAX_NAME_LENGTH bytes, and sets length. Returns the offset just past
+    // the name as it appears at offset, or 0 when it runs off the end, has
+    // a label or total over the limits, or a compression pointer that
+    // doesn't point strictly backwards (which also rules out loops).
+    static size_t readName(std::span<const uint8_t> message, size_t offset,
+                           char* name, size_t& length);
+
+    // "NOERROR", "SERVFAIL", ... or "RCODE<n>"
+    static std::string_view getRcodeString(uint8_t rcode);
+
+private:
+    uint16_t id_ = 0;
+    uint16_t flags_ = 0;
+    uint16_t question_count_ = 0;
+    uint16_t answer_count_ = 0;
+    uint16_t type_ = 0;
+    uint16_t class_ = 0;
+    size_t name_length_ = 0;
+    char name_[MAX_NAME_LENGTH];
+};
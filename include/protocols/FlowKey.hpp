@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include "protocols/IpAddress.hpp"
+#include "protocols/Packet.hpp"
+
+// A TCP or UDP flow's 5-tuple in binary form: 44 bytes, hashed once at
+// construction. Both directions of a flow give the same key; the end with
+// the lower address (then port) is always first, so hashing and comparing
+// never look at which way a packet went. Text is produced only when
+// toString() is called.
+class FlowKey {
+public:
+    FlowKey() = default;
+    FlowKey(const IpAddress& source, uint16_t source_port,
+            const IpAddress& destination, uint16_t destination_port,
+            Packet::Protocol transport);
+
+    // True when a packet from source to destination runs from the key's
+    // first end to its second
+    static bool isForward(const IpAddress& source, uint16_t source_port,
+                          const IpAddress& destination, uint16_t destination_port);
+
+    IpAddress getFirstAddress() const;
+    IpAddress getSecondAddress() const;
+    uint16_t getFirstPort() const { return first_port_; }
+    uint16_t getSecondPort() const { return second_port_; }
+    Packet::Protocol getTransport() const { return static_cast<Packet::Protocol>(transport_); }
+    size_t hash() const { return hash_; }
+
+    // "10.0.0.1:40000-10.0.0.2:443/tcp", with IPv6 addresses in brackets
+    std::string toString() const;
+
+    bool operator==(const FlowKey& other) const;
+    bool operator!=(const FlowKey& other) const { return !(*this == other); }
+
+private:
+    IpAddress makeAddress(const std::array<uint8_t, 16>& bytes) const;
+
+    std::array<uint8_t, 16> first_{};
+    std::array<uint8_t, 16> second_{};
+    uint16_t first_port_ = 0;
+    uint16_t second_port_ = 0;
+    IpAddress::Family family_ = IpAddress::Family::NONE;
+    uint8_t transport_ = 0;
+    uint32_t hash_ = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const FlowKey& key);
+
+template <>
+struct std::hash<FlowKey> {
+    size_t operator()(const FlowKey& key) const noexcept { return key.hash(); }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// IPv4 or IPv6 address kept in binary form, with its hash computed once at
+// construction so map lookups never rehash it. IPv4 addresses are stored
+// in the first four bytes. A default-constructed address is empty and
+// stands for "no address" (e.g. non-IP frames). Text is produced only when
+// format() or toString() is called.
+class IpAddress {
+public:
+    enum class Family : uint8_t {
+        NONE,
+        V4,
+        V6
+    };
+
+    // Large enough for any address in text form, including the terminator
+    using Text = std::array<char, 46>;
+
+    IpAddress() = default;
+
+    // bytes are in network order, as found in the packet
+    static IpAddress fromV4(const uint8_t* bytes);
+    static IpAddress fromV6(const uint8_t* bytes);
+
+    // Accepts dotted-quad or RFC 4291 text; empty text gives an empty address
+    static std::optional<IpAddress> parse(std::string_view text);
+
+    Family getFamily() const { return family_; }
+    bool isV4() const { return family_ == Family::V4; }
+    bool isV6() const { return family_ == Family::V6; }
+    bool isEmpty() const { return family_ == Family::NONE; }
+
+    const uint8_t* data() const { return bytes_.data(); }
+    size_t size() const;            // 4, 16, or 0 when empty
+    size_t hash() const { return hash_; }
+
+    // Writes the text form into buffer and returns a view of it; an empty
+    // address formats as an empty string
+    std::string_view format(Text& buffer) const;
+    std::string toString() const;
+
+    bool operator==(const IpAddress& other) const {
+        return hash_ == other.hash_ && family_ == other.family_ && bytes_ == other.bytes_;
+    }
+    bool operator!=(const IpAddress& other) const { return !(*this == other); }
+    // Orders by family, then address bytes
+    bool operator<(const IpAddress& other) const;
+
+private:
+    IpAddress(Family family, const uint8_t* bytes, size_t length);
+
+    std::array<uint8_t, 16> bytes_{};
+    uint32_t hash_ = 0;
+    Family family_ = Family::NONE;
+};
+
+std::ostream& operator<<(std::ostream& os, const IpAddress& address);
+
+template <>
+struct std::hash<IpAddress> {
+    size_t operator()(const IpAddress& address) const noexcept { return address.hash(); }
+};
@@ -5,6 +5,14 @@
 #include <string>
 #include <chrono>
 #include <memory>
+#include <span>
+#include <utility>
+#include <sys/time.h>
+#include "protocols/IpAddress.hpp"
+
+class CaptureProfile;
+class PacketPool;
+struct PacketView;
 
 struct Packet {
     enum class Protocol {
@@ -17,41 +25,65 @@ struct Packet {
         ICMP,
         HTTP,
         HTTPS,
+        TLS,            // On a port other than HTTPS's, found from the stream
         DNS,
         DHCP,
         ARP
     };
 
-    Packet(const uint8_t* data, size_t length, const struct timeval& timestamp);
-    ~Packet() = default;
+    Packet() = default;
+    // caplen bytes are readable at data; wire_length is the frame's original
+    // size. The profile bounds how much of the frame is copied; without one
+    // everything captured is kept.
+    Packet(const uint8_t* data, size_t caplen, size_t wire_length,
+           const struct timeval& timestamp, const CaptureProfile* profile = nullptr);
+    // Same as PacketView::materialize()
+    explicit Packet(const PacketView& view, const CaptureProfile* profile = nullptr);
+    // A packet taken from a PacketPool goes back to it when destroyed
+    ~Packet();
+
+    Packet(const Packet&) = default;
+    Packet(Packet&&) noexcept = default;
+    Packet& operator=(const Packet&) = default;
+    Packet& operator=(Packet&&) noexcept = default;
+
+    // Refills this packet from view, reusing the capacity of its buffers
+    void assign(const PacketView& view, const CaptureProfile* profile = nullptr);
 
     // Packet data
-    std::vector<uint8_t> raw_data;
-    size_t length;
+    std::vector<uint8_t> raw_data;      // Headers plus the budgeted payload
+    size_t length = 0;                  // Original length on the wire
+    size_t captured_length = 0;         // Bytes the capture delivered
     std::chrono::system_clock::time_point timestamp;
+    std::string interface;              // Capture interface, set by NetworkMonitor
 
     // Protocol information
-    Protocol protocol;
-    std::string source_address;
-    std::string destination_address;
-    uint16_t source_port;
-    uint16_t destination_port;
+    Protocol protocol = Protocol::UNKNOWN;              // Highest layer identified
+    Protocol network_protocol = Protocol::UNKNOWN;      // IPV4, IPV6, ARP or UNKNOWN
+    Protocol transport_protocol = Protocol::UNKNOWN;    // TCP, UDP, ICMP or UNKNOWN
+    IpAddress source_address;           // Empty for frames without one
+    IpAddress destination_address;
+    uint16_t source_port = 0;
+    uint16_t destination_port = 0;
 
     // Packet analysis
-    bool is_fragmented;
-    bool is_malformed;
-    uint32_t sequence_number;
-    uint32_t acknowledgment_number;
-    uint16_t window_size;
-    uint8_t ttl;
-    uint8_t tos;
+    bool is_fragmented = false;
+    bool is_malformed = false;
+    uint32_t sequence_number = 0;
+    uint32_t acknowledgment_number = 0;
+    uint16_t window_size = 0;
+    uint8_t ttl = 0;
+    uint8_t tos = 0;
 
     // Payload information
-    std::vector<uint8_t> payload;
-    size_t payload_offset;
-    size_t payload_length;
+    size_t payload_offset = 0;
+    size_t payload_length = 0;          // Payload size on the wire
+
+    // The payload bytes kept in raw_data, at most the profile's budget
+    std::span<const uint8_t> getPayload() const;
 
     // Helper methods
+    static std::string getProtocolString(Protocol protocol);
     std::string getProtocolString() const;
     bool isTCP() const;
     bool isUDP() const;
@@ -63,13 +95,26 @@ struct Packet {
     bool isIPv4() const;
     bool isIPv6() const;
 
+    // Re-parses raw_data, e.g. to feed a stored packet to code that works on
+    // views. Valid while this packet is alive and unchanged.
+    PacketView view() const;
+
 private:
-    void parseEthernet();
-    void parseIPv4();
-    void parseIPv6();
-    void parseTCP();
-    void parseUDP();
-    void parseICMP();
-    void parseARP();
-    void determineApplicationProtocol();
-}; 
\ No newline at end of file
+    friend class PacketPool;
+
+    // Which pool this packet returns to. Moves carry the link along;
+    // copies are never pooled.
+    struct PoolLink {
+        PacketPool* pool = nullptr;
+
+        PoolLink() = default;
+        PoolLink(const PoolLink&) {}
+        PoolLink(PoolLink&& other) noexcept : pool(std::exchange(other.pool, nullptr)) {}
+        PoolLink& operator=(const PoolLink&) { return *this; }
+        PoolLink& operator=(PoolLink&& other) noexcept {
+            pool = std::exchange(other.pool, nullptr);
+            return *this;
+        }
+    };
+    PoolLink pool_link_;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "protocols/Packet.hpp"
+#include "utils/MpscRing.hpp"
+
+// Recycles packets, with the capacity of their buffers, between the capture
+// thread that fills them and whichever thread drops them: the database
+// writer in the common case, or an analysis or capture thread when a ring
+// overflows. A packet from acquire() returns itself here on destruction, so
+// neither side frees or allocates once buffers have grown to the traffic's
+// frame sizes.
+//
+// The pool must outlive every packet it hands out.
+class PacketPool {
+public:
+    explicit PacketPool(size_t capacity);
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    // Capture thread only. A recycled packet when one is free, otherwise a
+    // new one; either way it is linked to this pool.
+    Packet acquire();
+
+    // Any thread. Called by ~Packet; a packet that doesn't fit is freed.
+    void release(Packet&& packet);
+
+    uint64_t getHits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t getMisses() const { return misses_.load(std::memory_order_relaxed); }
+    size_t getFree() const { return free_.size(); }
+    size_t getCapacity() const { return free_.capacity(); }
+
+    // Buffers larger than this (GRO or jumbo frames) are freed on release
+    // rather than held, so a burst of them doesn't pin memory
+    static constexpr size_t MAX_RETAINED_BYTES = 16384;
+
+private:
+    MpscRing<Packet> free_;
+    std::atomic<uint64_t> hits_{0};     // Written by the capture thread only
+    std::atomic<uint64_t> misses_{0};
+};
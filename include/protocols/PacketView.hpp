@@ -0,0 +1,197 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <sys/time.h>
+#include "protocols/IpAddress.hpp"
+#include "protocols/Packet.hpp"
+
+class CaptureProfile;
+
+// Non-owning parse of a captured frame. It points into the buffer it was
+// built from, so it is only valid while that buffer is: for live capture,
+// until processBatch returns the frame to the kernel. Anything that keeps a
+// packet must call materialize().
+//
+// Layers are decoded lazily: constructing a view reads nothing, and each
+// layer is parsed the first time one of its fields is read, together with
+// the layers below it. Results are cached, so asking again is free. A
+// consumer that only reads addresses never touches the transport header.
+// Nothing here allocates.
+struct PacketView {
+    enum class Layer : uint8_t {
+        NONE,
+        LINK,           // Ethernet and VLAN tags
+        NETWORK,        // IPv4, IPv6 or ARP
+        TRANSPORT,      // TCP, UDP or ICMP
+        APPLICATION     // Port-based protocol classification
+    };
+
+    PacketView(const uint8_t* data, size_t caplen, size_t wire_length,
+               const struct timeval& timestamp);
+    PacketView(const uint8_t* data, size_t caplen, size_t wire_length,
+               std::chrono::system_clock::time_point timestamp);
+
+    // Copies the headers and as much payload as the profile allows for this
+    // flow into an owning Packet. Decodes every layer.
+    Packet materialize(const CaptureProfile* profile = nullptr) const;
+
+    // Decodes up to and including layer; a no-op for layers already done
+    void decode(Layer layer) const;
+    Layer getDecodedLayer() const { return decoded_; }
+
+    // Not decoded; known as soon as the view exists
+    const uint8_t* data;
+    size_t length;                      // Original length on the wire
+    size_t captured_length;             // Bytes readable at data
+    std::chrono::system_clock::time_point timestamp;
+    std::string_view interface;         // Must outlive the view
+    // What the capture backend reports about the transport checksum: the
+    // NIC or kernel already verified it, or it was left for offload
+    // (locally sent, CHECKSUM_PARTIAL) and the field isn't filled in yet
+    bool checksum_verified = false;
+    bool checksum_partial = false;
+
+    // Set on datagrams FragmentReassembler hands on: rebuilt from all of
+    // their fragments, or given up on with only the first header captured.
+    // An incomplete datagram counts as malformed from NETWORK up.
+    enum class Reassembly : uint8_t { NONE, COMPLETE, INCOMPLETE };
+    Reassembly reassembly = Reassembly::NONE;
+
+    // Application protocol StreamReassembler found in the connection's
+    // bytes. Overrides the port-based guess from APPLICATION up. Set on
+    // views that are otherwise passed on const, like the decoding state.
+    mutable Packet::Protocol stream_protocol = Packet::Protocol::UNKNOWN;
+    // Label of the payload signature the connection matched, if any
+    mutable std::string_view signature;
+    // Server name the connection's TLS ClientHello asked for, if any
+    mutable std::string_view server_name;
+
+    // Highest protocol identified at or below layer
+    Packet::Protocol getProtocol(Layer layer = Layer::APPLICATION) const;
+    // Whether a header at or below layer was truncated or invalid
+    bool isMalformed(Layer layer = Layer::APPLICATION) const;
+    // Whether the IPv4 header checksum or, from TRANSPORT up, the TCP, UDP
+    // or ICMP checksum is wrong. Computed on first call. Checksums that
+    // can't be checked (truncated capture, fragments, offloaded or absent
+    // UDP checksums) never count as bad.
+    bool hasBadChecksum(Layer layer = Layer::APPLICATION) const;
+
+    // Network layer. Addresses are empty for frames without IP or ARP ones.
+    Packet::Protocol getNetworkProtocol() const;
+    IpAddress sourceAddress() const;
+    IpAddress destinationAddress() const;
+    // True for a fragment and for a datagram reassembled from fragments
+    bool isFragmented() const;
+    uint8_t getTtl() const;
+    uint8_t getTos() const;
+    size_t getNetworkOffset() const;    // 0 when absent
+
+    // Where a fragment's data belongs in its datagram. Only filled in when
+    // the frame itself is a fragment.
+    struct Fragment {
+        uint32_t id = 0;
+        uint32_t offset = 0;            // Of this fragment's data in the datagram
+        bool more = false;              // Further fragments follow
+        uint8_t protocol = 0;           // Upper-layer protocol of the datagram
+        size_t data_offset = 0;         // Frame offsets of this fragment's data
+        size_t data_end = 0;
+        size_t next_header_offset = 0;  // IPv6: the Next Header byte naming the Fragment header
+    };
+    const Fragment& getFragment() const;
+
+    // Transport layer
+    enum TcpFlag : uint8_t {
+        TCP_FIN = 0x01,
+        TCP_SYN = 0x02,
+        TCP_RST = 0x04,
+        TCP_PSH = 0x08,
+        TCP_ACK = 0x10,
+        TCP_URG = 0x20
+    };
+    Packet::Protocol getTransportProtocol() const;
+    bool isTCP() const { return getTransportProtocol() == Packet::Protocol::TCP; }
+    bool isUDP() const { return getTransportProtocol() == Packet::Protocol::UDP; }
+    uint16_t getSourcePort() const;
+    uint16_t getDestinationPort() const;
+    uint32_t getSequenceNumber() const;
+    uint32_t getAcknowledgmentNumber() const;
+    uint16_t getWindowSize() const;
+    uint8_t getTcpFlags() const;        // TCP_* bits, 0 for other transports
+    size_t getTransportOffset() const;  // 0 when absent
+
+    // Payload of the deepest header found
+    size_t getPayloadOffset() const;
+    size_t getPayloadLength() const;    // Payload size on the wire
+
+private:
+    // Per-layer dispatch tables, see Dissectors.hpp
+    struct Dissectors;
+
+    void decodeLink() const;
+    void decodeNetwork() const;
+    void decodeTransport() const;
+    void decodeApplication() const;
+
+    void parseIPv4() const;
+    void parseIPv6() const;
+    void parseARP() const;
+    void parseTCP() const;
+    void parseUDP() const;
+    void parseICMP() const;
+    template <Packet::Protocol P>
+    void classify() const { application_protocol_ = P; }
+    void setPayload(size_t offset, size_t end) const;
+    void markMalformed(Layer layer) const;
+    IpAddress readAddress(size_t offset) const;
+
+    enum class ChecksumState : uint8_t {
+        UNCHECKED,
+        GOOD,
+        BAD,
+        SKIPPED         // Can't be verified from what was captured
+    };
+    ChecksumState checkNetworkChecksum() const;
+    ChecksumState checkTransportChecksum() const;
+
+    // Decoding state, filled in layer by layer
+    mutable Layer decoded_ = Layer::NONE;
+    mutable Layer malformed_ = Layer::NONE;     // First layer found broken
+
+    // Where the next layer's header starts and what it is
+    mutable size_t next_offset_ = 0;
+    mutable uint16_t ether_type_ = 0;
+    mutable uint8_t ip_protocol_ = 0;
+    mutable bool has_transport_ = false;        // False for non-first fragments
+    mutable size_t datagram_end_ = 0;
+
+    mutable Packet::Protocol link_protocol_ = Packet::Protocol::UNKNOWN;
+    mutable Packet::Protocol network_protocol_ = Packet::Protocol::UNKNOWN;
+    mutable Packet::Protocol transport_protocol_ = Packet::Protocol::UNKNOWN;
+    mutable Packet::Protocol application_protocol_ = Packet::Protocol::UNKNOWN;
+
+    mutable IpAddress::Family address_family_ = IpAddress::Family::NONE;
+    mutable size_t source_address_offset_ = 0;
+    mutable size_t destination_address_offset_ = 0;
+    mutable bool is_fragmented_ = false;
+    mutable Fragment fragment_;
+    mutable uint8_t ttl_ = 0;
+    mutable uint8_t tos_ = 0;
+
+    mutable uint16_t source_port_ = 0;
+    mutable uint16_t destination_port_ = 0;
+    mutable uint32_t sequence_number_ = 0;
+    mutable uint32_t acknowledgment_number_ = 0;
+    mutable uint16_t window_size_ = 0;
+    mutable uint8_t tcp_flags_ = 0;
+
+    mutable size_t network_offset_ = 0;
+    mutable size_t transport_offset_ = 0;
+    mutable size_t payload_offset_ = 0;
+    mutable size_t payload_length_ = 0;
+
+    mutable ChecksumState network_checksum_ = ChecksumState::UNCHECKED;
+    mutable ChecksumState transport_checksum_ = ChecksumState::UNCHECKED;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Finds which of a fixed set of byte strings occurs first in a buffer, in
+// one pass however many strings there are. Built once, then read-only, so
+// one matcher can be shared by every thread.
+//
+// Anchored strings only match at offset 0 and are looked up by their first
+// byte. The others are found by one of:
+//  - TEDDY: the SIMD literal search from Hyperscan. Every 16 (SSSE3) or 32
+//    (AVX2) positions are tested at once against nibble masks of the first
+//    bytes of up to TEDDY_MAX_PATTERNS strings, grouped into 8 buckets;
+//    only positions that pass are compared in full. Used when the CPU has
+//    SSSE3 and there are few enough strings.
+//  - AHO_CORASICK: a DFA over byte classes, one table lookup per byte
+//    whatever the number of strings. Used for large sets and without SIMD.
+//  - MEMMEM: memmem() once per string, kept as the reference to check and
+//    benchmark the others against.
+class PatternMatcher {
+public:
+    struct Pattern {
+        std::string bytes;
+        bool anchored = false;      // Only matches at offset 0
+    };
+
+    enum class Engine : uint8_t { AUTO, TEDDY, AHO_CORASICK, MEMMEM };
+
+    // Throws std::invalid_argument for an empty string
+    explicit PatternMatcher(std::vector<Pattern> patterns, Engine engine = Engine::AUTO);
+    ~PatternMatcher();
+
+    PatternMatcher(const PatternMatcher&) = delete;
+    PatternMatcher& operator=(const PatternMatcher&) = delete;
+
+    // Index of the match that starts first at or after from, the lowest
+    // index on a tie, or NO_MATCH. Anchored strings are checked whatever
+    // from is. Scanning only the bytes added to a buffer since the last
+    // call, from = old size - (getMaxLength() - 1), finds everything new.
+    size_t find(std::span<const uint8_t> data, size_t from = 0) const;
+
+    size_t size() const { return patterns_.size(); }
+    const Pattern& getPattern(size_t index) const { return patterns_[index]; }
+    size_t getMaxLength() const { return max_length_; }
+    bool hasFloating() const { return !floating_.empty(); }
+
+    // "teddy-avx2", "teddy-ssse3", "aho-corasick" or "memmem"
+    const char* getEngine() const;
+
+    static constexpr size_t NO_MATCH = SIZE_MAX;
+    static constexpr size_t TEDDY_MAX_PATTERNS = 64;
+
+    // Engine names as above, plus "auto" and "teddy". Throws
+    // std::invalid_argument for anything else.
+    static Engine engineFromString(const std::string& name);
+
+    // Engine tables, defined with the engines
+    struct Teddy;
+    struct AhoCorasick;
+
+private:
+    size_t findAnchored(std::span<const uint8_t> data) const;
+    size_t findMemmem(std::span<const uint8_t> data, size_t from, size_t& start) const;
+
+    std::vector<Pattern> patterns_;
+    std::array<std::vector<uint32_t>, 256> anchored_;    // By first byte, in index order
+    std::vector<uint32_t> floating_;                    // In index order
+    size_t max_length_ = 0;
+
+    Engine engine_ = Engine::MEMMEM;
+    std::unique_ptr<Teddy> teddy_;
+    std::unique_ptr<AhoCorasick> aho_corasick_;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// The server name (SNI, RFC 6066) and first ALPN protocol (RFC 7301) of a
+// TLS ClientHello, read in place. Every length is checked against what is
+// left of its enclosing field before it is used, and nothing is copied or
+// allocated; the results point into the parsed buffer.
+//
+// The ClientHello must start the buffer and sit in a single record, which
+// is how mainstream clients send it. One split over several records is
+// reported INVALID rather than stitched together.
+class TlsClientHello {
+public:
+    enum class Result : uint8_t {
+        COMPLETE,       // A whole ClientHello was read
+        INCOMPLETE,     // Consistent so far; more bytes are needed
+        INVALID         // Not a ClientHello, or malformed
+    };
+
+    Result parse(std::span<const uint8_t> data);
+
+    // Empty when the extension is absent or holds something other than a
+    // printable host name or protocol id
+    std::string_view getServerName() const { return server_name_; }
+    std::string_view getAlpn() const { return alpn_; }
+
+    // Length of the record holding the ClientHello, header included, once
+    // the header has been seen; 0 before
+    size_t getRecordLength() const { return record_length_; }
+
+    static constexpr size_t RECORD_HEADER_LENGTH = 5;
+    static constexpr size_t MAX_RECORD_LENGTH = 16384 + 2048;   // Plaintext limit plus expansion
+
+private:
+    std::string_view server_name_;
+    std::string_view alpn_;
+    size_t record_length_ = 0;
+};
@@ -4,33 +4,51 @@
 #include <vector>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <sqlite3.h>
+#include "analysis/Statistics.hpp"
+#include "protocols/IpAddress.hpp"
 #include "protocols/Packet.hpp"
+#include "utils/MpscRing.hpp"
 
 class DataStore {
 public:
-    DataStore(const std::string& db_path = "network_monitor.db");
+    DataStore(const std::string& db_path = "network_monitor.db",
+              size_t ring_depth = DEFAULT_RING_DEPTH);
     ~DataStore();
 
+    // Queues a packet for the writer thread. tryStore never blocks and
+    // counts an overflow when the ring is full; store waits for room.
+    bool tryStore(Packet&& packet);
+    void store(Packet&& packet);
     void store(const Packet& packet);
+
+    // Queues a finished connection for the flows table, without or with
+    // waiting for room as above
+    bool tryStoreFlow(FlowRecord&& flow);
+    void storeFlow(FlowRecord&& flow);
+
+    // Waits until every row queued before the call has been written
     void flush();
+
+    size_t getBacklog() const;   // Packets queued but not yet written
+    size_t getCapacity() const;
+    uint64_t getOverflows() const;
     void close();
 
     // Query methods
     std::vector<Packet> getPacketsByProtocol(Packet::Protocol protocol, size_t limit = 1000);
-    std::vector<Packet> getPacketsByHost(const std::string& host, size_t limit = 1000);
+    std::vector<Packet> getPacketsByHost(const IpAddress& host, size_t limit = 1000);
     std::vector<Packet> getPacketsByTimeRange(
         const std::chrono::system_clock::time_point& start,
         const std::chrono::system_clock::time_point& end,
         size_t limit = 1000
     );
     std::vector<Packet> getPacketsByConnection(
-        const std::string& source_host,
-        const std::string& dest_host,
+        const IpAddress& source_host,
+        const IpAddress& dest_host,
         size_t limit = 1000
     );
 
@@ -46,18 +64,25 @@ private:
     void createTables();
     void storeThread();
     void insertPacket(const Packet& packet);
-    void batchInsert();
+    void insertFlow(const FlowRecord& flow);
+    void batchInsert(std::vector<Packet>& batch, std::vector<FlowRecord>& flows);
     std::string protocolToString(Packet::Protocol protocol) const;
     Packet::Protocol stringToProtocol(const std::string& str) const;
 
     sqlite3* db_;
+    sqlite3_stmt* insert_stmt_ = nullptr;   // Prepared once, used by the writer thread
+    sqlite3_stmt* flow_insert_stmt_ = nullptr;
     std::string db_path_;
     std::atomic<bool> running_;
     std::thread store_thread_;
-    std::queue<Packet> packet_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
-    
+    MpscRing<Packet> packet_ring_;
+    MpscRing<FlowRecord> flow_ring_;
+    std::atomic<uint64_t> flush_requested_{0};    // flush() calls so far
+    std::atomic<uint64_t> flush_completed_{0};    // Of those, the last one written out
+
+    static constexpr size_t DEFAULT_RING_DEPTH = 65536;
+    static constexpr size_t FLOW_RING_DEPTH = 16384;
     static constexpr size_t BATCH_SIZE = 1000;
     static constexpr std::chrono::seconds FLUSH_INTERVAL{5};
+    static constexpr std::chrono::milliseconds IDLE_WAIT{1};
 }; 
\ No newline at end of file
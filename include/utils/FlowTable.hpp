@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash table for per-flow records, with Robin Hood probing:
+// an entry being placed takes the slot of any resident closer to its own
+// home slot, so probe sequences stay short even at 7/8 load. Each slot has
+// two bytes of metadata, its probe distance and eight bits of hash, which
+// are checked before a key is compared; keys and values sit in one flat
+// array beside it. Erasing shifts the rest of the run back instead of
+// leaving tombstones, so lookups never slow down as flows come and go.
+//
+// Key needs hash() and operator==, Value a default constructor. Inserting
+// and erasing move entries, so a pointer from find() only lasts until the
+// table next changes.
+//
+// Hashes that pile more than 255 entries onto one run make the table grow
+// while it is at least 1/8 full. Below that growing wouldn't help, so the
+// key being inserted is turned away and counted instead, which keeps
+// crafted collisions from exhausting memory. Entries already in the table
+// are never pushed out to make room.
+template <typename Key, typename Value>
+class FlowTable {
+public:
+    explicit FlowTable(size_t capacity = 0) {
+        rehash(capacityFor(capacity));
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return meta_.size(); }
+
+    // Bytes held by the slots, not counting anything a Value allocates
+    size_t memoryUsage() const { return meta_.size() * (sizeof(uint16_t) + sizeof(Entry)); }
+
+    Value* find(const Key& key) {
+        const size_t index = lookup(key);
+        return index != NONE ? &entries_[index].value : nullptr;
+    }
+
+    const Value* find(const Key& key) const {
+        const size_t index = lookup(key);
+        return index != NONE ? &entries_[index].value : nullptr;
+    }
+
+    // Value for key, default-constructed if it wasn't there. When key had
+    // to be turned away, a scratch value is returned that the table doesn't
+    // keep.
+    Value& findOrInsert(const Key& key) {
+        size_t index = lookup(key);
+        if (index == NONE) {
+            if ((size_ + 1) * 8 > capacity() * 7) {
+                rehash(capacity() * 2);
+            }
+            while (!fits(key.hash())) {
+                // A mostly empty table only gets here through colliding
+                // hashes, which no size fixes
+                if (size_ * 8 < capacity()) {
+                    ++dropped_;
+                    overflow_ = Value{};
+                    return overflow_;
+                }
+                rehash(capacity() * 2);
+            }
+            index = place(Entry{key, Value{}});
+            ++size_;
+        }
+        return entries_[index].value;
+    }
+
+    bool erase(const Key& key) {
+        const size_t index = lookup(key);
+        if (index == NONE) {
+            return false;
+        }
+        eraseAt(index);
+        return true;
+    }
+
+    // Erases the entries predicate(key, value) holds for, calling it once
+    // per entry; returns how many went
+    template <typename Predicate>
+    size_t eraseIf(Predicate predicate) {
+        if (size_ == 0) {
+            return 0;
+        }
+        // Start just after an empty slot, so no run wraps past the start
+        // and the entries shifted back by an erase are always still ahead
+        size_t index = 0;
+        while (meta_[index] != 0) {
+            ++index;
+        }
+        size_t erased = 0;
+        for (size_t visited = 0; visited < meta_.size(); ++visited) {
+            index = (index + 1) & mask_;
+            while (meta_[index] != 0 && predicate(entries_[index].key, entries_[index].value)) {
+                eraseAt(index);
+                ++erased;
+            }
+        }
+        return erased;
+    }
+
+    // function(key, value) for each entry, in no particular order
+    template <typename Function>
+    void forEach(Function function) const {
+        for (size_t i = 0; i < meta_.size(); ++i) {
+            if (meta_[i] != 0) {
+                function(entries_[i].key, entries_[i].value);
+            }
+        }
+    }
+
+    template <typename Function>
+    void forEach(Function function) {
+        for (size_t i = 0; i < meta_.size(); ++i) {
+            if (meta_[i] != 0) {
+                function(entries_[i].key, entries_[i].value);
+            }
+        }
+    }
+
+    // Keys turned away because their run was full
+    uint64_t getDropped() const { return dropped_; }
+
+    void clear() {
+        meta_.assign(meta_.size(), 0);
+        entries_.assign(entries_.size(), Entry{});
+        size_ = 0;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+
+    static constexpr size_t NONE = SIZE_MAX;
+    static constexpr size_t MIN_CAPACITY = 16;
+    static constexpr uint16_t MAX_DISTANCE = 0xff;
+
+    // Low byte: distance from the home slot plus one, 0 for an empty slot.
+    // High byte: top bits of the hash.
+    static uint16_t makeMeta(size_t hash) {
+        return static_cast<uint16_t>(((hash >> 24) & 0xff) << 8 | 1);
+    }
+    static uint16_t distanceOf(uint16_t meta) { return meta & 0xff; }
+
+    static size_t capacityFor(size_t entries) {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * 7 < entries * 8) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    size_t lookup(const Key& key) const {
+        const size_t hash = key.hash();
+        size_t index = hash & mask_;
+        uint16_t meta = makeMeta(hash);
+        for (;;) {
+            const uint16_t resident = meta_[index];
+            // An empty slot, or a resident nearer home than key would be,
+            // ends the run key could be in
+            if (distanceOf(resident) < distanceOf(meta)) {
+                return NONE;
+            }
+            if (resident == meta && entries_[index].key == key) {
+                return index;
+            }
+            if (distanceOf(meta) == MAX_DISTANCE) {
+                return NONE;
+            }
+            index = (index + 1) & mask_;
+            ++meta;
+        }
+    }
+
+    // Whether placing an entry with hash would leave every entry it
+    // displaces within MAX_DISTANCE of home. Walks the same slots place()
+    // would, carrying distances only.
+    bool fits(size_t hash) const {
+        size_t index = hash & mask_;
+        uint16_t distance = 1;
+        for (;;) {
+            const uint16_t resident = distanceOf(meta_[index]);
+            if (resident == 0) {
+                return true;
+            }
+            if (resident < distance) {
+                distance = resident;
+            }
+            index = (index + 1) & mask_;
+            if (distance == MAX_DISTANCE) {
+                return false;
+            }
+            ++distance;
+        }
+    }
+
+    // Only called once fits() holds for entry. Returns the slot entry
+    // landed in; size_ is left to the caller.
+    size_t place(Entry entry) {
+        size_t index = entry.key.hash() & mask_;
+        uint16_t meta = makeMeta(entry.key.hash());
+        size_t landed = NONE;
+        for (;;) {
+            uint16_t& resident = meta_[index];
+            if (resident == 0) {
+                resident = meta;
+                entries_[index] = std::move(entry);
+                return landed != NONE ? landed : index;
+            }
+            if (distanceOf(resident) < distanceOf(meta)) {
+                std::swap(resident, meta);
+                std::swap(entries_[index], entry);
+                if (landed == NONE) {
+                    landed = index;
+                }
+            }
+            index = (index + 1) & mask_;
+            ++meta;
+        }
+    }
+
+    void eraseAt(size_t index) {
+        size_t next = (index + 1) & mask_;
+        while (distanceOf(meta_[next]) > 1) {
+            meta_[index] = static_cast<uint16_t>(meta_[next] - 1);
+            entries_[index] = std::move(entries_[next]);
+            index = next;
+            next = (next + 1) & mask_;
+        }
+        meta_[index] = 0;
+        entries_[index] = Entry{};
+        --size_;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<uint16_t> meta(capacity, 0);
+        std::vector<Entry> entries(capacity);
+        meta.swap(meta_);
+        entries.swap(entries_);
+        mask_ = capacity - 1;
+        // Every entry is kept: any that won't fit at this size are placed
+        // once the table has grown further
+        std::vector<Entry> unplaced;
+        for (size_t i = 0; i < meta.size(); ++i) {
+            if (meta[i] != 0) {
+                if (fits(entries[i].key.hash())) {
+                    place(std::move(entries[i]));
+                } else {
+                    unplaced.push_back(std::move(entries[i]));
+                }
+            }
+        }
+        for (Entry& entry : unplaced) {
+            while (!fits(entry.key.hash())) {
+                rehash(meta_.size() * 2);
+            }
+            place(std::move(entry));
+        }
+    }
+
+    std::vector<uint16_t> meta_;
+    std::vector<Entry> entries_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    uint64_t dropped_ = 0;
+    Value overflow_{};
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size hash table of records kept in order of use, for the state a
+// capture thread holds per datagram, connection or query. Everything is
+// allocated up front: the slots, threaded on a free list while unused, and
+// twice as many hash buckets, each the head of a chain through the slots.
+// Slots in use are also linked from oldest to newest, so the owner can
+// expire them from the old end, and allocate() pushes out the oldest when
+// none is free.
+//
+// The table knows nothing of keys. The owner hashes its key to a bucket
+// with bucketOf(), looks through the bucket with find(), and keeps the key
+// in Entry. Slots are addressed by index and never move. Entries are not
+// reset on release, so allocate() hands back whatever the slot held last.
+template <typename Entry>
+class LruTable {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr size_t MAX_SIZE = size_t{1} << 31;   // So bucket indexes fit 32 bits
+
+    explicit LruTable(size_t capacity)
+        : slots_(std::clamp<size_t>(capacity, 1, MAX_SIZE))
+        , buckets_(std::bit_ceil(slots_.size() * 2), NONE)
+        , mask_(buckets_.size() - 1) {
+        for (uint32_t i = 0; i < slots_.size(); ++i) {
+            slots_[i].bucket_next = i + 1 < slots_.size() ? i + 1 : NONE;
+        }
+        free_ = 0;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+    bool full() const { return free_ == NONE; }
+
+    Entry& operator[](uint32_t index) { return slots_[index].entry; }
+    const Entry& operator[](uint32_t index) const { return slots_[index].entry; }
+
+    // Ends of the use order, NONE when the table is empty
+    uint32_t oldest() const { return oldest_; }
+    uint32_t newest() const { return newest_; }
+    uint32_t newer(uint32_t index) const { return slots_[index].newer; }
+
+    size_t bucketOf(uint64_t hash) const { return static_cast<size_t>(hash) & mask_; }
+
+    // First slot in bucket whose entry match(entry) holds for, or NONE
+    template <typename Match>
+    uint32_t find(size_t bucket, Match match) const {
+        for (uint32_t i = buckets_[bucket]; i != NONE; i = slots_[i].bucket_next) {
+            if (match(slots_[i].entry)) {
+                return i;
+            }
+        }
+        return NONE;
+    }
+
+    // Takes a slot into bucket as the newest. When none is free, first calls
+    // evict(oldest()), which has to release that slot.
+    template <typename Evict>
+    uint32_t allocate(size_t bucket, Evict evict) {
+        if (free_ == NONE) {
+            evict(oldest_);
+        }
+        const uint32_t index = free_;
+        Slot& slot = slots_[index];
+        free_ = slot.bucket_next;
+
+        slot.bucket = static_cast<uint32_t>(bucket);
+        slot.bucket_next = buckets_[bucket];
+        buckets_[bucket] = index;
+        link(index);
+        return index;
+    }
+
+    // Makes index the newest
+    void touch(uint32_t index) {
+        if (index != newest_) {
+            unlink(index);
+            link(index);
+        }
+    }
+
+    void release(uint32_t index) {
+        Slot& slot = slots_[index];
+        uint32_t* next = &buckets_[slot.bucket];
+        while (*next != index) {
+            next = &slots_[*next].bucket_next;
+        }
+        *next = slot.bucket_next;
+        unlink(index);
+
+        slot.bucket_next = free_;
+        free_ = index;
+    }
+
+private:
+    struct Slot {
+        Entry entry{};
+        uint32_t bucket = 0;
+        uint32_t bucket_next = NONE;    // Hash chain, or free list
+        uint32_t older = NONE;          // Use order
+        uint32_t newer = NONE;
+    };
+
+    void link(uint32_t index) {
+        Slot& slot = slots_[index];
+        slot.older = newest_;
+        slot.newer = NONE;
+        (newest_ != NONE ? slots_[newest_].newer : oldest_) = index;
+        newest_ = index;
+    }
+
+    void unlink(uint32_t index) {
+        const Slot& slot = slots_[index];
+        (slot.older != NONE ? slots_[slot.older].newer : oldest_) = slot.newer;
+        (slot.newer != NONE ? slots_[slot.newer].older : newest_) = slot.older;
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> buckets_;     // Head of each hash chain
+    size_t mask_;
+    uint32_t free_ = NONE;
+    uint32_t oldest_ = NONE;
+    uint32_t newest_ = NONE;
+};
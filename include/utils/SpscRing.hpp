@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+// Bounded single-producer / single-consumer queue. tryPush never blocks: when
+// the ring is full the element is rejected and counted as an overflow.
+// Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(roundUp(capacity))
+        , mask_(capacity_ - 1)
+        , slots_(new Slot[capacity_]) {
+    }
+
+    ~SpscRing() {
+        while (tryPop()) {
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side
+    bool tryPush(T&& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity_) {
+                overflows_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        new (slots_[tail & mask_].storage) T(std::move(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    std::optional<T> tryPop() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return std::nullopt;
+            }
+        }
+        T* slot = std::launder(reinterpret_cast<T*>(slots_[head & mask_].storage));
+        std::optional<T> value(std::move(*slot));
+        slot->~T();
+        head_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Approximate when read from a third thread
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+    uint64_t getOverflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static size_t roundUp(size_t value) {
+        size_t power = 2;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    // Producer and consumer indices on separate cache lines, each with a
+    // private copy of the other side's index to avoid re-reading it
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+    alignas(64) std::atomic<uint64_t> overflows_{0};
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// Totals over time at several resolutions at once, e.g. per second for the
+// last hour and per minute for the last day. Each level is a ring of
+// buckets allocated up front, so memory is fixed however long it runs. A
+// value goes into the current bucket of every level, which keeps each
+// coarse bucket the sum of the finer ones it spans, and each level keeps a
+// running total, so adding, moving on and averaging are all O(1) in the
+// length of the history.
+//
+// Buckets are aligned to the epoch, so two series cover the same buckets
+// and merge exactly. Stretches without values read as zero.
+class TimeSeries {
+public:
+    using TimePoint = std::chrono::system_clock::time_point;
+
+    struct Level {
+        std::chrono::seconds resolution;
+        size_t length;                  // Buckets kept
+    };
+
+    struct Bucket {
+        TimePoint start;
+        uint64_t total = 0;
+        std::chrono::seconds covered{0};    // Part of the bucket the series has been running
+    };
+
+    explicit TimeSeries(std::initializer_list<Level> levels) {
+        for (const Level& level : levels) {
+            rings_.push_back(Ring{std::max(level.resolution, std::chrono::seconds(1)),
+                                  std::vector<uint64_t>(std::max<size_t>(level.length, 1), 0)});
+        }
+    }
+
+    size_t getLevels() const { return rings_.size(); }
+    std::chrono::seconds getResolution(size_t level) const { return rings_[level].resolution; }
+
+    // Adds value at time on every level. Values older than a level reaches
+    // are left out of it.
+    void add(TimePoint time, uint64_t value) {
+        advance(time);
+        const int64_t second = toSeconds(time);
+        first_ = std::min(first_, second);
+        for (Ring& ring : rings_) {
+            const int64_t number = ring.numberOf(second);
+            if (number + static_cast<int64_t>(ring.buckets.size()) <= ring.latest) {
+                continue;
+            }
+            ring.buckets[ring.slotOf(number)] += value;
+            ring.total += value;
+        }
+    }
+
+    // Moves the series on to time without adding anything, clearing the
+    // buckets that fall out of each level. Costs one step per bucket
+    // passed, but never more than a level's length.
+    void advance(TimePoint time) {
+        const int64_t second = toSeconds(time);
+        if (!started_) {
+            started_ = true;
+            first_ = last_ = second;
+            for (Ring& ring : rings_) {
+                ring.latest = ring.numberOf(second);
+            }
+            return;
+        }
+        if (second <= last_) {
+            return;
+        }
+        last_ = second;
+        for (Ring& ring : rings_) {
+            ring.moveTo(ring.numberOf(second));
+        }
+    }
+
+    // Buckets of level the series has reached, oldest first, ending with
+    // the one last advanced to
+    std::vector<Bucket> getBuckets(size_t level) const {
+        std::vector<Bucket> buckets;
+        if (!started_) {
+            return buckets;
+        }
+        const Ring& ring = rings_[level];
+        const int64_t length = static_cast<int64_t>(ring.buckets.size());
+        const int64_t oldest = std::max(ring.latest - length + 1, ring.numberOf(first_));
+        buckets.reserve(static_cast<size_t>(ring.latest - oldest + 1));
+        for (int64_t number = oldest; number <= ring.latest; ++number) {
+            const int64_t start = number * ring.resolution.count();
+            const int64_t end = start + ring.resolution.count();
+            buckets.push_back(Bucket{
+                TimePoint(std::chrono::seconds(start)),
+                ring.buckets[ring.slotOf(number)],
+                std::chrono::seconds(std::min(end, last_ + 1) - std::max(start, first_))});
+        }
+        return buckets;
+    }
+
+    // Everything level holds, and the time that spans
+    uint64_t getTotal(size_t level) const { return rings_[level].total; }
+    std::chrono::seconds getCovered(size_t level) const {
+        if (!started_) {
+            return std::chrono::seconds(0);
+        }
+        const Ring& ring = rings_[level];
+        const int64_t length = static_cast<int64_t>(ring.buckets.size());
+        const int64_t start = std::max((ring.latest - length + 1) * ring.resolution.count(), first_);
+        return std::chrono::seconds(last_ + 1 - start);
+    }
+
+    // Adds in another series with the same levels, bucket by bucket
+    void merge(const TimeSeries& other) {
+        if (!other.started_ || other.rings_.size() != rings_.size()) {
+            return;
+        }
+        if (started_) {
+            advance(TimePoint(std::chrono::seconds(other.last_)));
+            first_ = std::min(first_, other.first_);
+        } else {
+            started_ = true;
+            first_ = other.first_;
+            last_ = other.last_;
+            for (size_t i = 0; i < rings_.size(); ++i) {
+                rings_[i].latest = other.rings_[i].latest;
+            }
+        }
+        for (size_t i = 0; i < rings_.size(); ++i) {
+            Ring& ring = rings_[i];
+            const Ring& from = other.rings_[i];
+            const int64_t length = static_cast<int64_t>(std::min(ring.buckets.size(), from.buckets.size()));
+            for (int64_t number = ring.latest - length + 1; number <= from.latest; ++number) {
+                if (number > from.latest - static_cast<int64_t>(from.buckets.size())) {
+                    const uint64_t value = from.buckets[from.slotOf(number)];
+                    ring.buckets[ring.slotOf(number)] += value;
+                    ring.total += value;
+                }
+            }
+        }
+    }
+
+    void clear() {
+        for (Ring& ring : rings_) {
+            std::fill(ring.buckets.begin(), ring.buckets.end(), 0);
+            ring.total = 0;
+            ring.latest = 0;
+        }
+        started_ = false;
+        first_ = last_ = 0;
+    }
+
+private:
+    struct Ring {
+        std::chrono::seconds resolution;
+        std::vector<uint64_t> buckets;
+        uint64_t total = 0;
+        int64_t latest = 0;         // Number of the newest bucket, counted from the epoch
+
+        int64_t numberOf(int64_t second) const {
+            const int64_t width = resolution.count();
+            return second >= 0 ? second / width : (second - width + 1) / width;
+        }
+        size_t slotOf(int64_t number) const {
+            const int64_t length = static_cast<int64_t>(buckets.size());
+            return static_cast<size_t>(((number % length) + length) % length);
+        }
+        void moveTo(int64_t number) {
+            const int64_t steps = std::min(number - latest, static_cast<int64_t>(buckets.size()));
+            for (int64_t i = 1; i <= steps; ++i) {
+                uint64_t& bucket = buckets[slotOf(latest + i)];
+                total -= bucket;
+                bucket = 0;
+            }
+            latest = std::max(latest, number);
+        }
+    };
+
+    static int64_t toSeconds(TimePoint time) {
+        return std::chrono::floor<std::chrono::seconds>(time.time_since_epoch()).count();
+    }
+
+    std::vector<Ring> rings_;
+    bool started_ = false;
+    int64_t first_ = 0;             // Seconds since the epoch the series spans
+    int64_t last_ = 0;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hierarchical timing wheel: four levels of 64 slots, each level's slot
+// spanning a whole turn of the level below, so with one-second ticks it
+// reaches 64^4 seconds (194 days) ahead. Scheduling is O(1), and advancing
+// touches one slot per tick plus, every 64 ticks, one slot of a higher
+// level whose timers move down a level; each timer moves at most three
+// times before it fires. Stretches where the lower levels are empty are
+// skipped a whole turn at a time, so a long jump in time stays cheap.
+//
+// Time only advances when advance() is called, so it can run on packet
+// timestamps rather than the wall clock. Timers fire at tick resolution and
+// never early, except ones set further ahead than the wheel reaches, which
+// fire at its far edge. There is no cancel: a caller that changes its mind
+// ignores the timer when it fires, or schedules it again from the callback.
+template <typename Key>
+class TimerWheel {
+public:
+    using TimePoint = std::chrono::system_clock::time_point;
+
+    explicit TimerWheel(std::chrono::system_clock::duration resolution = std::chrono::seconds(1))
+        : resolution_(resolution.count() > 0 ? resolution : std::chrono::seconds(1)) {
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Fires key from the first advance() to reach deadline. Deadlines
+    // already passed fire on the next tick.
+    void schedule(const Key& key, TimePoint deadline) {
+        if (!started_) {
+            start(deadline);
+        }
+        insert(Timer{key, std::max(toTick(deadline, true), now_ + 1)});
+        ++size_;
+    }
+
+    // Moves time forward to now, calling expired(key, time) for each timer
+    // that falls due, in deadline order to the tick; time is the tick it
+    // fired on. expired may schedule new timers. Time never goes back, so
+    // an earlier now is ignored.
+    template <typename Function>
+    void advance(TimePoint now, Function expired) {
+        const uint64_t target = toTick(now);
+        if (!started_) {
+            start(now);
+            return;
+        }
+        while (now_ < target) {
+            if (size_ == 0) {
+                now_ = target;      // Nothing to fire on the way
+                break;
+            }
+            // Nothing fires before the lowest level holding timers next
+            // turns over
+            size_t level = 0;
+            while (counts_[level] == 0) {
+                ++level;
+            }
+            if (level > 0) {
+                const uint64_t last = now_ | ((uint64_t{1} << (SLOT_BITS * level)) - 1);
+                if (last >= target) {
+                    now_ = target;
+                    break;
+                }
+                now_ = last;
+            }
+            ++now_;
+            cascade();
+            fire(expired);
+        }
+    }
+
+    // Tick time advance() last reached
+    TimePoint getTime() const {
+        return TimePoint(std::chrono::duration_cast<TimePoint::duration>(resolution_ * now_));
+    }
+
+    void clear() {
+        for (auto& level : levels_) {
+            for (auto& slot : level) {
+                slot.clear();
+            }
+        }
+        counts_.fill(0);
+        size_ = 0;
+        started_ = false;
+    }
+
+private:
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr uint64_t SPAN = uint64_t{1} << (SLOT_BITS * LEVELS);   // Ticks the wheel reaches
+
+    struct Timer {
+        Key key;
+        uint64_t deadline;      // In ticks
+    };
+
+    // Deadlines round up, so a timer never fires before its time
+    uint64_t toTick(TimePoint time, bool round_up = false) const {
+        const auto since = time.time_since_epoch();
+        if (since.count() <= 0) {
+            return 0;
+        }
+        return static_cast<uint64_t>(since / resolution_) +
+               (round_up && since % resolution_ != since.zero() ? 1 : 0);
+    }
+
+    void start(TimePoint now) {
+        now_ = toTick(now);
+        started_ = true;
+    }
+
+    // Files a timer by how far ahead it is; a deadline of now_ goes in the
+    // level-0 slot that is about to fire
+    void insert(Timer timer) {
+        timer.deadline = std::min(timer.deadline, now_ + SPAN - 1);
+        const uint64_t delta = timer.deadline - now_;
+        size_t level = 0;
+        while (level + 1 < LEVELS && delta >> (SLOT_BITS * (level + 1)) != 0) {
+            ++level;
+        }
+        levels_[level][(timer.deadline >> (SLOT_BITS * level)) & SLOT_MASK].push_back(std::move(timer));
+        ++counts_[level];
+    }
+
+    // When a level turns over, the next level's current slot holds the
+    // timers due within its span; spread them over the levels below
+    void cascade() {
+        for (size_t level = 1; level < LEVELS; ++level) {
+            if (((now_ >> (SLOT_BITS * (level - 1))) & SLOT_MASK) != 0) {
+                return;
+            }
+            auto& slot = levels_[level][(now_ >> (SLOT_BITS * level)) & SLOT_MASK];
+            scratch_.swap(slot);
+            counts_[level] -= scratch_.size();
+            for (Timer& timer : scratch_) {
+                insert(std::move(timer));
+            }
+            scratch_.clear();
+        }
+    }
+
+    template <typename Function>
+    void fire(Function& expired) {
+        auto& slot = levels_[0][now_ & SLOT_MASK];
+        if (slot.empty()) {
+            return;
+        }
+        // Swapped out first, since expired may schedule into this slot
+        std::vector<Timer> due;
+        due.swap(slot);
+        size_ -= due.size();
+        counts_[0] -= due.size();
+        const TimePoint time = getTime();
+        for (const Timer& timer : due) {
+            expired(timer.key, time);
+        }
+        // Hand the capacity back if nothing was scheduled meanwhile
+        if (slot.empty()) {
+            due.clear();
+            slot.swap(due);
+        }
+    }
+
+    std::chrono::system_clock::duration resolution_;
+    std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> levels_;
+    std::array<size_t, LEVELS> counts_{};      // Timers filed on each level
+    std::vector<Timer> scratch_;
+    uint64_t now_ = 0;          // Ticks since the epoch
+    size_t size_ = 0;
+    bool started_ = false;
+};
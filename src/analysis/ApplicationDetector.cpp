@@ -0,0 +1,97 @@
+#include "analysis/ApplicationDetector.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+constexpr uint16_t HTTPS_PORT = 443;
+constexpr uint8_t TLS_HANDSHAKE = 22;
+constexpr uint8_t TLS_CLIENT_HELLO = 1;
+constexpr uint8_t TLS_SERVER_HELLO = 2;
+
+constexpr std::string_view HTTP_METHODS[] = {
+    "GET ", "POST ", "HEAD ", "PUT ", "DELETE ", "OPTIONS ", "PATCH ", "CONNECT ", "TRACE "
+};
+constexpr std::string_view HTTP_STATUS = "HTTP/1.";
+constexpr std::string_view HTTP2_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// MAYBE while the stream is still too short to tell
+enum class Match : uint8_t { NO, MAYBE, YES };
+
+Match either(Match a, Match b) {
+    return std::max(a, b);
+}
+
+Match startsWith(std::span<const uint8_t> stream, std::string_view text) {
+    const size_t length = std::min(stream.size(), text.size());
+    if (std::memcmp(stream.data(), text.data(), length) != 0) {
+        return Match::NO;
+    }
+    return length == text.size() ? Match::YES : Match::MAYBE;
+}
+
+// A known method, then a target, then HTTP/1.x at the end of the line
+Match httpRequest(std::span<const uint8_t> stream) {
+    Match method = Match::NO;
+    for (const std::string_view name : HTTP_METHODS) {
+        method = either(method, startsWith(stream, name));
+    }
+    if (method != Match::YES) {
+        return method;
+    }
+
+    const auto newline = std::find(stream.begin(), stream.end(), '\n');
+    if (newline == stream.end()) {
+        return stream.size() < ApplicationDetector::MAX_LINE ? Match::MAYBE : Match::NO;
+    }
+    std::string_view line(reinterpret_cast<const char*>(stream.data()),
+                          static_cast<size_t>(newline - stream.begin()));
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    constexpr std::string_view version = " HTTP/1.";
+    return line.size() > version.size() &&
+           line.substr(line.size() - version.size() - 1, version.size()) == version
+        ? Match::YES : Match::NO;
+}
+
+// Record header (type, version 3.x, length) and the first handshake
+// message's type
+Match tlsHello(std::span<const uint8_t> stream) {
+    if ((stream.size() > 0 && stream[0] != TLS_HANDSHAKE) ||
+        (stream.size() > 1 && stream[1] != 3) ||
+        (stream.size() > 2 && stream[2] > 4)) {
+        return Match::NO;
+    }
+    if (stream.size() < 6) {
+        return Match::MAYBE;
+    }
+    return stream[5] == TLS_CLIENT_HELLO || stream[5] == TLS_SERVER_HELLO ? Match::YES : Match::NO;
+}
+
+} // namespace
+
+// Both directions are checked for everything: without the handshake the
+// reassembler can only guess which side is the client
+StreamAnalyzer::Verdict ApplicationDetector::onData(TcpFlow& flow, StreamDirection,
+                                                    std::span<const uint8_t> stream, size_t) {
+    if (flow.application != Packet::Protocol::UNKNOWN) {
+        return Verdict::DONE;
+    }
+
+    const Match http = either(either(httpRequest(stream), startsWith(stream, HTTP_STATUS)),
+                              startsWith(stream, HTTP2_PREFACE));
+    if (http == Match::YES) {
+        flow.application = Packet::Protocol::HTTP;
+        return Verdict::DONE;
+    }
+    const Match tls = tlsHello(stream);
+    if (tls == Match::YES) {
+        flow.application = flow.server_port == HTTPS_PORT || flow.client_port == HTTPS_PORT
+            ? Packet::Protocol::HTTPS : Packet::Protocol::TLS;
+        return Verdict::DONE;
+    }
+    return http == Match::MAYBE || tls == Match::MAYBE ? Verdict::MORE : Verdict::DONE;
+}
@@ -0,0 +1,53 @@
+#include "analysis/ClientHelloAnalyzer.hpp"
+#include "protocols/TlsClientHello.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::string_view HTTP_ALPN[] = {"h2", "http/1.1", "http/1.0"};
+
+// Lower-cases text into buffer, keeping the tail when it doesn't fit
+uint8_t copyName(std::string_view text, char* buffer, size_t capacity) {
+    if (text.size() > capacity) {
+        text.remove_prefix(text.size() - capacity);
+        const size_t dot = text.find('.');
+        if (dot != std::string_view::npos) {
+            text.remove_prefix(dot + 1);
+        }
+    }
+    std::transform(text.begin(), text.end(), buffer, [](char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+    return static_cast<uint8_t>(text.size());
+}
+
+} // namespace
+
+StreamAnalyzer::Verdict ClientHelloAnalyzer::onData(TcpFlow& flow, StreamDirection direction,
+                                                    std::span<const uint8_t> stream, size_t) {
+    // Without the handshake either side may be the client
+    if (direction != StreamDirection::CLIENT && !flow.midstream) {
+        return Verdict::DONE;
+    }
+
+    TlsClientHello hello;
+    switch (hello.parse(stream)) {
+        case TlsClientHello::Result::INCOMPLETE:
+            return Verdict::MORE;
+        case TlsClientHello::Result::INVALID:
+            return Verdict::DONE;
+        case TlsClientHello::Result::COMPLETE:
+            break;
+    }
+
+    flow.server_name_length = copyName(hello.getServerName(), flow.server_name, TcpFlow::MAX_SERVER_NAME);
+    if (hello.getAlpn().size() <= TcpFlow::MAX_ALPN) {
+        flow.alpn_length = copyName(hello.getAlpn(), flow.alpn, TcpFlow::MAX_ALPN);
+    }
+    if (flow.application == Packet::Protocol::TLS &&
+        std::find(std::begin(HTTP_ALPN), std::end(HTTP_ALPN), flow.getAlpn()) != std::end(HTTP_ALPN)) {
+        flow.application = Packet::Protocol::HTTPS;
+    }
+    return Verdict::DONE;
+}
@@ -0,0 +1,158 @@
+#include "analysis/SignatureAnalyzer.hpp"
+#include "config/ConfigManager.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t DEFAULT_DEPTH = 1024;
+
+// Application protocols a label can name
+constexpr Packet::Protocol LABELLED_PROTOCOLS[] = {
+    Packet::Protocol::HTTP, Packet::Protocol::HTTPS, Packet::Protocol::TLS,
+    Packet::Protocol::DNS, Packet::Protocol::DHCP
+};
+
+Packet::Protocol protocolForLabel(const std::string& label) {
+    for (const Packet::Protocol protocol : LABELLED_PROTOCOLS) {
+        const std::string name = Packet::getProtocolString(protocol);
+        if (std::equal(label.begin(), label.end(), name.begin(), name.end(),
+                       [](char a, char b) { return std::toupper(a) == std::toupper(b); })) {
+            return protocol;
+        }
+    }
+    return Packet::Protocol::UNKNOWN;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    return text;
+}
+
+// Splits on commas that aren't escaped
+std::vector<std::string_view> splitList(std::string_view text) {
+    std::vector<std::string_view> items;
+    size_t begin = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\') {
+            ++i;
+        } else if (text[i] == ',') {
+            items.push_back(trim(text.substr(begin, i - begin)));
+            begin = i + 1;
+        }
+    }
+    items.push_back(trim(text.substr(std::min(begin, text.size()))));
+    return items;
+}
+
+} // namespace
+
+SignatureAnalyzer::SignatureAnalyzer(std::shared_ptr<const Signatures> signatures)
+    : signatures_(std::move(signatures)) {
+}
+
+PatternMatcher::Pattern SignatureAnalyzer::parsePattern(std::string_view text) {
+    PatternMatcher::Pattern pattern;
+    if (!text.empty() && text.front() == '^') {
+        pattern.anchored = true;
+        text.remove_prefix(1);
+    }
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\') {
+            pattern.bytes += text[i];
+            continue;
+        }
+        if (i + 1 < text.size() && (text[i + 1] == '\\' || text[i + 1] == ',' || text[i + 1] == '^')) {
+            pattern.bytes += text[++i];
+        } else if (i + 3 < text.size() && text[i + 1] == 'x' &&
+                   hexDigit(text[i + 2]) >= 0 && hexDigit(text[i + 3]) >= 0) {
+            pattern.bytes += static_cast<char>(hexDigit(text[i + 2]) * 16 + hexDigit(text[i + 3]));
+            i += 3;
+        } else {
+            throw std::runtime_error("Bad escape in signature '" + std::string(text) + "'");
+        }
+    }
+    if (pattern.bytes.empty()) {
+        throw std::runtime_error("Empty signature");
+    }
+    return pattern;
+}
+
+std::shared_ptr<const SignatureAnalyzer::Signatures> SignatureAnalyzer::fromConfig() {
+    auto& config = ConfigManager::getInstance();
+
+    // Sorted so that ties between labels don't depend on hash order
+    std::vector<std::string> labels = config.getKeys("signatures");
+    std::sort(labels.begin(), labels.end());
+
+    std::vector<PatternMatcher::Pattern> patterns;
+    std::vector<std::string> pattern_labels;
+    for (const std::string& label : labels) {
+        // As written: the typed getters would read "12345" or "1.0" as numbers
+        const std::string value = config.getRawString("signatures", label).value_or("");
+        for (const std::string_view item : splitList(value)) {
+            try {
+                patterns.push_back(parsePattern(item));
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error("[signatures] " + label + ": " + e.what());
+            }
+            pattern_labels.push_back(label);
+        }
+    }
+    if (patterns.empty()) {
+        return nullptr;
+    }
+
+    PatternMatcher::Engine engine;
+    try {
+        engine = PatternMatcher::engineFromString(
+            config.getString("analysis", "signature_engine").value_or("auto"));
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error(std::string("[analysis] signature_engine: ") + e.what());
+    }
+    auto signatures = std::make_shared<Signatures>(std::move(patterns), engine);
+    signatures->labels = std::move(pattern_labels);
+    for (const std::string& label : signatures->labels) {
+        signatures->protocols.push_back(protocolForLabel(label));
+    }
+    signatures->depth = static_cast<size_t>(std::max(1,
+        config.getInt("analysis", "signature_depth").value_or(static_cast<int>(DEFAULT_DEPTH))));
+    return signatures;
+}
+
+StreamAnalyzer::Verdict SignatureAnalyzer::onData(TcpFlow& flow, StreamDirection,
+                                                  std::span<const uint8_t> stream, size_t fresh) {
+    const Signatures& signatures = *signatures_;
+    const PatternMatcher& matcher = signatures.matcher;
+    if (!flow.signature.empty()) {
+        return Verdict::DONE;
+    }
+
+    const size_t searched = stream.size() - fresh;
+    const std::span<const uint8_t> window = stream.first(std::min(stream.size(), signatures.depth));
+    const size_t overlap = matcher.getMaxLength() - 1;
+    const size_t found = matcher.find(window, searched > overlap ? searched - overlap : 0);
+    if (found != PatternMatcher::NO_MATCH) {
+        flow.signature = signatures.labels[found];
+        if (flow.application == Packet::Protocol::UNKNOWN) {
+            flow.application = signatures.protocols[found];
+        }
+        return Verdict::DONE;
+    }
+
+    // With only anchored strings, nothing can match once the longest would
+    // have fitted
+    const bool settled = stream.size() >= signatures.depth ||
+        (!matcher.hasFloating() && stream.size() >= matcher.getMaxLength());
+    return settled ? Verdict::DONE : Verdict::MORE;
+}
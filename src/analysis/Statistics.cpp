@@ -1,91 +1,531 @@
 #include "analysis/Statistics.hpp"
 #include <algorithm>
-#include <sstream>
-#include <iomanip>
+#include <bit>
+
+namespace {
+
+void mergeProtocolStats(ProtocolStats& into, const ProtocolStats& from) {
+    if (from.packet_count == 0) {
+        return;
+    }
+    if (into.packet_count == 0 || from.first_seen < into.first_seen) {
+        into.first_seen = from.first_seen;
+    }
+    into.last_seen = std::max(into.last_seen, from.last_seen);
+    into.packet_count += from.packet_count;
+    into.byte_count += from.byte_count;
+    into.error_count += from.error_count;
+}
+
+void mergeDnsResolverStats(DnsResolverStats& into, const DnsResolverStats& from) {
+    into.queries += from.queries;
+    into.responses += from.responses;
+    into.timeouts += from.timeouts;
+    for (size_t i = 0; i < into.rcodes.size(); ++i) {
+        into.rcodes[i] += from.rcodes[i];
+    }
+    for (size_t i = 0; i < into.latency.size(); ++i) {
+        into.latency[i] += from.latency[i];
+    }
+    into.total_latency += from.total_latency;
+    into.max_latency = std::max(into.max_latency, from.max_latency);
+    into.last_seen = std::max(into.last_seen, from.last_seen);
+}
+
+// The limit entries with the most packets out of those visit() offers, in
+// no particular order. One pass with a min-heap, so the quietest entry
+// kept is always on top.
+template <typename Key, typename Stats, typename Visit>
+std::vector<std::pair<const Key*, const Stats*>> findBusiest(size_t limit, Visit visit) {
+    using Entry = std::pair<const Key*, const Stats*>;
+    auto quieter = [](const Entry& a, const Entry& b) {
+        return a.second->packet_count > b.second->packet_count;
+    };
+    std::vector<Entry> busiest;
+    busiest.reserve(limit);
+    visit([&](const Key& key, const Stats& stats) {
+        if (busiest.size() < limit) {
+            busiest.emplace_back(&key, &stats);
+            std::push_heap(busiest.begin(), busiest.end(), quieter);
+        } else if (limit > 0 && stats.packet_count > busiest.front().second->packet_count) {
+            std::pop_heap(busiest.begin(), busiest.end(), quieter);
+            busiest.back() = Entry(&key, &stats);
+            std::push_heap(busiest.begin(), busiest.end(), quieter);
+        }
+    });
+    return busiest;
+}
+
+// Only builds a std::string key the first time an entry is seen
+template <typename T>
+T& findOrInsert(StringKeyMap<T>& map, std::string_view key) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+        it = map.emplace(std::string(key), T{}).first;
+    }
+    return it->second;
+}
+
+} // namespace
+
+std::chrono::microseconds DnsResolverStats::getBucketLimit(size_t bucket) {
+    return LATENCY_BASE * (1 << std::min(bucket, LATENCY_BUCKETS - 2));
+}
+
+size_t DnsResolverStats::getBucket(std::chrono::nanoseconds latency) {
+    size_t bucket = 0;
+    while (bucket + 1 < LATENCY_BUCKETS && latency >= getBucketLimit(bucket)) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+std::chrono::microseconds DnsResolverStats::getLatencyPercentile(double fraction) const {
+    const double wanted = fraction * static_cast<double>(responses);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+        seen += latency[bucket];
+        if (seen > 0 && static_cast<double>(seen) >= wanted) {
+            return getBucketLimit(bucket);
+        }
+    }
+    return std::chrono::microseconds::zero();
+}
+
+std::chrono::nanoseconds DnsResolverStats::getMeanLatency() const {
+    return responses ? total_latency / static_cast<int64_t>(responses) : std::chrono::nanoseconds::zero();
+}
 
 Statistics::Statistics()
-    : last_bandwidth_update_(std::chrono::system_clock::now()) {
+    : bandwidth_second_(std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now())) {
+}
+
+Statistics::Statistics(const Statistics& other) {
+    *this = other;
+}
+
+Statistics& Statistics::operator=(const Statistics& other) {
+    assignSnapshot(other, SIZE_MAX);
+    return *this;
+}
+
+void Statistics::assignSnapshot(const Statistics& other, size_t entries) {
+    if (this == &other) {
+        return;
+    }
+    std::scoped_lock lock(mutex_, other.mutex_);
+
+    total_packets_ = other.total_packets_.load();
+    total_bytes_ = other.total_bytes_.load();
+    total_errors_ = other.total_errors_.load();
+    estimated_ = other.estimated_;
+    depth_ = other.depth_;
+    verify_checksums_ = other.verify_checksums_;
+    current_bandwidth_ = other.current_bandwidth_.load();
+    average_bandwidth_ = other.average_bandwidth_.load();
+
+    protocol_stats_ = other.protocol_stats_;
+    interface_stats_ = other.interface_stats_;
+    interface_names_ = other.interface_names_;
+    signature_stats_ = other.signature_stats_;
+    service_stats_ = other.service_stats_;
+    connection_timeout_ = other.connection_timeout_;
+    dns_stats_ = other.dns_stats_;
+    bandwidth_history_ = other.bandwidth_history_;
+    bandwidth_second_ = other.bandwidth_second_;
+
+    if (other.host_stats_.size() <= entries) {
+        host_stats_ = other.host_stats_;
+    } else {
+        host_stats_.clear();
+        for (const auto& [host, stats] : findBusiest<IpAddress, HostStats>(entries, [&other](auto offer) {
+                 for (const auto& [host, stats] : other.host_stats_) {
+                     offer(host, stats);
+                 }
+             })) {
+            host_stats_.emplace(*host, *stats);
+        }
+    }
+
+    omitted_connections_ = other.omitted_connections_;
+    if (other.connection_stats_.size() <= entries) {
+        connection_stats_ = other.connection_stats_;
+    } else {
+        connection_stats_.clear();
+        for (const auto& [connection, stats] : findBusiest<FlowKey, ConnectionStats>(entries, [&other](auto offer) {
+                 other.connection_stats_.forEach(offer);
+             })) {
+            connection_stats_.findOrInsert(*connection) = *stats;
+        }
+        omitted_connections_ += other.connection_stats_.size() - connection_stats_.size();
+    }
+}
+
+void Statistics::merge(const Statistics& other) {
+    if (this == &other) {
+        return;
+    }
+    std::scoped_lock lock(mutex_, other.mutex_);
+
+    total_packets_ += other.total_packets_.load();
+    total_bytes_ += other.total_bytes_.load();
+    total_errors_ += other.total_errors_.load();
+    estimated_ = estimated_ || other.estimated_;
+    // Current is only summed over instances counting the same second; a
+    // value from an earlier one is stale
+    const double other_current = other.current_bandwidth_.load();
+    if (other_current > 0.0) {
+        if (current_bandwidth_.load() == 0.0 || other.bandwidth_second_ > bandwidth_second_) {
+            current_bandwidth_ = other_current;
+            bandwidth_second_ = other.bandwidth_second_;
+        } else if (other.bandwidth_second_ == bandwidth_second_) {
+            current_bandwidth_ += other_current;
+        }
+    }
+    omitted_connections_ += other.omitted_connections_;
+
+    for (const auto& [protocol, stats] : other.protocol_stats_) {
+        mergeProtocolStats(protocol_stats_[protocol], stats);
+    }
+
+    for (const auto& [interface, stats] : other.interface_stats_) {
+        mergeProtocolStats(interface_stats_[interface], stats);
+    }
+
+    for (const auto& [label, stats] : other.signature_stats_) {
+        mergeProtocolStats(signature_stats_[label], stats);
+    }
+
+    for (const auto& [name, stats] : other.service_stats_) {
+        mergeProtocolStats(service_stats_[name], stats);
+    }
+
+    // Renumbers other's interface bits into ours; workers given the same
+    // interface list map each bit to itself
+    std::array<uint64_t, MAX_INTERFACES> interface_bits{};
+    for (size_t i = 0; i < other.interface_names_.size(); ++i) {
+        interface_bits[i] = interfaceBit(other.interface_names_[i]);
+    }
+    auto renumber = [&interface_bits](uint64_t interfaces) {
+        uint64_t renumbered = 0;
+        for (; interfaces != 0; interfaces &= interfaces - 1) {
+            renumbered |= interface_bits[std::countr_zero(interfaces)];
+        }
+        return renumbered;
+    };
+
+    for (const auto& [host, stats] : other.host_stats_) {
+        auto& into = host_stats_[host];
+        if (into.packet_count == 0 || stats.first_seen < into.first_seen) {
+            into.first_seen = stats.first_seen;
+        }
+        into.last_seen = std::max(into.last_seen, stats.last_seen);
+        into.packet_count += stats.packet_count;
+        into.byte_count += stats.byte_count;
+        for (const auto& [protocol, protocol_stats] : stats.protocol_stats) {
+            mergeProtocolStats(into.protocol_stats[protocol], protocol_stats);
+        }
+        into.interfaces |= renumber(stats.interfaces);
+    }
+
+    for (const auto& [resolver, stats] : other.dns_stats_) {
+        mergeDnsResolverStats(dns_stats_[resolver], stats);
+    }
+
+    // Flow-hash sharding keeps a connection on one worker, but sum anyway
+    other.connection_stats_.forEach([this, &renumber](const FlowKey& connection, const ConnectionStats& stats) {
+        auto& into = connection_stats_.findOrInsert(connection);
+        if (into.packet_count == 0 || stats.start_time < into.start_time) {
+            into.start_time = stats.start_time;
+        }
+        into.last_seen = std::max(into.last_seen, stats.last_seen);
+        into.packet_count += stats.packet_count;
+        into.byte_count += stats.byte_count;
+        into.tcp.merge(stats.tcp);
+        into.interfaces |= renumber(stats.interfaces);
+        into.is_active = into.is_active || stats.is_active;
+    });
+
+    // Buckets sit on whole seconds of the clock, so shards line up exactly
+    bandwidth_history_.merge(other.bandwidth_history_);
+    const auto covered = bandwidth_history_.getCovered(0);
+    average_bandwidth_ = covered.count() > 0
+        ? static_cast<double>(bandwidth_history_.getTotal(0)) / static_cast<double>(covered.count())
+        : 0.0;
+}
+
+void Statistics::update(const PacketView& packet, uint32_t weight) {
+    // Every field read below decodes at most down to depth_
+    const IpAddress source = packet.sourceAddress();
+    const IpAddress destination = packet.destinationAddress();
+    const auto now = std::chrono::system_clock::now();
+
+    const auto lock = lockForUpdate();
+
+    // First, so a packet arriving after its connection timed out starts a
+    // new one
+    expire(packet.timestamp);
+
+    // Only ever written by the updating thread, so a plain load and store
+    // is enough and avoids a locked add
+    total_packets_.store(total_packets_.load(std::memory_order_relaxed) + weight,
+                         std::memory_order_relaxed);
+    total_bytes_.store(total_bytes_.load(std::memory_order_relaxed) +
+                       static_cast<uint64_t>(packet.length) * weight, std::memory_order_relaxed);
+    estimated_ = estimated_ || weight > 1;
+
+    updateProtocolStats(packet, weight);
+    updateInterfaceStats(packet, weight);
+    if (depth_ >= PacketView::Layer::APPLICATION) {
+        updateSignatureStats(packet, weight);
+        updateServiceStats(packet, weight);
+    }
+    // Looked up once for both hosts and the connection
+    const uint64_t interface = interfaceBit(packet.interface);
+    updateHostStats(packet, source, destination, interface, weight);
+    if (depth_ >= PacketView::Layer::TRANSPORT) {
+        updateConnectionStats(packet, source, destination, interface);
+    }
+    updateBandwidthStats(packet, weight, now);
+    updateErrorStats(packet, weight);
+}
+
+void Statistics::update(const Packet& packet, uint32_t weight) {
+    update(packet.view(), weight);
 }
 
-void Statistics::update(const Packet& packet) {
+void Statistics::setDepth(PacketView::Layer depth) {
+    const auto lock = lockForUpdate();
+    depth_ = std::clamp(depth, PacketView::Layer::NETWORK, PacketView::Layer::APPLICATION);
+}
+
+PacketView::Layer Statistics::getDepth() const {
     std::lock_guard<std::mutex> lock(mutex_);
+    return depth_;
+}
 
-    total_packets_++;
-    total_bytes_ += packet.length;
+void Statistics::setChecksumValidation(bool enabled) {
+    const auto lock = lockForUpdate();
+    verify_checksums_ = enabled;
+}
 
-    updateProtocolStats(packet);
-    updateHostStats(packet);
-    updateConnectionStats(packet);
-    updateBandwidthStats(packet);
-    updateErrorStats(packet);
+void Statistics::setConnectionTimeout(std::chrono::seconds timeout) {
+    const auto lock = lockForUpdate();
+    connection_timeout_ = std::max(timeout, std::chrono::seconds(1));
+}
 
-    cleanupInactiveConnections();
+void Statistics::setFlowRecordHandler(FlowRecordHandler handler) {
+    const auto lock = lockForUpdate();
+    flow_record_handler_ = std::move(handler);
 }
 
-void Statistics::reset() {
+void Statistics::setInterfaces(const std::vector<std::string>& names) {
+    const auto lock = lockForUpdate();
+    for (const auto& name : names) {
+        interfaceBit(name);
+    }
+}
+
+std::vector<std::string> Statistics::getInterfaceNames(uint64_t interfaces) const {
     std::lock_guard<std::mutex> lock(mutex_);
+    return interfaceNames(interfaces);
+}
+
+std::vector<std::string> Statistics::interfaceNames(uint64_t interfaces) const {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < interface_names_.size(); ++i) {
+        if (interfaces & (uint64_t{1} << i)) {
+            names.push_back(interface_names_[i]);
+        }
+    }
+    return names;
+}
+
+// Numbers interface the first time it is seen; 0 once every bit is taken
+uint64_t Statistics::interfaceBit(std::string_view interface) {
+    if (interface.empty()) {
+        return 0;
+    }
+    auto it = std::find(interface_names_.begin(), interface_names_.end(), interface);
+    if (it == interface_names_.end()) {
+        if (interface_names_.size() == MAX_INTERFACES) {
+            return 0;
+        }
+        it = interface_names_.emplace(interface_names_.end(), interface);
+    }
+    return uint64_t{1} << (it - interface_names_.begin());
+}
+
+FlowRecord Statistics::makeFlowRecord(const FlowKey& connection, ConnectionStats&& stats) const {
+    std::vector<std::string> interfaces = interfaceNames(stats.interfaces);
+    return FlowRecord{connection, std::move(stats), std::move(interfaces)};
+}
+
+void Statistics::expireConnections(std::chrono::system_clock::time_point now) {
+    const auto lock = lockForUpdate();
+    expire(now);
+}
+
+void Statistics::advanceBandwidth(std::chrono::system_clock::time_point now) {
+    const auto lock = lockForUpdate();
+    rollBandwidth(now);
+}
+
+void Statistics::flushConnections() {
+    const auto lock = lockForUpdate();
+    if (!flow_record_handler_) {
+        return;
+    }
+    connection_stats_.forEach([this](const FlowKey& connection, const ConnectionStats& stats) {
+        flow_record_handler_(makeFlowRecord(connection, ConnectionStats(stats)));
+    });
+}
+
+void Statistics::setLocking(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    locking_ = enabled;
+}
+
+std::unique_lock<std::mutex> Statistics::lockForUpdate() const {
+    return locking_ ? std::unique_lock<std::mutex>(mutex_) : std::unique_lock<std::mutex>();
+}
+
+// Both results are cached in the view, so each update pays for them once
+bool Statistics::hasError(const PacketView& packet) const {
+    return packet.isMalformed(depth_) || (verify_checksums_ && packet.hasBadChecksum(depth_));
+}
+
+void Statistics::reset() {
+    const auto lock = lockForUpdate();
     
     total_packets_ = 0;
     total_bytes_ = 0;
     total_errors_ = 0;
+    estimated_ = false;
     current_bandwidth_ = 0.0;
     average_bandwidth_ = 0.0;
     
     protocol_stats_.clear();
+    interface_stats_.clear();
+    signature_stats_.clear();
+    service_stats_.clear();
     host_stats_.clear();
     connection_stats_.clear();
+    connection_timers_.clear();
+    omitted_connections_ = 0;
+    dns_stats_.clear();
     bandwidth_history_.clear();
     
-    last_bandwidth_update_ = std::chrono::system_clock::now();
+    bandwidth_second_ = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
 }
 
-void Statistics::updateProtocolStats(const Packet& packet) {
-    auto& stats = protocol_stats_[packet.protocol];
-    stats.packet_count++;
-    stats.byte_count += packet.length;
-    
-    if (packet.is_malformed) {
-        stats.error_count++;
+void Statistics::updateProtocolStats(const PacketView& packet, uint32_t weight) {
+    auto& stats = protocol_stats_[packet.getProtocol(depth_)];
+    const bool first = stats.packet_count == 0;
+    stats.packet_count += weight;
+    stats.byte_count += static_cast<uint64_t>(packet.length) * weight;
+    
+    if (hasError(packet)) {
+        stats.error_count += weight;
     }
     
-    if (stats.packet_count == 1) {
+    if (first) {
+        stats.first_seen = packet.timestamp;
+    }
+    stats.last_seen = packet.timestamp;
+}
+
+void Statistics::updateInterfaceStats(const PacketView& packet, uint32_t weight) {
+    if (packet.interface.empty()) {
+        return;
+    }
+
+    auto& stats = findOrInsert(interface_stats_, packet.interface);
+    if (stats.packet_count == 0) {
         stats.first_seen = packet.timestamp;
     }
+    stats.packet_count += weight;
+    stats.byte_count += static_cast<uint64_t>(packet.length) * weight;
+    if (hasError(packet)) {
+        stats.error_count += weight;
+    }
+    stats.last_seen = packet.timestamp;
+}
+
+void Statistics::updateSignatureStats(const PacketView& packet, uint32_t weight) {
+    if (packet.signature.empty()) {
+        return;
+    }
+
+    auto& stats = findOrInsert(signature_stats_, packet.signature);
+    if (stats.packet_count == 0) {
+        stats.first_seen = packet.timestamp;
+    }
+    stats.packet_count += weight;
+    stats.byte_count += static_cast<uint64_t>(packet.length) * weight;
+    if (hasError(packet)) {
+        stats.error_count += weight;
+    }
     stats.last_seen = packet.timestamp;
 }
 
-void Statistics::updateHostStats(const Packet& packet) {
-    auto updateHost = [this, &packet](const std::string& host) {
+void Statistics::updateServiceStats(const PacketView& packet, uint32_t weight) {
+    if (packet.server_name.empty()) {
+        return;
+    }
+
+    auto& stats = findOrInsert(service_stats_, packet.server_name);
+    if (stats.packet_count == 0) {
+        stats.first_seen = packet.timestamp;
+    }
+    stats.packet_count += weight;
+    stats.byte_count += static_cast<uint64_t>(packet.length) * weight;
+    if (hasError(packet)) {
+        stats.error_count += weight;
+    }
+    stats.last_seen = packet.timestamp;
+}
+
+void Statistics::updateHostStats(const PacketView& packet, const IpAddress& source,
+                                 const IpAddress& destination, uint64_t interface, uint32_t weight) {
+    const uint64_t bytes = static_cast<uint64_t>(packet.length) * weight;
+    auto updateHost = [this, &packet, interface, weight, bytes](const IpAddress& host) {
         auto& stats = host_stats_[host];
-        stats.packet_count++;
-        stats.byte_count += packet.length;
-        
-        if (stats.packet_count == 1) {
+        if (stats.packet_count == 0) {
             stats.first_seen = packet.timestamp;
         }
+        stats.packet_count += weight;
+        stats.byte_count += bytes;
         stats.last_seen = packet.timestamp;
+        stats.interfaces |= interface;
         
-        auto& protocol_stats = stats.protocol_stats[packet.protocol];
-        protocol_stats.packet_count++;
-        protocol_stats.byte_count += packet.length;
+        auto& protocol_stats = stats.protocol_stats[packet.getProtocol(depth_)];
+        const bool first = protocol_stats.packet_count == 0;
+        protocol_stats.packet_count += weight;
+        protocol_stats.byte_count += bytes;
         
-        if (protocol_stats.packet_count == 1) {
+        if (first) {
             protocol_stats.first_seen = packet.timestamp;
         }
         protocol_stats.last_seen = packet.timestamp;
     };
     
-    updateHost(packet.source_address);
-    updateHost(packet.destination_address);
+    updateHost(source);
+    updateHost(destination);
 }
 
-void Statistics::updateConnectionStats(const Packet& packet) {
-    if (!packet.isTCP() && !packet.isUDP()) {
+void Statistics::updateConnectionStats(const PacketView& packet, const IpAddress& source,
+                                       const IpAddress& destination, uint64_t interface) {
+    const bool tcp = packet.isTCP();
+    if (!tcp && !packet.isUDP()) {
         return;
     }
     
-    std::string connection_id = generateConnectionId(packet);
-    auto& stats = connection_stats_[connection_id];
+    const uint16_t source_port = packet.getSourcePort();
+    const uint16_t destination_port = packet.getDestinationPort();
+    const FlowKey connection(source, source_port, destination, destination_port,
+                             tcp ? Packet::Protocol::TCP : Packet::Protocol::UDP);
+    auto& stats = connection_stats_.findOrInsert(connection);
     
     stats.packet_count++;
     stats.byte_count += packet.length;
@@ -93,77 +533,76 @@ void Statistics::updateConnectionStats(const Packet& packet) {
     if (stats.packet_count == 1) {
         stats.start_time = packet.timestamp;
         stats.is_active = true;
+        // Unless the table had to drop it, in which case stats is scratch
+        if (connection_stats_.find(connection) == &stats) {
+            connection_timers_.schedule(connection, packet.timestamp + connection_timeout_);
+        }
     }
     stats.last_seen = packet.timestamp;
+    stats.interfaces |= interface;
     
-    // Detect retransmissions for TCP
-    if (packet.isTCP()) {
-        // Simple retransmission detection based on sequence numbers
-        // This is a basic implementation and might need improvement
-        static std::unordered_map<std::string, uint32_t> last_seq;
-        if (last_seq.count(connection_id) && packet.sequence_number == last_seq[connection_id]) {
-            stats.retransmission_count++;
-        }
-        last_seq[connection_id] = packet.sequence_number;
+    if (tcp) {
+        stats.tcp.update(packet, FlowKey::isForward(source, source_port, destination, destination_port)
+                                     ? TcpAnalyzer::Side::FIRST : TcpAnalyzer::Side::SECOND);
     }
 }
 
-void Statistics::updateBandwidthStats(const Packet& packet) {
-    auto now = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_bandwidth_update_).count();
+void Statistics::updateBandwidthStats(const PacketView& packet, uint32_t weight,
+                                      std::chrono::system_clock::time_point now) {
+    rollBandwidth(now);
     
-    if (elapsed >= 1) {
-        // Update bandwidth history
-        bandwidth_history_.push_back({now, current_bandwidth_});
-        
-        // Keep only the last hour of history
-        while (bandwidth_history_.size() > MAX_BANDWIDTH_HISTORY) {
-            bandwidth_history_.erase(bandwidth_history_.begin());
-        }
-        
-        // Calculate average bandwidth
-        double sum = 0.0;
-        for (const auto& entry : bandwidth_history_) {
-            sum += entry.second;
-        }
-        average_bandwidth_ = sum / bandwidth_history_.size();
-        
-        // Reset current bandwidth
-        current_bandwidth_ = 0.0;
-        last_bandwidth_update_ = now;
-    }
-    
-    current_bandwidth_ += packet.length * 8.0; // Convert bytes to bits
+    // Convert bytes to bits
+    current_bandwidth_.store(current_bandwidth_.load(std::memory_order_relaxed) +
+                             packet.length * 8.0 * weight, std::memory_order_relaxed);
 }
 
-void Statistics::updateErrorStats(const Packet& packet) {
-    if (packet.is_malformed) {
-        total_errors_++;
+void Statistics::rollBandwidth(std::chrono::system_clock::time_point now) {
+    const auto second = std::chrono::floor<std::chrono::seconds>(now);
+    if (second != bandwidth_second_) {
+        // The second just finished goes into the history; the seconds
+        // skipped without traffic read as zero there
+        bandwidth_history_.add(bandwidth_second_,
+                               static_cast<uint64_t>(current_bandwidth_.load(std::memory_order_relaxed)));
+        bandwidth_history_.advance(second - std::chrono::seconds(1));
+        const auto covered = bandwidth_history_.getCovered(0);
+        average_bandwidth_.store(static_cast<double>(bandwidth_history_.getTotal(0)) /
+                                 static_cast<double>(std::max<int64_t>(covered.count(), 1)),
+                                 std::memory_order_relaxed);
+
+        current_bandwidth_.store(0.0, std::memory_order_relaxed);
+        bandwidth_second_ = second;
     }
 }
 
-void Statistics::cleanupInactiveConnections() {
-    auto now = std::chrono::system_clock::now();
-    for (auto it = connection_stats_.begin(); it != connection_stats_.end();) {
-        if (now - it->second.last_seen > CONNECTION_TIMEOUT) {
-            it->second.is_active = false;
-            it = connection_stats_.erase(it);
-        } else {
-            ++it;
-        }
+void Statistics::updateErrorStats(const PacketView& packet, uint32_t weight) {
+    if (hasError(packet)) {
+        total_errors_.store(total_errors_.load(std::memory_order_relaxed) + weight,
+                            std::memory_order_relaxed);
     }
 }
 
-std::string Statistics::generateConnectionId(const Packet& packet) const {
-    std::stringstream ss;
-    if (packet.source_address < packet.destination_address) {
-        ss << packet.source_address << ":" << packet.source_port << "-"
-           << packet.destination_address << ":" << packet.destination_port;
-    } else {
-        ss << packet.destination_address << ":" << packet.destination_port << "-"
-           << packet.source_address << ":" << packet.source_port;
-    }
-    return ss.str();
+// A connection's timer is set for when it would time out had it gone quiet
+// after its first packet. When it fires, a connection that has been seen
+// since is given a new one from its last packet instead, so each connection
+// costs a timer per timeout period rather than any work per packet.
+void Statistics::expire(std::chrono::system_clock::time_point now) {
+    connection_timers_.advance(now, [this](const FlowKey& connection,
+                                           std::chrono::system_clock::time_point time) {
+        ConnectionStats* stats = connection_stats_.find(connection);
+        if (stats == nullptr) {
+            return;
+        }
+        const auto deadline = stats->last_seen + connection_timeout_;
+        if (deadline > time) {
+            connection_timers_.schedule(connection, deadline);
+            return;
+        }
+        if (flow_record_handler_) {
+            stats->is_active = false;
+            flow_record_handler_(makeFlowRecord(connection, std::move(*stats)));
+        }
+        connection_stats_.erase(connection);
+    });
 }
 
 uint64_t Statistics::getTotalPackets() const {
@@ -205,9 +644,81 @@ std::vector<std::pair<Packet::Protocol, uint64_t>> Statistics::getTopProtocols(s
     return result;
 }
 
-std::vector<std::pair<std::string, uint64_t>> Statistics::getTopHosts(size_t count) const {
+std::vector<std::pair<std::string, InterfaceStats>> Statistics::getInterfaceStats() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<std::pair<std::string, uint64_t>> result;
+    std::vector<std::pair<std::string, InterfaceStats>> result(interface_stats_.begin(),
+                                                               interface_stats_.end());
+    std::sort(result.begin(), result.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    return result;
+}
+
+std::vector<std::pair<std::string, ProtocolStats>> Statistics::getSignatureStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<std::string, ProtocolStats>> result(signature_stats_.begin(),
+                                                              signature_stats_.end());
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.second.packet_count > b.second.packet_count;
+    });
+    return result;
+}
+
+std::vector<std::pair<std::string, ProtocolStats>> Statistics::getTopServices(size_t count) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<std::string, ProtocolStats>> result(service_stats_.begin(),
+                                                              service_stats_.end());
+    const size_t top = std::min(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + top, result.end(),
+                      [](const auto& a, const auto& b) {
+                          return a.second.byte_count > b.second.byte_count;
+                      });
+    result.resize(top);
+    return result;
+}
+
+void Statistics::recordDnsQuery(const IpAddress& resolver, uint32_t weight,
+                                std::chrono::system_clock::time_point timestamp) {
+    const auto lock = lockForUpdate();
+    auto& stats = dns_stats_[resolver];
+    stats.queries += weight;
+    stats.last_seen = std::max(stats.last_seen, timestamp);
+}
+
+void Statistics::recordDnsResponse(const IpAddress& resolver, std::chrono::nanoseconds latency,
+                                   uint8_t rcode, uint32_t weight,
+                                   std::chrono::system_clock::time_point timestamp) {
+    const auto lock = lockForUpdate();
+    auto& stats = dns_stats_[resolver];
+    stats.responses += weight;
+    stats.rcodes[rcode & 0x0f] += weight;
+    stats.latency[DnsResolverStats::getBucket(latency)] += weight;
+    stats.total_latency += latency * weight;
+    stats.max_latency = std::max(stats.max_latency, latency);
+    stats.last_seen = std::max(stats.last_seen, timestamp);
+}
+
+void Statistics::recordDnsTimeout(const IpAddress& resolver, uint32_t weight) {
+    const auto lock = lockForUpdate();
+    dns_stats_[resolver].timeouts += weight;
+}
+
+std::vector<std::pair<IpAddress, DnsResolverStats>> Statistics::getDnsResolverStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<IpAddress, DnsResolverStats>> result(dns_stats_.begin(), dns_stats_.end());
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        const auto slowest_a = a.second.getLatencyPercentile(0.95);
+        const auto slowest_b = b.second.getLatencyPercentile(0.95);
+        if (slowest_a != slowest_b) {
+            return slowest_a > slowest_b;
+        }
+        return a.second.queries > b.second.queries;
+    });
+    return result;
+}
+
+std::vector<std::pair<IpAddress, uint64_t>> Statistics::getTopHosts(size_t count) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<IpAddress, uint64_t>> result;
     result.reserve(host_stats_.size());
     
     for (const auto& [host, stats] : host_stats_) {
@@ -224,15 +735,15 @@ std::vector<std::pair<std::string, uint64_t>> Statistics::getTopHosts(size_t cou
     return result;
 }
 
-HostStats Statistics::getHostStats(const std::string& host) const {
+HostStats Statistics::getHostStats(const IpAddress& host) const {
     std::lock_guard<std::mutex> lock(mutex_);
     auto it = host_stats_.find(host);
     return it != host_stats_.end() ? it->second : HostStats{};
 }
 
-std::vector<std::string> Statistics::getActiveHosts() const {
+std::vector<IpAddress> Statistics::getActiveHosts() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<std::string> result;
+    std::vector<IpAddress> result;
     result.reserve(host_stats_.size());
     
     for (const auto& [host, stats] : host_stats_) {
@@ -242,45 +753,48 @@ std::vector<std::string> Statistics::getActiveHosts() const {
     return result;
 }
 
-std::vector<std::pair<std::string, uint64_t>> Statistics::getTopConnections(size_t count) const {
+std::vector<std::pair<FlowKey, uint64_t>> Statistics::getTopConnections(size_t count) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<std::pair<std::string, uint64_t>> result;
+    std::vector<std::pair<FlowKey, uint64_t>> result;
     result.reserve(connection_stats_.size());
     
-    for (const auto& [conn_id, stats] : connection_stats_) {
-        result.emplace_back(conn_id, stats.packet_count);
-    }
-    
-    std::sort(result.begin(), result.end(),
-              [](const auto& a, const auto& b) { return a.second > b.second; });
+    connection_stats_.forEach([&result](const FlowKey& connection, const ConnectionStats& stats) {
+        result.emplace_back(connection, stats.packet_count);
+    });
     
-    if (result.size() > count) {
-        result.resize(count);
-    }
+    const size_t top = std::min(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + top, result.end(),
+                      [](const auto& a, const auto& b) { return a.second > b.second; });
+    result.resize(top);
     
     return result;
 }
 
-ConnectionStats Statistics::getConnectionStats(const std::string& connection_id) const {
+ConnectionStats Statistics::getConnectionStats(const FlowKey& connection) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = connection_stats_.find(connection_id);
-    return it != connection_stats_.end() ? it->second : ConnectionStats{};
+    const ConnectionStats* stats = connection_stats_.find(connection);
+    return stats ? *stats : ConnectionStats{};
 }
 
-std::vector<std::string> Statistics::getActiveConnections() const {
+std::vector<FlowKey> Statistics::getActiveConnections() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<std::string> result;
+    std::vector<FlowKey> result;
     result.reserve(connection_stats_.size());
     
-    for (const auto& [conn_id, stats] : connection_stats_) {
+    connection_stats_.forEach([&result](const FlowKey& connection, const ConnectionStats& stats) {
         if (stats.is_active) {
-            result.push_back(conn_id);
+            result.push_back(connection);
         }
-    }
+    });
     
     return result;
 }
 
+size_t Statistics::getConnectionCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_stats_.size() + omitted_connections_;
+}
+
 double Statistics::getCurrentBandwidth() const {
     return current_bandwidth_;
 }
@@ -289,15 +803,35 @@ double Statistics::getAverageBandwidth() const {
     return average_bandwidth_;
 }
 
-std::vector<std::pair<std::chrono::system_clock::time_point, double>> Statistics::getBandwidthHistory() const {
+std::vector<std::pair<std::chrono::system_clock::time_point, double>> Statistics::getBandwidthHistory(
+    std::chrono::seconds resolution) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return bandwidth_history_;
+    size_t level = 0;
+    while (level + 1 < bandwidth_history_.getLevels() &&
+           bandwidth_history_.getResolution(level) < resolution) {
+        ++level;
+    }
+
+    // Intervals the history only partly spans are averaged over that part
+    std::vector<std::pair<std::chrono::system_clock::time_point, double>> result;
+    const auto buckets = bandwidth_history_.getBuckets(level);
+    result.reserve(buckets.size());
+    for (const auto& bucket : buckets) {
+        result.emplace_back(bucket.start, bucket.covered.count() > 0
+            ? static_cast<double>(bucket.total) / static_cast<double>(bucket.covered.count()) : 0.0);
+    }
+    return result;
 }
 
 uint64_t Statistics::getErrorCount() const {
     return total_errors_;
 }
 
+bool Statistics::isEstimated() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return estimated_;
+}
+
 std::vector<std::pair<std::string, uint64_t>> Statistics::getTopErrors(size_t count) const {
     std::lock_guard<std::mutex> lock(mutex_);
     std::vector<std::pair<std::string, uint64_t>> result;
@@ -0,0 +1,66 @@
+#include "analysis/StatisticsShard.hpp"
+#include "config/ConfigManager.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+StatisticsShard::StatisticsShard(std::chrono::milliseconds interval)
+    : interval_(std::max(interval, std::chrono::milliseconds(1)))
+    , next_publish_(std::chrono::steady_clock::now() + interval_)
+    , snapshot_(std::make_shared<Statistics>())
+{
+    working_.setLocking(false);
+}
+
+std::chrono::milliseconds StatisticsShard::intervalFromSettings() {
+    return std::chrono::seconds(std::max(1,
+        ConfigManager::getInstance().getInt("analysis", "statistics_interval").value_or(1)));
+}
+
+void StatisticsShard::setInterval(std::chrono::milliseconds interval) {
+    interval_ = std::max(interval, std::chrono::milliseconds(1));
+    next_publish_ = std::chrono::steady_clock::now() + interval_;
+}
+
+size_t StatisticsShard::snapshotEntriesFromSettings() {
+    const int entries = ConfigManager::getInstance().getInt("analysis", "snapshot_entries").value_or(1000);
+    return entries > 0 ? static_cast<size_t>(entries) : SIZE_MAX;
+}
+
+void StatisticsShard::setSnapshotEntries(size_t entries) {
+    snapshot_entries_ = entries > 0 ? entries : SIZE_MAX;
+}
+
+void StatisticsShard::tick(std::chrono::steady_clock::time_point now) {
+    if (now < next_publish_) {
+        return;
+    }
+    publish();
+    next_publish_ = now + interval_;
+}
+
+void StatisticsShard::publish() {
+    std::shared_ptr<Statistics> next = std::move(spare_);
+    if (next && next.use_count() == 1) {
+        // The last reader let go; pairs with its release of the count
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+        next = std::make_shared<Statistics>();
+    }
+    // Bandwidth otherwise only moves on with packets, and an idle worker
+    // would keep publishing its last second as current
+    working_.advanceBandwidth(std::chrono::system_clock::now());
+    next->assignSnapshot(working_, snapshot_entries_);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next.swap(snapshot_);
+    }
+    generation_.fetch_add(1, std::memory_order_release);
+    spare_ = std::move(next);
+}
+
+std::shared_ptr<const Statistics> StatisticsShard::getSnapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshot_;
+}
@@ -0,0 +1,225 @@
+#include "analysis/TcpAnalyzer.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Sequence numbers wrap, so they are compared by their distance
+bool before(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+// A segment filling a gap sooner than this after it opened was reordered
+// on the way; a sender only resends after a round trip at the least. Used
+// until the handshake gives the connection's own round trip.
+constexpr std::chrono::milliseconds REORDER_WINDOW{3};
+
+bool isSet(std::chrono::system_clock::time_point time) {
+    return time.time_since_epoch().count() != 0;
+}
+
+} // namespace
+
+double TcpAnalyzer::Counters::getLossRate() const {
+    return segments ? static_cast<double>(retransmissions) / static_cast<double>(segments) : 0.0;
+}
+
+void TcpAnalyzer::update(const PacketView& packet, Side side) {
+    const uint8_t tcp_flags = packet.getTcpFlags();
+    // A reset carries nothing to track, and its window means nothing
+    if (tcp_flags & PacketView::TCP_RST) {
+        return;
+    }
+    trackHandshake(packet, tcp_flags, side);
+
+    Direction& direction = directions_[static_cast<size_t>(side)];
+    const uint32_t payload = static_cast<uint32_t>(packet.getPayloadLength());
+    // SYN and FIN each take a sequence number
+    const uint32_t length = payload + ((tcp_flags & PacketView::TCP_SYN) ? 1 : 0) +
+                            ((tcp_flags & PacketView::TCP_FIN) ? 1 : 0);
+    if (length > 0) {
+        const uint32_t sequence = packet.getSequenceNumber();
+        // Keep-alives resend the byte before next on purpose
+        const bool keep_alive = payload <= 1 && length == payload &&
+                                (direction.flags & SEEN) && sequence == direction.next - 1;
+        if (!keep_alive) {
+            trackSequence(direction, sequence, sequence + length, packet.timestamp);
+        }
+    }
+    trackAck(direction, tcp_flags, packet.getAcknowledgmentNumber(), packet.getWindowSize(),
+             length > 0);
+}
+
+void TcpAnalyzer::trackHandshake(const PacketView& packet, uint8_t tcp_flags, Side side) {
+    const uint8_t handshake = tcp_flags & (PacketView::TCP_SYN | PacketView::TCP_ACK);
+    if (handshake == PacketView::TCP_SYN) {
+        // A SYN sent again restarts the clock, so the SYN/ACK is timed
+        // against the SYN it most likely answers
+        if (!isSet(syn_ack_time_)) {
+            client_ = side;
+            syn_time_ = packet.timestamp;
+        }
+    } else if (handshake == (PacketView::TCP_SYN | PacketView::TCP_ACK)) {
+        if (isSet(syn_time_) && side != client_ && !isSet(syn_ack_time_)) {
+            syn_ack_time_ = packet.timestamp;
+        }
+    } else if (handshake == PacketView::TCP_ACK) {
+        if (isSet(syn_ack_time_) && side == client_ && !isSet(ack_time_)) {
+            ack_time_ = packet.timestamp;
+        }
+    }
+}
+
+void TcpAnalyzer::trackSequence(Direction& direction, uint32_t begin, uint32_t end,
+                                std::chrono::system_clock::time_point time) {
+    ++direction.segments;
+    if (!(direction.flags & SEEN)) {
+        direction.next = end;
+        direction.flags |= SEEN;
+        return;
+    }
+
+    if (before(direction.next, end)) {
+        if (before(direction.next, begin)) {
+            // Skipped ahead: the bytes in between were lost before they
+            // reached us or are still on their way
+            direction.gap_begin = direction.next;
+            direction.gap_end = begin;
+            direction.gap_time = time;
+            direction.flags |= GAP;
+        } else if (before(begin, direction.next)) {
+            ++direction.retransmissions;        // Resent some bytes along with new ones
+        }
+        direction.next = end;
+        return;
+    }
+
+    // Nothing new: either the missing bytes arriving or bytes seen before
+    if ((direction.flags & GAP) && !before(begin, direction.gap_begin) &&
+        !before(direction.gap_end, end)) {
+        const std::chrono::microseconds rtt = getHandshakeRtt();
+        const auto window = rtt.count() > 0
+            ? std::chrono::duration_cast<std::chrono::system_clock::duration>(rtt)
+            : std::chrono::duration_cast<std::chrono::system_clock::duration>(REORDER_WINDOW);
+        if (time - direction.gap_time < window) {
+            ++direction.out_of_order;
+        } else {
+            ++direction.retransmissions;
+        }
+        if (begin == direction.gap_begin) {
+            direction.gap_begin = end;
+        } else if (end == direction.gap_end) {
+            direction.gap_end = begin;
+        }
+        if (!before(direction.gap_begin, direction.gap_end)) {
+            direction.flags &= static_cast<uint8_t>(~GAP);
+        }
+        return;
+    }
+    ++direction.retransmissions;
+}
+
+void TcpAnalyzer::trackAck(Direction& direction, uint8_t tcp_flags, uint32_t ack, uint16_t window,
+                           bool carries_data) {
+    if (!(tcp_flags & PacketView::TCP_ACK)) {
+        return;
+    }
+    // The SYN/ACK's window is before scaling applies, so it only counts
+    // for spotting a closed window
+    if (window == 0 && !(tcp_flags & PacketView::TCP_SYN)) {
+        if (!(direction.flags & WINDOW_CLOSED)) {
+            ++direction.zero_windows;
+            direction.flags |= WINDOW_CLOSED;
+        }
+    } else {
+        direction.flags &= static_cast<uint8_t>(~WINDOW_CLOSED);
+    }
+
+    if (direction.flags & ACKED) {
+        // The same ACK again with nothing else new says a segment after it
+        // went missing
+        if (!carries_data && ack == direction.last_ack && window == direction.window) {
+            ++direction.duplicate_acks;
+        } else if (before(direction.last_ack, ack)) {
+            direction.last_ack = ack;
+        }
+    } else {
+        direction.last_ack = ack;
+        direction.flags |= ACKED;
+    }
+    direction.window = window;
+}
+
+void TcpAnalyzer::merge(const TcpAnalyzer& other) {
+    for (size_t i = 0; i < directions_.size(); ++i) {
+        Direction& into = directions_[i];
+        const Direction& from = other.directions_[i];
+        if (!(into.flags & SEEN) && (from.flags & SEEN)) {
+            const Direction sums = into;
+            into = from;
+            into.segments += sums.segments;
+            into.retransmissions += sums.retransmissions;
+            into.out_of_order += sums.out_of_order;
+            into.duplicate_acks += sums.duplicate_acks;
+            into.zero_windows += sums.zero_windows;
+            continue;
+        }
+        into.segments += from.segments;
+        into.retransmissions += from.retransmissions;
+        into.out_of_order += from.out_of_order;
+        into.duplicate_acks += from.duplicate_acks;
+        into.zero_windows += from.zero_windows;
+    }
+    if (!isSet(syn_time_)) {
+        syn_time_ = other.syn_time_;
+        client_ = other.client_;
+    }
+    if (!isSet(syn_ack_time_)) {
+        syn_ack_time_ = other.syn_ack_time_;
+    }
+    if (!isSet(ack_time_)) {
+        ack_time_ = other.ack_time_;
+    }
+}
+
+std::chrono::microseconds TcpAnalyzer::getServerRtt() const {
+    if (!isSet(syn_time_) || !isSet(syn_ack_time_)) {
+        return std::chrono::microseconds::zero();
+    }
+    return std::max(std::chrono::duration_cast<std::chrono::microseconds>(syn_ack_time_ - syn_time_),
+                    std::chrono::microseconds::zero());
+}
+
+std::chrono::microseconds TcpAnalyzer::getClientRtt() const {
+    if (!isSet(syn_ack_time_) || !isSet(ack_time_)) {
+        return std::chrono::microseconds::zero();
+    }
+    return std::max(std::chrono::duration_cast<std::chrono::microseconds>(ack_time_ - syn_ack_time_),
+                    std::chrono::microseconds::zero());
+}
+
+std::chrono::microseconds TcpAnalyzer::getHandshakeRtt() const {
+    return isSet(ack_time_) ? getServerRtt() + getClientRtt() : std::chrono::microseconds::zero();
+}
+
+TcpAnalyzer::Counters TcpAnalyzer::getCounters(Side side) const {
+    const Direction& direction = directions_[static_cast<size_t>(side)];
+    Counters counters;
+    counters.segments = direction.segments;
+    counters.retransmissions = direction.retransmissions;
+    counters.out_of_order = direction.out_of_order;
+    counters.duplicate_acks = direction.duplicate_acks;
+    counters.zero_windows = direction.zero_windows;
+    return counters;
+}
+
+TcpAnalyzer::Counters TcpAnalyzer::getCounters() const {
+    Counters counters = getCounters(Side::FIRST);
+    const Counters second = getCounters(Side::SECOND);
+    counters.segments += second.segments;
+    counters.retransmissions += second.retransmissions;
+    counters.out_of_order += second.out_of_order;
+    counters.duplicate_acks += second.duplicate_acks;
+    counters.zero_windows += second.zero_windows;
+    return counters;
+}
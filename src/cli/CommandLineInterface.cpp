@@ -1,5 +1,6 @@
 #include "cli/CommandLineInterface.hpp"
 #include "utils/Logger.hpp"
+#include "protocols/DnsMessage.hpp"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -51,7 +52,7 @@ void CommandLineInterface::initializeCommands() {
         {"stats", [this](const std::string&) { displayStatistics(); }},
         {"connections", [this](const std::string&) { displayConnections(); }},
         {"packets", [this](const std::string&) { displayPackets(); }},
-        {"bandwidth", [this](const std::string&) { displayBandwidth(); }},
+        {"bandwidth", [this](const std::string& args) { displayBandwidth(args); }},
         {"errors", [this](const std::string&) { displayErrors(); }},
         {"filter", [this](const std::string& args) { setFilter(args); }},
         {"clear", [this](const std::string&) { clearFilter(); }},
@@ -95,7 +96,7 @@ void CommandLineInterface::displayHelp() const {
     std::cout << "  stats                   - Display current statistics\n";
     std::cout << "  connections             - Display active connections\n";
     std::cout << "  packets                 - Display recent packets\n";
-    std::cout << "  bandwidth               - Display bandwidth usage\n";
+    std::cout << "  bandwidth [resolution]  - Display bandwidth usage per second, minute, hour or day\n";
     std::cout << "  errors                  - Display error statistics\n";
     std::cout << "  filter <expression>     - Set packet filter\n";
     std::cout << "  clear                   - Clear packet filter\n";
@@ -108,20 +109,129 @@ void CommandLineInterface::displayStatistics() const {
     auto stats = monitor_->getStatistics();
     
     std::cout << "\nNetwork Statistics:\n";
-    std::cout << "Total Packets: " << stats.getTotalPackets() << "\n";
-    std::cout << "Total Bytes: " << formatBytes(stats.getTotalBytes()) << "\n";
-    std::cout << "Current Bandwidth: " << formatBandwidth(stats.getCurrentBandwidth()) << "\n";
-    std::cout << "Average Bandwidth: " << formatBandwidth(stats.getAverageBandwidth()) << "\n";
-    std::cout << "Error Count: " << stats.getErrorCount() << "\n\n";
+    std::cout << "Total Packets: " << stats->getTotalPackets() << "\n";
+    std::cout << "Total Bytes: " << formatBytes(stats->getTotalBytes()) << "\n";
+    std::cout << "Current Bandwidth: " << formatBandwidth(stats->getCurrentBandwidth()) << "\n";
+    std::cout << "Average Bandwidth: " << formatBandwidth(stats->getAverageBandwidth()) << "\n";
+    std::cout << "Error Count: " << stats->getErrorCount() << "\n";
+    const uint32_t rate = monitor_->getSamplingRate();
+    if (rate > 1) {
+        std::cout << "Sampling: 1 in " << rate << " flows, counts above are estimates ("
+                  << monitor_->getShedPackets() << " packets skipped)\n";
+    } else if (stats->isEstimated()) {
+        std::cout << "Sampling: off, counts include earlier sampled estimates\n";
+    }
+    std::cout << "\n";
+
+    std::cout << "Capture (" << monitor_->getCaptureBackend() << "):\n";
+    const bool multiInterface = monitor_->getInterfaces().size() > 1;
+    for (const auto& queue : monitor_->getCaptureQueueStats()) {
+        std::cout << "  ";
+        if (multiInterface) {
+            std::cout << queue.interface << " ";
+        }
+        if (queue.queue_id >= 0) {
+            std::cout << "Queue " << queue.queue_id << ": ";
+        }
+        std::cout << queue.packets_received << " received, "
+                  << queue.packets_dropped << " dropped";
+        if (queue.ring_size > 0) {
+            std::cout << ", fill ring " << queue.fill_ring_used << "/" << queue.ring_size
+                      << ", completion ring " << queue.completion_ring_used << "/" << queue.ring_size;
+        }
+        std::cout << "\n";
+    }
+    const std::string filter = monitor_->getFilter();
+    std::cout << "  Filter: " << (filter.empty() ? "(none)" : filter)
+              << ", " << monitor_->getFilteredPackets() << " packets filtered out\n";
+    const auto pipeline = monitor_->getPipelineStats();
+    std::cout << "  Pipeline: analysis ring " << pipeline.analysis_queued << "/" << pipeline.analysis_capacity
+              << " (" << pipeline.analysis_overflows << " overflowed), store ring "
+              << pipeline.store_queued << "/" << pipeline.store_capacity
+              << " (" << pipeline.store_overflows << " overflowed), packet pool "
+              << pipeline.pool_hits << " reused / " << pipeline.pool_misses << " allocated\n";
+    if (monitor_->isReassembling()) {
+        const auto fragments = monitor_->getReassemblyStats();
+        std::cout << "  Reassembly: " << fragments.reassembled << " datagrams from "
+                  << fragments.fragments << " fragments, " << fragments.pending << " pending ("
+                  << formatBytes(fragments.memory_used) << " of " << formatBytes(fragments.memory_capacity)
+                  << "), " << fragments.timed_out << " timed out, " << fragments.evicted << " evicted, "
+                  << fragments.invalid << " invalid\n";
+    }
+    if (monitor_->isFollowingStreams()) {
+        const auto streams = monitor_->getStreamStats();
+        std::cout << "  Streams: " << streams.active << " TCP connections followed ("
+                  << formatBytes(streams.memory_used) << " of " << formatBytes(streams.memory_capacity)
+                  << " buffered), " << formatBytes(streams.delivered) << " to analyzers, "
+                  << streams.out_of_order << " out of order, " << streams.truncated << " cut short, "
+                  << streams.evicted << " evicted\n";
+    }
+    std::cout << "\n";
+
+    if (multiInterface) {
+        std::cout << "Interfaces:\n";
+        for (const auto& [interface, iface] : stats->getInterfaceStats()) {
+            std::cout << "  " << interface << ": " << iface.packet_count << " packets, "
+                      << formatBytes(iface.byte_count) << "\n";
+        }
+        std::cout << "\n";
+    }
 
     std::cout << "Top Protocols:\n";
-    for (const auto& [protocol, count] : stats.getTopProtocols(5)) {
-        std::cout << "  " << protocol << ": " << count << " packets\n";
+    for (const auto& [protocol, count] : stats->getTopProtocols(5)) {
+        std::cout << "  " << Packet::getProtocolString(protocol) << ": " << count << " packets\n";
     }
     std::cout << "\n";
 
+    const auto signatures = stats->getSignatureStats();
+    if (!signatures.empty()) {
+        std::cout << "Signatures:\n";
+        for (const auto& [label, signature] : signatures) {
+            std::cout << "  " << label << ": " << signature.packet_count << " packets, "
+                      << formatBytes(signature.byte_count) << "\n";
+        }
+        std::cout << "\n";
+    }
+
+    const auto services = stats->getTopServices(5);
+    if (!services.empty()) {
+        std::cout << "Top TLS Services:\n";
+        for (const auto& [name, service] : services) {
+            std::cout << "  " << name << ": " << formatBytes(service.byte_count) << ", "
+                      << service.packet_count << " packets\n";
+        }
+        std::cout << "\n";
+    }
+
+    // Latency is read off the histogram, so percentiles are bucket limits
+    const auto resolvers = stats->getDnsResolverStats();
+    if (!resolvers.empty()) {
+        auto ms = [](auto duration) {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        };
+        std::cout << "DNS Resolvers (slowest first):\n" << std::fixed << std::setprecision(1);
+        for (const auto& [resolver, dns] : resolvers) {
+            std::cout << "  " << resolver << ": " << dns.queries << " queries, "
+                      << dns.responses << " answered";
+            if (dns.responses > 0) {
+                std::cout << " (median <" << ms(dns.getLatencyPercentile(0.5))
+                          << " ms, p95 <" << ms(dns.getLatencyPercentile(0.95))
+                          << " ms, max " << ms(dns.max_latency) << " ms)";
+            }
+            std::cout << ", " << dns.timeouts << " unanswered";
+            for (size_t rcode = 1; rcode < dns.rcodes.size(); ++rcode) {
+                if (dns.rcodes[rcode] > 0) {
+                    std::cout << ", " << dns.rcodes[rcode] << " "
+                              << DnsMessage::getRcodeString(static_cast<uint8_t>(rcode));
+                }
+            }
+            std::cout << "\n";
+        }
+        std::cout << std::defaultfloat << "\n";
+    }
+
     std::cout << "Top Hosts:\n";
-    for (const auto& [host, count] : stats.getTopHosts(5)) {
+    for (const auto& [host, count] : stats->getTopHosts(5)) {
         std::cout << "  " << host << ": " << count << " packets\n";
     }
 }
@@ -129,15 +239,40 @@ void CommandLineInterface::displayStatistics() const {
 void CommandLineInterface::displayConnections() const {
     auto stats = monitor_->getStatistics();
     
-    std::cout << "\nActive Connections:\n";
-    for (const auto& conn_id : stats.getActiveConnections()) {
-        auto conn_stats = stats.getConnectionStats(conn_id);
+    const auto connections = stats->getActiveConnections();
+    std::cout << "\nActive Connections";
+    if (stats->getConnectionCount() > connections.size()) {
+        std::cout << " (busiest " << connections.size() << " of " << stats->getConnectionCount() << ")";
+    }
+    std::cout << ":\n";
+    for (const auto& conn_id : connections) {
+        auto conn_stats = stats->getConnectionStats(conn_id);
         std::cout << "  " << conn_id << "\n";
         std::cout << "    Packets: " << conn_stats.packet_count << "\n";
         std::cout << "    Bytes: " << formatBytes(conn_stats.byte_count) << "\n";
-        std::cout << "    Retransmissions: " << conn_stats.retransmission_count << "\n";
         std::cout << "    Duration: " << std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now() - conn_stats.start_time).count() << "s\n";
+        if (conn_id.getTransport() != Packet::Protocol::TCP) {
+            continue;
+        }
+        // The round trip is only known when the handshake was captured
+        const auto& tcp = conn_stats.tcp;
+        const auto counters = tcp.getCounters();
+        std::cout << std::fixed << std::setprecision(1);
+        if (tcp.getHandshakeRtt().count() > 0) {
+            auto ms = [](auto duration) {
+                return std::chrono::duration<double, std::milli>(duration).count();
+            };
+            std::cout << "    RTT: " << ms(tcp.getHandshakeRtt()) << " ms (client side "
+                      << ms(tcp.getClientRtt()) << " ms, server side "
+                      << ms(tcp.getServerRtt()) << " ms)\n";
+        }
+        std::cout << "    Retransmissions: " << counters.retransmissions << " ("
+                  << counters.getLossRate() * 100.0 << "% of segments)\n";
+        std::cout << "    Out of order: " << counters.out_of_order
+                  << ", duplicate ACKs: " << counters.duplicate_acks
+                  << ", zero windows: " << counters.zero_windows << "\n";
+        std::cout << std::defaultfloat;
     }
 }
 
@@ -146,9 +281,21 @@ void CommandLineInterface::displayPackets() const {
     // This could show the most recent packets or packets matching certain criteria
 }
 
-void CommandLineInterface::displayBandwidth() const {
+void CommandLineInterface::displayBandwidth(const std::string& resolution) const {
+    std::chrono::seconds interval(1);
+    if (resolution == "minute") {
+        interval = std::chrono::minutes(1);
+    } else if (resolution == "hour") {
+        interval = std::chrono::hours(1);
+    } else if (resolution == "day") {
+        interval = std::chrono::hours(24);
+    } else if (!resolution.empty() && resolution != "second") {
+        std::cout << "Usage: bandwidth [second|minute|hour|day]\n";
+        return;
+    }
+
     auto stats = monitor_->getStatistics();
-    auto history = stats.getBandwidthHistory();
+    auto history = stats->getBandwidthHistory(interval);
     
     std::cout << "\nBandwidth History:\n";
     for (const auto& [time, bandwidth] : history) {
@@ -161,10 +308,10 @@ void CommandLineInterface::displayErrors() const {
     auto stats = monitor_->getStatistics();
     
     std::cout << "\nError Statistics:\n";
-    std::cout << "Total Errors: " << stats.getErrorCount() << "\n\n";
+    std::cout << "Total Errors: " << stats->getErrorCount() << "\n\n";
     
     std::cout << "Top Errors:\n";
-    for (const auto& [error, count] : stats.getTopErrors(5)) {
+    for (const auto& [error, count] : stats->getTopErrors(5)) {
         std::cout << "  " << error << ": " << count << " occurrences\n";
     }
 }
@@ -6,6 +6,16 @@
 #include <cctype>
 #include <regex>
 
+namespace {
+
+std::string trim(const std::string& str) {
+    const auto begin = std::find_if_not(str.begin(), str.end(), ::isspace);
+    const auto end = std::find_if_not(str.rbegin(), str.rend(), ::isspace).base();
+    return begin < end ? std::string(begin, end) : std::string();
+}
+
+} // namespace
+
 ConfigManager& ConfigManager::getInstance() {
     static ConfigManager instance;
     return instance;
@@ -29,21 +39,25 @@ void ConfigManager::save(const std::string& config_file) {
 void ConfigManager::setValue(const std::string& section, const std::string& key, const std::string& value) {
     std::lock_guard<std::mutex> lock(mutex_);
     config_data_[section][key] = value;
+    raw_data_[section].erase(key);
 }
 
 void ConfigManager::setValue(const std::string& section, const std::string& key, int value) {
     std::lock_guard<std::mutex> lock(mutex_);
     config_data_[section][key] = value;
+    raw_data_[section].erase(key);
 }
 
 void ConfigManager::setValue(const std::string& section, const std::string& key, bool value) {
     std::lock_guard<std::mutex> lock(mutex_);
     config_data_[section][key] = value;
+    raw_data_[section].erase(key);
 }
 
 void ConfigManager::setValue(const std::string& section, const std::string& key, double value) {
     std::lock_guard<std::mutex> lock(mutex_);
     config_data_[section][key] = value;
+    raw_data_[section].erase(key);
 }
 
 std::optional<std::string> ConfigManager::getString(const std::string& section, const std::string& key) const {
@@ -118,6 +132,46 @@ std::optional<double> ConfigManager::getDouble(const std::string& section, const
     return std::nullopt;
 }
 
+std::optional<std::string> ConfigManager::getRawString(const std::string& section, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto raw_section = raw_data_.find(section);
+    if (raw_section != raw_data_.end()) {
+        auto raw = raw_section->second.find(key);
+        if (raw != raw_section->second.end()) {
+            return raw->second;
+        }
+    }
+
+    // Set since loading, so there is no text to return but the value's own
+    auto section_it = config_data_.find(section);
+    if (section_it == config_data_.end()) {
+        return std::nullopt;
+    }
+    auto key_it = section_it->second.find(key);
+    if (key_it == section_it->second.end()) {
+        return std::nullopt;
+    }
+    return getValueAsString(key_it->second);
+}
+
+std::vector<std::string> ConfigManager::getInterfaces() const {
+    std::vector<std::string> interfaces;
+    std::istringstream stream(getString("monitoring", "interface").value_or(""));
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        name = trim(name);
+        if (!name.empty() &&
+            std::find(interfaces.begin(), interfaces.end(), name) == interfaces.end()) {
+            interfaces.push_back(name);
+        }
+    }
+    return interfaces;
+}
+
+void ConfigManager::setInterface(const std::string& interfaces) {
+    setValue("monitoring", "interface", interfaces);
+}
+
 bool ConfigManager::hasSection(const std::string& section) const {
     std::lock_guard<std::mutex> lock(mutex_);
     return config_data_.find(section) != config_data_.end();
@@ -174,8 +228,9 @@ void ConfigManager::parseConfigFile(const std::string& config_file) {
             continue;
         }
 
-        // Remove whitespace
-        line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
+        // Trim surrounding whitespace; inner spaces are significant in
+        // values such as BPF filter expressions
+        line = trim(line);
 
         std::smatch matches;
         if (std::regex_match(line, matches, section_pattern)) {
@@ -184,9 +239,10 @@ void ConfigManager::parseConfigFile(const std::string& config_file) {
             if (current_section.empty()) {
                 throw std::runtime_error("Key-value pair found outside of section");
             }
-            std::string key = matches[1].str();
-            std::string value = matches[2].str();
+            std::string key = trim(matches[1].str());
+            std::string value = trim(matches[2].str());
             config_data_[current_section][key] = parseValue(value);
+            raw_data_[current_section][key] = value;
         }
     }
 }
@@ -207,7 +263,7 @@ void ConfigManager::writeConfigFile(const std::string& config_file) const {
 }
 
 std::string ConfigManager::getValueAsString(const ConfigValue& value) const {
-    return std::visit([](const auto& v) {
+    return std::visit([](const auto& v) -> std::string {
         using T = std::decay_t<decltype(v)>;
         if constexpr (std::is_same_v<T, std::string>) {
             return v;
@@ -225,16 +281,25 @@ ConfigManager::ConfigValue ConfigManager::parseValue(const std::string& value) c
         return value == "true";
     }
 
-    // Try to parse as integer
+    // Try to parse as integer; the whole value must be consumed, otherwise
+    // lists such as "53:full,80:256" would be read as 53
     try {
-        return std::stoi(value);
+        size_t pos = 0;
+        const int parsed = std::stoi(value, &pos);
+        if (pos == value.size()) {
+            return parsed;
+        }
     } catch (...) {
         // Not an integer
     }
 
     // Try to parse as double
     try {
-        return std::stod(value);
+        size_t pos = 0;
+        const double parsed = std::stod(value, &pos);
+        if (pos == value.size()) {
+            return parsed;
+        }
     } catch (...) {
         // Not a double
     }
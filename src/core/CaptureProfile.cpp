@@ -0,0 +1,126 @@
+#include "core/CaptureProfile.hpp"
+#include "config/ConfigManager.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t DEFAULT_HEADER_SNAPLEN = 128;
+
+// Ethernet + IPv6 + TCP without options is 74 bytes; anything shorter
+// would leave the transport header truncated
+constexpr uint32_t MIN_HEADER_SNAPLEN = 96;
+
+std::string strip(const std::string& str) {
+    const auto begin = str.find_first_not_of(" \t");
+    const auto end = str.find_last_not_of(" \t");
+    return begin == std::string::npos ? std::string() : str.substr(begin, end - begin + 1);
+}
+
+size_t parseBudget(const std::string& value) {
+    if (value == "full") {
+        return CaptureProfile::UNLIMITED;
+    }
+    size_t pos = 0;
+    const unsigned long budget = std::stoul(value, &pos);
+    if (pos != value.size()) {
+        throw std::invalid_argument(value);
+    }
+    return budget;
+}
+
+} // namespace
+
+CaptureProfile::CaptureProfile()
+    : mode_(Mode::FULL)
+    , snaplen_(FULL_SNAPLEN)
+    , default_budget_(UNLIMITED) {
+}
+
+CaptureProfile CaptureProfile::fromConfig() {
+    auto& config = ConfigManager::getInstance();
+    const std::string mode = config.getString("monitoring", "capture_profile").value_or("full");
+
+    CaptureProfile profile;
+    if (mode == "full") {
+        return profile;
+    }
+
+    if (mode == "headers") {
+        const int snaplen = config.getInt("monitoring", "header_snaplen")
+                                .value_or(static_cast<int>(DEFAULT_HEADER_SNAPLEN));
+        profile.mode_           = Mode::HEADERS;
+        profile.snaplen_        = std::clamp<uint32_t>(static_cast<uint32_t>(std::max(snaplen, 0)),
+                                                       MIN_HEADER_SNAPLEN, FULL_SNAPLEN);
+        profile.default_budget_ = 0;
+        return profile;
+    }
+
+    if (mode == "budget") {
+        // The kernel cannot truncate per port, so frames arrive whole and
+        // the budget is applied when the payload is copied
+        profile.mode_           = Mode::BUDGET;
+        profile.default_budget_ = static_cast<size_t>(std::max(
+            config.getInt("monitoring", "default_payload_budget").value_or(0), 0));
+
+        // Ports not listed get the default budget
+        profile.parseBudgets(config.getString("monitoring", "payload_budget").value_or(""));
+        return profile;
+    }
+
+    throw std::runtime_error("Unknown capture_profile '" + mode +
+                             "' (expected full, headers or budget)");
+}
+
+void CaptureProfile::parseBudgets(const std::string& spec) {
+    std::istringstream stream(spec);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        entry = strip(entry);
+        if (entry.empty()) {
+            continue;
+        }
+
+        const auto colon = entry.find(':');
+        try {
+            if (colon == std::string::npos) {
+                throw std::invalid_argument(entry);
+            }
+            const unsigned long port = std::stoul(strip(entry.substr(0, colon)));
+            if (port == 0 || port > 65535) {
+                throw std::out_of_range(entry);
+            }
+            port_budgets_[static_cast<uint16_t>(port)] = parseBudget(strip(entry.substr(colon + 1)));
+        } catch (const std::logic_error&) {
+            throw std::runtime_error("Invalid payload_budget entry '" + entry +
+                                     "' (expected port:bytes or port:full)");
+        }
+    }
+}
+
+std::string CaptureProfile::getName() const {
+    switch (mode_) {
+        case Mode::HEADERS: return "headers (" + std::to_string(snaplen_) + " bytes)";
+        case Mode::BUDGET:  return "budget";
+        case Mode::FULL:    break;
+    }
+    return "full";
+}
+
+size_t CaptureProfile::getPayloadBudget(uint16_t source_port, uint16_t destination_port) const {
+    if (port_budgets_.empty()) {
+        return default_budget_;
+    }
+
+    size_t budget = 0;
+    bool matched = false;
+    for (const uint16_t port : {source_port, destination_port}) {
+        const auto it = port_budgets_.find(port);
+        if (it != port_budgets_.end()) {
+            budget = std::max(budget, it->second);
+            matched = true;
+        }
+    }
+    return matched ? budget : default_budget_;
+}
@@ -0,0 +1,211 @@
+#include "core/DnsTracker.hpp"
+#include "config/ConfigManager.hpp"
+#include "protocols/DnsMessage.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// FNV-1a over what a response has to repeat from its query
+uint64_t hashQuestion(const DnsMessage& message) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](uint8_t byte) {
+        h = (h ^ byte) * 0x100000001b3ull;
+    };
+    for (const char c : message.getName()) {
+        mix(static_cast<uint8_t>(c));
+    }
+    mix(static_cast<uint8_t>(message.getType() >> 8));
+    mix(static_cast<uint8_t>(message.getType()));
+    mix(static_cast<uint8_t>(message.getClass() >> 8));
+    mix(static_cast<uint8_t>(message.getClass()));
+    return h;
+}
+
+} // namespace
+
+DnsTracker::DnsTracker(const DnsTrackerConfig& config)
+    : config_(config)
+    , slots_(config.queries)
+{
+    config_.queries = slots_.capacity();
+}
+
+DnsTrackerConfig DnsTracker::configFromSettings() {
+    auto& config = ConfigManager::getInstance();
+    DnsTrackerConfig dns;
+    dns.queries = static_cast<size_t>(std::max(1,
+        config.getInt("analysis", "dns_queries").value_or(static_cast<int>(dns.queries))));
+    dns.timeout = std::chrono::seconds(std::max(1,
+        config.getInt("analysis", "dns_timeout").value_or(static_cast<int>(dns.timeout.count()))));
+    return dns;
+}
+
+// ---------------------------------------------------------------------------
+// Messages in
+// ---------------------------------------------------------------------------
+
+void DnsTracker::add(const PacketView& packet, uint32_t weight, const Handler& handler) {
+    // What's left of a datagram the fragment reassembler gave up on
+    if (packet.reassembly == PacketView::Reassembly::INCOMPLETE) {
+        return;
+    }
+    const bool tcp = packet.isTCP();
+    if (!tcp && !packet.isUDP()) {
+        return;
+    }
+    const uint16_t source_port = packet.getSourcePort();
+    const uint16_t destination_port = packet.getDestinationPort();
+    if (source_port != PORT && destination_port != PORT) {
+        return;
+    }
+
+    const size_t offset = packet.getPayloadOffset();
+    const size_t length = packet.getPayloadLength();
+    if (length == 0 || offset == 0) {
+        return;     // TCP handshakes and ACKs, or a fragment without the transport header
+    }
+    expire(packet.timestamp, handler);
+
+    const size_t captured = packet.captured_length > offset
+        ? std::min(length, packet.captured_length - offset) : 0;
+    std::span<const uint8_t> message(packet.data + offset, captured);
+    if (tcp) {
+        // Over TCP each message has a two-byte length in front (RFC 1035
+        // 4.2.2); a segment holding anything else is part of a longer one
+        if (length < 2 || captured < 2 ||
+            static_cast<size_t>(message[0] << 8 | message[1]) != length - 2) {
+            return;
+        }
+        message = message.subspan(2);
+    }
+
+    DnsMessage dns;
+    if (captured < length || !dns.parse(message)) {
+        malformed_.store(malformed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    const bool response = dns.isResponse();
+    if (response ? source_port != PORT : destination_port != PORT) {
+        return;
+    }
+
+    const IpAddress client = response ? packet.destinationAddress() : packet.sourceAddress();
+    const IpAddress resolver = response ? packet.sourceAddress() : packet.destinationAddress();
+    const uint16_t client_port = response ? destination_port : source_port;
+    const uint64_t question = hashQuestion(dns);
+    const size_t bucket = bucketOf(client, client_port, resolver, dns.getId());
+    const uint32_t found = find(client, client_port, resolver, dns.getId(), bucket);
+
+    if (response) {
+        // Some resolvers leave the question out of FORMERR and SERVFAIL
+        // responses; those can only be matched on the id and addresses
+        if (found == NONE || (dns.getQuestionCount() > 0 && slots_[found].question != question)) {
+            unmatched_.store(unmatched_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        const Slot& slot = slots_[found];
+        Event event;
+        event.kind = Event::Kind::RESPONSE;
+        event.resolver = resolver;
+        event.weight = slot.weight;
+        event.latency = std::max(std::chrono::nanoseconds::zero(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(packet.timestamp - slot.sent));
+        event.rcode = dns.getRcode();
+        event.timestamp = packet.timestamp;
+        answered_.store(answered_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        release(found);
+        handler(event);
+        return;
+    }
+
+    if (found != NONE && slots_[found].question == question) {
+        retried_.store(retried_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    if (found != NONE) {
+        // Same id for another question: the client gave up on the first
+        timeOut(found, timed_out_, handler);
+    }
+    // A query pushed out unanswered counts as timed out, like one that waited
+    const uint32_t index = slots_.allocate(bucket, [&](uint32_t oldest) {
+        timeOut(oldest, evicted_, handler);
+    });
+    Slot& slot = slots_[index];
+    slot.client = client;
+    slot.resolver = resolver;
+    slot.client_port = client_port;
+    slot.id = dns.getId();
+    slot.question = question;
+    slot.weight = weight;
+    slot.sent = packet.timestamp;
+
+    queries_.store(queries_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    pending_.store(pending_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    Event event;
+    event.kind = Event::Kind::QUERY;
+    event.resolver = resolver;
+    event.weight = weight;
+    event.timestamp = packet.timestamp;
+    handler(event);
+}
+
+void DnsTracker::expire(std::chrono::system_clock::time_point now, const Handler& handler) {
+    while (slots_.oldest() != NONE && now - slots_[slots_.oldest()].sent > config_.timeout) {
+        timeOut(slots_.oldest(), timed_out_, handler);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Table
+// ---------------------------------------------------------------------------
+
+size_t DnsTracker::bucketOf(const IpAddress& client, uint16_t client_port,
+                            const IpAddress& resolver, uint16_t id) const {
+    uint64_t h = client.hash() * 0x9e3779b97f4a7c15ull;
+    h ^= resolver.hash() + 0x632be59bd9b4e019ull + (h << 6) + (h >> 2);
+    h ^= (static_cast<uint64_t>(client_port) << 16 | id) * 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return slots_.bucketOf(h);
+}
+
+uint32_t DnsTracker::find(const IpAddress& client, uint16_t client_port,
+                          const IpAddress& resolver, uint16_t id, size_t bucket) const {
+    return slots_.find(bucket, [&](const Slot& slot) {
+        return slot.id == id && slot.client_port == client_port &&
+               slot.client == client && slot.resolver == resolver;
+    });
+}
+
+void DnsTracker::release(uint32_t index) {
+    slots_.release(index);
+    pending_.store(pending_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+void DnsTracker::timeOut(uint32_t index, std::atomic<uint64_t>& counter, const Handler& handler) {
+    const Slot& slot = slots_[index];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    Event event;
+    event.kind = Event::Kind::TIMEOUT;
+    event.resolver = slot.resolver;
+    event.weight = slot.weight;
+    event.timestamp = slot.sent + config_.timeout;
+    handler(event);
+    release(index);
+}
+
+DnsTracker::Stats DnsTracker::getStats() const {
+    Stats stats;
+    stats.queries   = queries_.load(std::memory_order_relaxed);
+    stats.retried   = retried_.load(std::memory_order_relaxed);
+    stats.answered  = answered_.load(std::memory_order_relaxed);
+    stats.timed_out = timed_out_.load(std::memory_order_relaxed);
+    stats.evicted   = evicted_.load(std::memory_order_relaxed);
+    stats.unmatched = unmatched_.load(std::memory_order_relaxed);
+    stats.malformed = malformed_.load(std::memory_order_relaxed);
+    stats.pending   = pending_.load(std::memory_order_relaxed);
+    return stats;
+}
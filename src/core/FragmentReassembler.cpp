@@ -0,0 +1,370 @@
+#include "core/FragmentReassembler.hpp"
+#include "config/ConfigManager.hpp"
+#include "protocols/Checksum.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t IPV6_HEADER_LEN = 40;
+constexpr size_t FRAGMENT_HEADER_LEN = 8;
+
+void writeU16(uint8_t* p, size_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+} // namespace
+
+FragmentReassembler::FragmentReassembler(const FragmentReassemblerConfig& config)
+    : config_(config)
+    , slots_(config.slots)
+{
+    config_.slots = slots_.capacity();
+    for (uint32_t i = 0; i < slots_.capacity(); ++i) {
+        std::fill(std::begin(slots_[i].blocks), std::end(slots_[i].blocks), NONE);
+    }
+
+    const size_t blocks = std::max<size_t>(1, config_.memory / BLOCK_SIZE);
+    arena_.resize(blocks * BLOCK_SIZE);
+    free_blocks_.reserve(blocks);
+    for (size_t i = blocks; i > 0; --i) {
+        free_blocks_.push_back(static_cast<uint32_t>(i - 1));
+    }
+    output_.resize(MAX_HEADER + MAX_DATAGRAM);
+}
+
+FragmentReassemblerConfig FragmentReassembler::configFromSettings() {
+    auto& config = ConfigManager::getInstance();
+    FragmentReassemblerConfig reassembly;
+    reassembly.slots   = static_cast<size_t>(std::max(1,
+        config.getInt("monitoring", "reassembly_slots").value_or(static_cast<int>(reassembly.slots))));
+    reassembly.memory  = static_cast<size_t>(std::max(0,
+        config.getInt("monitoring", "reassembly_memory").value_or(static_cast<int>(reassembly.memory))));
+    reassembly.timeout = std::chrono::seconds(std::max(1,
+        config.getInt("monitoring", "reassembly_timeout")
+            .value_or(static_cast<int>(reassembly.timeout.count()))));
+    return reassembly;
+}
+
+// ---------------------------------------------------------------------------
+// Fragments in
+// ---------------------------------------------------------------------------
+
+void FragmentReassembler::add(const PacketView& fragment, uint32_t weight, const Handler& handler) {
+    fragments_.store(fragments_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    expire(fragment.timestamp, handler);
+
+    // A fragment the capture cut short can't be rebuilt, and an IPv6 atomic
+    // fragment (offset 0, no more to come) is already whole
+    const PacketView::Fragment& info = fragment.getFragment();
+    if (info.data_end > fragment.captured_length || info.data_offset > MAX_HEADER ||
+        info.data_end < info.data_offset || (info.offset == 0 && !info.more)) {
+        passed_.store(passed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        handler(fragment, weight);
+        return;
+    }
+
+    const IpAddress source = fragment.sourceAddress();
+    const IpAddress destination = fragment.destinationAddress();
+    const bool v6 = source.isV6();
+    const uint8_t protocol = v6 ? 0 : info.protocol;
+    const size_t bucket = bucketOf(source, destination, info.id, protocol);
+    uint32_t index = find(source, destination, info.id, protocol, bucket);
+    if (index == NONE) {
+        index = allocate(fragment, bucket, weight, handler);
+    }
+
+    Slot& slot = slots_[index];
+    slot.wire_bytes += fragment.length;
+    slot.last_seen = fragment.timestamp;
+    const uint32_t begin = info.offset;
+    const uint32_t end = begin + static_cast<uint32_t>(info.data_end - info.data_offset);
+
+    // The offset-0 fragment's headers are the ones the datagram is rebuilt
+    // with; until it arrives keep whichever came first, for reporting
+    if (slot.header_length == 0 || (begin == 0 && !slot.have_first)) {
+        slot.header_length = info.data_offset;
+        slot.network_offset = fragment.getNetworkOffset();
+        slot.next_header_offset = info.next_header_offset;
+        slot.have_first = begin == 0;
+        std::memcpy(slot.header, fragment.data, slot.header_length);
+    }
+
+    // Length of the rebuilt datagram's IP header, or IPv6 extension headers,
+    // which count against the 64 KB limit along with the data
+    const size_t prefix = v6
+        ? info.data_offset - FRAGMENT_HEADER_LEN - fragment.getNetworkOffset() - IPV6_HEADER_LEN
+        : info.data_offset - fragment.getNetworkOffset();
+
+    bool duplicate = false;
+    const bool valid =
+        (!info.more || (end - begin) % 8 == 0) &&
+        prefix + end <= MAX_DATAGRAM &&
+        (info.more ? !slot.have_last || end < slot.total
+                   : (!slot.have_last || end == slot.total) &&
+                     (slot.range_count == 0 || slot.ranges[slot.range_count - 1].end <= end)) &&
+        insertRange(slot, begin, end, duplicate);
+    if (!valid) {
+        drop(index, invalid_, handler);
+        return;
+    }
+
+    if (!duplicate) {
+        if (!store(index, fragment.data + info.data_offset, begin, end, handler)) {
+            drop(index, evicted_, handler);
+            return;
+        }
+        slot.received += end - begin;
+    }
+    if (!info.more) {
+        slot.have_last = true;
+        slot.total = end;
+    }
+    if (slot.have_last && slot.received == slot.total) {
+        complete(index, fragment, handler);
+    }
+}
+
+void FragmentReassembler::expire(std::chrono::system_clock::time_point now, const Handler& handler) {
+    while (slots_.oldest() != NONE && now - slots_[slots_.oldest()].first_seen > config_.timeout) {
+        drop(slots_.oldest(), timed_out_, handler);
+    }
+}
+
+void FragmentReassembler::flush(const Handler& handler) {
+    // Capture is over, so whatever is left would only have timed out
+    while (slots_.oldest() != NONE) {
+        drop(slots_.oldest(), timed_out_, handler);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Table
+// ---------------------------------------------------------------------------
+
+size_t FragmentReassembler::bucketOf(const IpAddress& source, const IpAddress& destination,
+                                     uint32_t id, uint8_t protocol) const {
+    uint64_t h = source.hash() * 0x9e3779b97f4a7c15ull;
+    h ^= destination.hash() + 0x632be59bd9b4e019ull + (h << 6) + (h >> 2);
+    h ^= (static_cast<uint64_t>(id) << 8 | protocol) * 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return slots_.bucketOf(h);
+}
+
+uint32_t FragmentReassembler::find(const IpAddress& source, const IpAddress& destination,
+                                   uint32_t id, uint8_t protocol, size_t bucket) const {
+    return slots_.find(bucket, [&](const Slot& slot) {
+        return slot.id == id && slot.protocol == protocol &&
+               slot.source == source && slot.destination == destination;
+    });
+}
+
+uint32_t FragmentReassembler::allocate(const PacketView& fragment, size_t bucket, uint32_t weight,
+                                       const Handler& handler) {
+    const uint32_t index = slots_.allocate(bucket, [&](uint32_t oldest) {
+        drop(oldest, evicted_, handler);
+    });
+    Slot& slot = slots_[index];
+
+    const PacketView::Fragment& info = fragment.getFragment();
+    slot.source = fragment.sourceAddress();
+    slot.destination = fragment.destinationAddress();
+    slot.id = info.id;
+    slot.protocol = slot.source.isV6() ? 0 : info.protocol;
+    slot.interface = fragment.interface;
+    slot.weight = weight;
+    slot.first_seen = fragment.timestamp;
+    slot.last_seen = fragment.timestamp;
+
+    pending_.store(pending_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return index;
+}
+
+void FragmentReassembler::release(uint32_t index) {
+    Slot& slot = slots_[index];
+    slots_.release(index);
+
+    size_t freed = 0;
+    for (uint32_t& block : slot.blocks) {
+        if (block != NONE) {
+            free_blocks_.push_back(block);
+            block = NONE;
+            ++freed;
+        }
+    }
+    blocks_used_.store(blocks_used_.load(std::memory_order_relaxed) - freed, std::memory_order_relaxed);
+    pending_.store(pending_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+    slot.wire_bytes = 0;
+    slot.total = 0;
+    slot.received = 0;
+    slot.have_last = false;
+    slot.range_count = 0;
+    slot.header_length = 0;
+    slot.have_first = false;
+}
+
+// ---------------------------------------------------------------------------
+// Fragment data
+// ---------------------------------------------------------------------------
+
+bool FragmentReassembler::insertRange(Slot& slot, uint32_t begin, uint32_t end,
+                                      bool& duplicate) const {
+    Range* ranges = slot.ranges;
+    size_t& count = slot.range_count;
+    if (begin == end) {
+        duplicate = true;
+        return true;
+    }
+
+    // First run that reaches begin
+    size_t i = 0;
+    while (i < count && ranges[i].end < begin) {
+        ++i;
+    }
+    // A resent fragment is harmless; one that overlaps others differently
+    // is the classic evasion trick, so the datagram is dropped (RFC 5722)
+    if (i < count && ranges[i].begin <= begin && end <= ranges[i].end) {
+        duplicate = true;
+        return true;
+    }
+    if (i < count && ranges[i].begin < end && begin < ranges[i].end) {
+        return false;
+    }
+
+    const bool join_previous = i < count && ranges[i].end == begin;
+    const size_t next = join_previous ? i + 1 : i;
+    if (next < count && ranges[next].begin < end) {
+        return false;
+    }
+    const bool join_next = next < count && ranges[next].begin == end;
+
+    if (join_previous && join_next) {
+        ranges[i].end = ranges[next].end;
+        std::copy(ranges + next + 1, ranges + count, ranges + next);
+        --count;
+    } else if (join_previous) {
+        ranges[i].end = end;
+    } else if (join_next) {
+        ranges[next].begin = begin;
+    } else {
+        if (count == MAX_RANGES) {
+            return false;
+        }
+        std::copy_backward(ranges + next, ranges + count, ranges + count + 1);
+        ranges[next] = {begin, end};
+        ++count;
+    }
+    return true;
+}
+
+bool FragmentReassembler::store(uint32_t index, const uint8_t* data, uint32_t begin, uint32_t end,
+                                const Handler& handler) {
+    Slot& slot = slots_[index];
+    for (uint32_t position = begin; position < end;) {
+        uint32_t& block = slot.blocks[position / BLOCK_SIZE];
+        if (block == NONE) {
+            // Out of memory: push out the oldest other datagrams until a
+            // block is free, or give up on this one if it is the only one
+            while (free_blocks_.empty()) {
+                const uint32_t victim = slots_.oldest() != index ? slots_.oldest() : slots_.newer(index);
+                if (victim == NONE) {
+                    return false;
+                }
+                drop(victim, evicted_, handler);
+            }
+            block = free_blocks_.back();
+            free_blocks_.pop_back();
+            blocks_used_.store(blocks_used_.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+        }
+
+        const uint32_t within = position % BLOCK_SIZE;
+        const uint32_t length = std::min<uint32_t>(end - position, BLOCK_SIZE - within);
+        std::memcpy(arena_.data() + static_cast<size_t>(block) * BLOCK_SIZE + within,
+                    data + (position - begin), length);
+        position += length;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Datagrams out
+// ---------------------------------------------------------------------------
+
+void FragmentReassembler::complete(uint32_t index, const PacketView& last, const Handler& handler) {
+    const Slot& slot = slots_[index];
+    const bool v6 = slot.source.isV6();
+
+    // Headers of the offset-0 fragment, minus the IPv6 Fragment header. Its
+    // IP header may be longer than the one the size limit was checked with.
+    const size_t header_length = v6 ? slot.header_length - FRAGMENT_HEADER_LEN : slot.header_length;
+    const size_t prefix = header_length - slot.network_offset - (v6 ? IPV6_HEADER_LEN : 0);
+    if (prefix + slot.total > MAX_DATAGRAM) {
+        drop(index, invalid_, handler);
+        return;
+    }
+    uint8_t* out = output_.data();
+    std::memcpy(out, slot.header, header_length);
+    for (size_t position = 0; position < slot.total; position += BLOCK_SIZE) {
+        std::memcpy(out + header_length + position,
+                    arena_.data() + static_cast<size_t>(slot.blocks[position / BLOCK_SIZE]) * BLOCK_SIZE,
+                    std::min<size_t>(BLOCK_SIZE, slot.total - position));
+    }
+
+    uint8_t* ip = out + slot.network_offset;
+    if (v6) {
+        // Whatever named the Fragment header now names what it carried
+        out[slot.next_header_offset] = slot.header[slot.header_length - FRAGMENT_HEADER_LEN];
+        writeU16(ip + 4, header_length - slot.network_offset - IPV6_HEADER_LEN + slot.total);
+    } else {
+        // One unfragmented datagram: keep DF, clear MF and the offset, and
+        // fix the checksum so it isn't reported as bad
+        const size_t ip_header_length = static_cast<size_t>(ip[0] & 0x0f) * 4;
+        writeU16(ip + 2, header_length - slot.network_offset + slot.total);
+        ip[6] &= 0x40;
+        ip[7] = 0;
+        ip[10] = 0;
+        ip[11] = 0;
+        const uint16_t checksum = static_cast<uint16_t>(
+            ~InternetChecksum::fold(InternetChecksum::sum(ip, ip_header_length)));
+        std::memcpy(ip + 10, &checksum, sizeof(checksum));
+    }
+
+    PacketView datagram(out, header_length + slot.total, slot.wire_bytes, last.timestamp);
+    datagram.interface = last.interface;
+    datagram.reassembly = PacketView::Reassembly::COMPLETE;
+    const uint32_t weight = slot.weight;
+    release(index);
+    reassembled_.store(reassembled_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    handler(datagram, weight);
+}
+
+void FragmentReassembler::drop(uint32_t index, std::atomic<uint64_t>& counter,
+                               const Handler& handler) {
+    const Slot& slot = slots_[index];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // The view points into the slot, so hand it on before the slot is freed
+    PacketView datagram(slot.header, slot.header_length, slot.wire_bytes, slot.last_seen);
+    datagram.interface = slot.interface;
+    datagram.reassembly = PacketView::Reassembly::INCOMPLETE;
+    handler(datagram, slot.weight);
+    release(index);
+}
+
+FragmentReassembler::Stats FragmentReassembler::getStats() const {
+    Stats stats;
+    stats.fragments       = fragments_.load(std::memory_order_relaxed);
+    stats.reassembled     = reassembled_.load(std::memory_order_relaxed);
+    stats.timed_out       = timed_out_.load(std::memory_order_relaxed);
+    stats.evicted         = evicted_.load(std::memory_order_relaxed);
+    stats.invalid         = invalid_.load(std::memory_order_relaxed);
+    stats.passed          = passed_.load(std::memory_order_relaxed);
+    stats.pending         = pending_.load(std::memory_order_relaxed);
+    stats.memory_used     = blocks_used_.load(std::memory_order_relaxed) * BLOCK_SIZE;
+    stats.memory_capacity = arena_.size();
+    return stats;
+}
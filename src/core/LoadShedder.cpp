@@ -0,0 +1,177 @@
+#include "core/LoadShedder.hpp"
+#include "config/ConfigManager.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr size_t ETHERNET_HEADER_LEN = 14;
+
+uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// Murmur3 finaliser: cheap and spreads nearby addresses across the space
+uint32_t mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t hashBytes(const uint8_t* p, size_t length) {
+    uint32_t h = 0x9747b28cu;
+    for (size_t i = 0; i + 4 <= length; i += 4) {
+        uint32_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        h = mix(h ^ word);
+    }
+    return h;
+}
+
+} // namespace
+
+LoadShedder::LoadShedder(const LoadShedConfig& config)
+    : config_(config) {
+    config_.max_rate = std::bit_ceil(std::clamp<uint32_t>(config_.max_rate, 1, 1u << 30));
+}
+
+LoadShedConfig LoadShedder::configFromSettings() {
+    auto& config = ConfigManager::getInstance();
+    LoadShedConfig shed;
+    shed.enabled           = config.getBool("monitoring", "load_shedding").value_or(shed.enabled);
+    shed.drop_watermark    = config.getDouble("monitoring", "shed_drop_watermark")
+                                 .value_or(shed.drop_watermark);
+    shed.backlog_watermark = static_cast<uint64_t>(std::max(0,
+        config.getInt("monitoring", "shed_backlog_watermark")
+            .value_or(static_cast<int>(shed.backlog_watermark))));
+    shed.max_rate          = static_cast<uint32_t>(std::max(1,
+        config.getInt("monitoring", "shed_max_rate").value_or(static_cast<int>(shed.max_rate))));
+    shed.interval          = std::chrono::milliseconds(std::max(100,
+        config.getInt("monitoring", "shed_interval").value_or(static_cast<int>(shed.interval.count()))));
+    shed.recover_intervals = std::max(1,
+        config.getInt("monitoring", "shed_recover_intervals").value_or(shed.recover_intervals));
+    return shed;
+}
+
+uint32_t LoadShedder::flowHash(const CaptureFrame& frame, bool& has_flow) {
+    has_flow = false;
+    const uint8_t* data = frame.data;
+    const size_t caplen = frame.caplen;
+    if (data == nullptr || caplen < ETHERNET_HEADER_LEN) {
+        return 0;
+    }
+
+    size_t offset = ETHERNET_HEADER_LEN;
+    uint16_t ether_type = readU16(data + 12);
+    while ((ether_type == 0x8100 || ether_type == 0x88a8) && offset + 4 <= caplen) {
+        ether_type = readU16(data + offset + 2);
+        offset += 4;
+    }
+
+    const uint8_t* src = nullptr;
+    const uint8_t* dst = nullptr;
+    size_t address_len = 0;
+    size_t transport = 0;
+    uint8_t protocol = 0;
+    bool fragment = false;
+
+    if (ether_type == 0x0800 && offset + 20 <= caplen) {
+        const uint8_t* ip = data + offset;
+        address_len    = 4;
+        src            = ip + 12;
+        dst            = ip + 16;
+        protocol       = ip[9];
+        transport      = offset + static_cast<size_t>(ip[0] & 0x0f) * 4;
+        fragment       = (readU16(ip + 6) & 0x3fff) != 0;
+    } else if (ether_type == 0x86dd && offset + 40 <= caplen) {
+        const uint8_t* ip = data + offset;
+        address_len = 16;
+        src         = ip + 8;
+        dst         = ip + 24;
+        protocol    = ip[6];
+        transport   = offset + 40;
+    } else {
+        return 0;
+    }
+
+    // Summing the per-endpoint hashes makes the result the same for both
+    // directions of a flow. Only the first fragment has ports, so fragments
+    // hash on addresses alone and a datagram is kept or skipped whole.
+    uint32_t src_hash = hashBytes(src, address_len);
+    uint32_t dst_hash = hashBytes(dst, address_len);
+    if ((protocol == 6 || protocol == 17) && !fragment && transport + 4 <= caplen) {
+        src_hash = mix(src_hash ^ readU16(data + transport));
+        dst_hash = mix(dst_hash ^ readU16(data + transport + 2));
+    }
+
+    has_flow = true;
+    return mix(src_hash + dst_hash + protocol);
+}
+
+uint32_t LoadShedder::admit(const CaptureFrame& frame) const {
+    const uint32_t rate = getRate();
+    if (rate == 1) {
+        return 1;
+    }
+
+    bool has_flow = false;
+    const uint32_t hash = flowHash(frame, has_flow);
+    if (!has_flow) {
+        return 1;
+    }
+    return (hash & (rate - 1)) == 0 ? rate : 0;
+}
+
+bool LoadShedder::update(uint64_t received, uint64_t dropped, size_t backlog, std::string& reason) {
+    // Counters can go backwards when a socket is reopened
+    const uint64_t received_delta = received >= last_received_ ? received - last_received_ : received;
+    const uint64_t dropped_delta  = dropped >= last_dropped_ ? dropped - last_dropped_ : dropped;
+    last_received_ = received;
+    last_dropped_  = dropped;
+
+    if (!config_.enabled) {
+        return false;
+    }
+
+    const uint64_t offered = std::max(received_delta, dropped_delta);
+    const double drop_ratio = offered ? static_cast<double>(dropped_delta) / offered : 0.0;
+    const bool dropping = drop_ratio > config_.drop_watermark;
+    const bool backlogged = backlog > config_.backlog_watermark;
+
+    const uint32_t rate = getRate();
+    std::ostringstream why;
+
+    if (dropping || backlogged) {
+        calm_intervals_ = 0;
+        if (rate >= config_.max_rate) {
+            return false;
+        }
+        if (dropping) {
+            why << std::fixed << std::setprecision(2) << "kernel dropped "
+                << drop_ratio * 100.0 << "% of frames";
+        } else {
+            why << "store backlog at " << backlog << " packets";
+        }
+        rate_.store(rate * 2, std::memory_order_relaxed);
+    } else {
+        // Step back down only once the pipeline has kept up for a while and
+        // the backlog has drained well below the watermark
+        if (rate == 1 || backlog > config_.backlog_watermark / 2 ||
+            ++calm_intervals_ < config_.recover_intervals) {
+            return false;
+        }
+        calm_intervals_ = 0;
+        why << "no drops for " << config_.recover_intervals << " intervals";
+        rate_.store(rate / 2, std::memory_order_relaxed);
+    }
+
+    ++transitions_;
+    reason = why.str();
+    return true;
+}
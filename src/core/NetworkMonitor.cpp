@@ -2,12 +2,27 @@
 #include "core/NetworkMonitor.hpp"
 #include "utils/Logger.hpp"
 #include "config/ConfigManager.hpp"
+#include "analysis/ApplicationDetector.hpp"
+#include "analysis/ClientHelloAnalyzer.hpp"
+#include "core/PcapCaptureSource.hpp"
+#include "core/ReplayCaptureSource.hpp"
+#include "core/TPacketCaptureSource.hpp"
+#include "protocols/Checksum.hpp"
 
+#include <QMetaMethod>
 #include <pcap.h>
 #include <stdexcept>
 #include <chrono>
 #include <thread>
 #include <cstring>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <unistd.h>
 
 // ---------------------------------------------------------------------------
 // Constructor / Destructor
@@ -16,9 +31,17 @@
 NetworkMonitor::NetworkMonitor(QObject* parent)
     : QObject(parent)
     , m_running(false)
-    , m_handle(nullptr)
-    , m_totalPackets(0)
-    , m_totalBytes(0)
+    , m_profileStages(false)
+    , m_eagerDecode(false)
+    , m_fanoutGroup(1)
+    , m_statisticsDepth(PacketView::Layer::APPLICATION)
+    , m_retainPackets(true)
+    , m_finishedWorkers(0)
+    , m_filterGeneration(0)
+    , m_dataStore(
+          ConfigManager::getInstance().getString("general", "database").value_or("network_monitor.db"),
+          static_cast<size_t>(std::max(1, ConfigManager::getInstance()
+              .getInt("storage", "ring_depth").value_or(65536))))
 {
     Logger::getInstance().log(LogLevel::DEBUG, "NetworkMonitor constructed.");
 }
@@ -32,11 +55,137 @@ NetworkMonitor::~NetworkMonitor() {
 // Initialisation
 // ---------------------------------------------------------------------------
 
+namespace {
+
+// How deep statistics decode each packet: network counts hosts only,
+// transport adds ports and connections, application adds classification
+PacketView::Layer statisticsDepthFromConfig() {
+    const std::string depth = ConfigManager::getInstance()
+        .getString("analysis", "statistics_depth").value_or("application");
+    if (depth == "application") return PacketView::Layer::APPLICATION;
+    if (depth == "transport")   return PacketView::Layer::TRANSPORT;
+    if (depth == "network")     return PacketView::Layer::NETWORK;
+    throw std::runtime_error("Unknown statistics_depth '" + depth +
+                             "' (expected application, transport or network)");
+}
+
+bool eagerDecodeFromConfig() {
+    const std::string mode = ConfigManager::getInstance()
+        .getString("monitoring", "decode").value_or("lazy");
+    if (mode == "lazy")  return false;
+    if (mode == "eager") return true;
+    throw std::runtime_error("Unknown decode mode '" + mode + "' (expected lazy or eager)");
+}
+
+// First PACKET_FANOUT group id. Group 0 would make TPacketCaptureSource skip
+// fanout and give every worker all of the traffic, so ids stay in 1..0xffff.
+uint16_t fanoutGroupFromConfig() {
+    const auto configured = ConfigManager::getInstance().getInt("monitoring", "fanout_group");
+    if (!configured) {
+        return static_cast<uint16_t>(getpid() % 0xffff + 1);
+    }
+    if (*configured < 1 || *configured > 0xffff) {
+        throw std::runtime_error("fanout_group " + std::to_string(*configured) +
+                                 " is out of range (expected 1 to 65535)");
+    }
+    return static_cast<uint16_t>(*configured);
+}
+
+// Group for the interface at index: the ids after first, going on from
+// 0xffff to 1 rather than through 0
+uint16_t fanoutGroupFor(uint16_t first, size_t index) {
+    return static_cast<uint16_t>((first - 1 + index) % 0xffff + 1);
+}
+
+// Every address configured on this host; empty if they can't be listed
+std::vector<IpAddress> listLocalAddresses() {
+    std::vector<IpAddress> addresses;
+    ifaddrs* list = nullptr;
+    if (getifaddrs(&list) != 0) {
+        return addresses;
+    }
+    for (const ifaddrs* entry = list; entry; entry = entry->ifa_next) {
+        const sockaddr* address = entry->ifa_addr;
+        if (!address) {
+            continue;
+        }
+        if (address->sa_family == AF_INET) {
+            addresses.push_back(IpAddress::fromV4(reinterpret_cast<const uint8_t*>(
+                &reinterpret_cast<const sockaddr_in*>(address)->sin_addr)));
+        } else if (address->sa_family == AF_INET6) {
+            addresses.push_back(IpAddress::fromV6(reinterpret_cast<const uint8_t*>(
+                &reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr)));
+        }
+    }
+    freeifaddrs(list);
+    return addresses;
+}
+
+// What each worker's stream reassembler hands TCP connections to
+std::vector<std::unique_ptr<StreamAnalyzer>> makeStreamAnalyzers(
+        const std::shared_ptr<const SignatureAnalyzer::Signatures>& signatures) {
+    std::vector<std::unique_ptr<StreamAnalyzer>> analyzers;
+    analyzers.push_back(std::make_unique<ApplicationDetector>());
+    analyzers.push_back(std::make_unique<ClientHelloAnalyzer>());
+    if (signatures) {
+        analyzers.push_back(std::make_unique<SignatureAnalyzer>(signatures));
+    }
+    return analyzers;
+}
+
+// Counts what a worker's DNS tracker saw into its statistics shard
+void recordDnsEvent(Statistics& statistics, const DnsTracker::Event& event) {
+    switch (event.kind) {
+        case DnsTracker::Event::Kind::QUERY:
+            statistics.recordDnsQuery(event.resolver, event.weight, event.timestamp);
+            break;
+        case DnsTracker::Event::Kind::RESPONSE:
+            statistics.recordDnsResponse(event.resolver, event.latency, event.rcode,
+                                         event.weight, event.timestamp);
+            break;
+        case DnsTracker::Event::Kind::TIMEOUT:
+            statistics.recordDnsTimeout(event.resolver, event.weight);
+            break;
+    }
+}
+
+} // namespace
+
 bool NetworkMonitor::initialize() {
     auto& config = ConfigManager::getInstance();
-    m_interface  = config.getInterface();
+    m_interfaces = config.getInterfaces();
+    m_readFile   = config.getString("monitoring", "read_file").value_or("");
+    m_profileStages = !m_readFile.empty() ||
+        config.getBool("monitoring", "profile_stages").value_or(false);
 
-    if (m_interface.empty()) {
+    // Apply the configured profile and capture filter; a bad value is fatal
+    // here rather than silently capturing everything. The profile's snaplen
+    // is compiled into the filter, so even an empty expression is installed
+    // when it truncates.
+    const std::string filter = config.getString("monitoring", "filter").value_or("");
+    try {
+        m_captureProfile = CaptureProfile::fromConfig();
+        m_statisticsDepth = statisticsDepthFromConfig();
+        m_eagerDecode = eagerDecodeFromConfig();
+        m_fanoutGroup = fanoutGroupFromConfig();
+        m_signatures = SignatureAnalyzer::fromConfig();
+        if (!filter.empty() || m_captureProfile.getSnaplen() < PacketFilter::MAX_SNAPLEN) {
+            setFilter(filter);
+        }
+    } catch (const std::exception& e) {
+        Logger::getInstance().log(LogLevel::ERROR, e.what());
+        return false;
+    }
+
+    if (!m_readFile.empty()) {
+        // Offline replay: the file stands in for the interface
+        m_interfaces = {m_readFile};
+        Logger::getInstance().log(LogLevel::INFO,
+            "NetworkMonitor initialised for replay of: " + m_readFile);
+        return true;
+    }
+
+    if (m_interfaces.empty()) {
         // Attempt automatic interface discovery when none is configured
         char errBuf[PCAP_ERRBUF_SIZE];
         pcap_if_t* allDevs = nullptr;
@@ -47,14 +196,14 @@ bool NetworkMonitor::initialize() {
             return false;
         }
 
-        m_interface = allDevs->name;   // Pick the first available interface
+        m_interfaces = {allDevs->name};   // Pick the first available interface
         pcap_freealldevs(allDevs);
         Logger::getInstance().log(LogLevel::INFO,
-            "Auto-selected interface: " + m_interface);
+            "Auto-selected interface: " + m_interfaces.front());
     }
 
     Logger::getInstance().log(LogLevel::INFO,
-        "NetworkMonitor initialised on interface: " + m_interface);
+        "NetworkMonitor initialised on interface: " + getInterface());
     return true;
 }
 
@@ -69,113 +218,739 @@ void NetworkMonitor::start() {
         return;
     }
 
-    char errBuf[PCAP_ERRBUF_SIZE];
+    auto& config = ConfigManager::getInstance();
+    const size_t ringDepth = static_cast<size_t>(
+        std::max(1, config.getInt("monitoring", "analysis_ring_depth").value_or(8192)));
+    const bool verifyChecksums = config.getBool("analysis", "verify_checksums").value_or(true);
+    const size_t poolSize = static_cast<size_t>(
+        std::max(0, config.getInt("monitoring", "packet_pool_size").value_or(8192)));
+    const bool reassemble = config.getBool("monitoring", "reassembly").value_or(true);
+    const FragmentReassemblerConfig reassembly = FragmentReassembler::configFromSettings();
+    // Streams only refine application classification, so shallower
+    // statistics have no use for them
+    const bool followStreams = m_statisticsDepth == PacketView::Layer::APPLICATION &&
+        config.getBool("analysis", "stream_reassembly").value_or(true);
+    const StreamReassemblerConfig streams = StreamReassembler::configFromSettings();
+    const bool trackDns = m_statisticsDepth == PacketView::Layer::APPLICATION &&
+        config.getBool("analysis", "dns_tracking").value_or(true);
+    const DnsTrackerConfig dns = DnsTracker::configFromSettings();
+    // Live backends that can't flag frames left for checksum offload need to
+    // know which frames this host sent; a replayed file came from elsewhere
+    const bool checkTransportChecksums = verifyChecksums && m_statisticsDepth >= PacketView::Layer::TRANSPORT;
+    m_localAddresses = m_readFile.empty() && checkTransportChecksums
+        ? listLocalAddresses() : std::vector<IpAddress>();
+    const std::chrono::milliseconds statisticsInterval = StatisticsShard::intervalFromSettings();
+    const size_t snapshotEntries = StatisticsShard::snapshotEntriesFromSettings();
+    const std::chrono::seconds connectionTimeout(
+        config.getInt("analysis", "connection_timeout").value_or(300));
+    // Finished connections go to the flows table; replay waits for room
+    // like it does for packets
+    Statistics::FlowRecordHandler storeFlow;
+    if (config.getBool("storage", "store_flows").value_or(true)) {
+        if (m_readFile.empty()) {
+            storeFlow = [this](FlowRecord&& flow) { m_dataStore.tryStoreFlow(std::move(flow)); };
+        } else {
+            storeFlow = [this](FlowRecord&& flow) { m_dataStore.storeFlow(std::move(flow)); };
+        }
+    }
 
-    // Open the interface in promiscuous mode so we capture all frames,
-    // not just those addressed to this host.
-    m_handle = pcap_open_live(
-        m_interface.c_str(),
-        BUFSIZ,   // Snapshot length — maximum bytes per packet
-        1,        // Promiscuous mode ON
-        100,      // Read timeout in milliseconds
-        errBuf
-    );
+    // A file has a single reader, so replay always runs one worker
+    const size_t workerCount = !m_readFile.empty() ? 1 : static_cast<size_t>(
+        std::max(1, config.getInt("monitoring", "capture_workers").value_or(1)));
+
+    m_workers.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_statisticsMutex);
+        m_statistics.reset();
+    }
+    m_xdpPrograms.assign(m_interfaces.size(), nullptr);
+    for (size_t iface = 0; iface < m_interfaces.size(); ++iface) {
+        // Sockets in the same fanout group split the interface's traffic
+        // between them; the id only has to be unique among processes on this
+        // host, and each interface needs its own
+        const uint16_t group = workerCount > 1 ? fanoutGroupFor(m_fanoutGroup, iface) : 0;
+        if (workerCount > 1 && group == 0) {
+            Logger::getInstance().log(LogLevel::ERROR,
+                "No fanout group for " + m_interfaces[iface] + "; not capturing on it");
+            continue;
+        }
 
-    if (m_handle == nullptr) {
-        Logger::getInstance().log(LogLevel::ERROR,
-            "pcap_open_live failed: " + std::string(errBuf));
+        // An interface that fails to open is skipped; the others still run
+        for (size_t i = 0; i < workerCount; ++i) {
+            auto source = openCaptureSource(iface, i, group);
+            if (!source) {
+                break;
+            }
+
+            auto worker = std::make_unique<CaptureWorker>();
+            worker->index          = m_workers.size();
+            worker->interfaceIndex = iface;
+            worker->interface      = m_interfaces[iface];
+            worker->source         = std::move(source);
+            worker->pool           = poolSize ? std::make_unique<PacketPool>(poolSize) : nullptr;
+            worker->ring           = std::make_unique<SpscRing<Packet>>(ringDepth);
+            worker->reassembler    = reassemble ? std::make_unique<FragmentReassembler>(reassembly) : nullptr;
+            worker->streams        = followStreams
+                ? std::make_unique<StreamReassembler>(streams, makeStreamAnalyzers(m_signatures)) : nullptr;
+            worker->dns            = trackDns ? std::make_unique<DnsTracker>(dns) : nullptr;
+            worker->skipLocalChecksums = !m_localAddresses.empty() &&
+                !worker->source->reportsChecksumOffload();
+            worker->dnsEvents      = [statistics = &worker->statistics.getWorkingCopy()](
+                                         const DnsTracker::Event& event) {
+                recordDnsEvent(*statistics, event);
+            };
+            worker->statistics.setInterval(statisticsInterval);
+            worker->statistics.setSnapshotEntries(snapshotEntries);
+            worker->statistics.getWorkingCopy().setDepth(m_statisticsDepth);
+            worker->statistics.getWorkingCopy().setChecksumValidation(verifyChecksums);
+            worker->statistics.getWorkingCopy().setConnectionTimeout(connectionTimeout);
+            worker->statistics.getWorkingCopy().setInterfaces(m_interfaces);
+            worker->statistics.getWorkingCopy().setFlowRecordHandler(storeFlow);
+            const bool sharded = worker->source->getName() != "pcap";
+            m_workers.push_back(std::move(worker));
+
+            if (!sharded && workerCount > 1) {
+                Logger::getInstance().log(LogLevel::WARNING,
+                    "Multiple capture workers require the tpacket_v3 or af_xdp "
+                    "backend; running a single capture worker on " + m_interfaces[iface] + ".");
+                break;
+            }
+        }
+    }
+
+    if (m_workers.empty()) {
         return;
     }
 
+    const FilterBaseline baseline = takeFilterBaseline();
+    {
+        std::lock_guard<std::mutex> lock(m_filterMutex);
+        m_filterBaseline = baseline;
+    }
+
+    // Replay can't drop frames, it just runs slower, so it never sheds
+    // Without storage or a packetCaptured listener nothing reads the owning
+    // copy, so skip it and leave each packet as deep as statistics decoded
+    m_retainPackets = config.getBool("storage", "store_packets").value_or(true) ||
+        isSignalConnected(QMetaMethod::fromSignal(&NetworkMonitor::packetCaptured));
+
+    LoadShedConfig shed = LoadShedder::configFromSettings();
+    shed.enabled = shed.enabled && m_readFile.empty();
+    m_loadShedder = std::make_unique<LoadShedder>(shed);
+
     m_running = true;
+    m_finishedWorkers = 0;
+    m_startTime = std::chrono::steady_clock::now();
+    m_nextLoadCheck = m_startTime + shed.interval;
 
-    // Spin up a dedicated capture thread so the GUI event loop is never blocked
-    m_captureThread = std::thread(&NetworkMonitor::captureLoop, this);
+    // Spin up dedicated capture and analysis threads so the GUI event loop
+    // is never blocked
+    for (auto& worker : m_workers) {
+        worker->analysisThread = std::thread(&NetworkMonitor::analysisLoop, this, std::ref(*worker));
+        worker->thread = std::thread(&NetworkMonitor::captureLoop, this, std::ref(*worker));
+    }
 
     Logger::getInstance().log(LogLevel::INFO,
-        "Packet capture started on: " + m_interface);
+        "Packet capture started on: " + getInterface() +
+        " (backend: " + m_workers.front()->source->getName() +
+        ", profile: " + m_captureProfile.getName() +
+        ", workers: " + std::to_string(m_workers.size()) +
+        ", checksums: " + (verifyChecksums ? InternetChecksum::getImplementation() : "off") +
+        ", signatures: " + (followStreams && m_signatures
+            ? std::to_string(m_signatures->matcher.size()) + " (" + m_signatures->matcher.getEngine() + ")"
+            : std::string("off")) + ")");
     emit monitoringStarted();
 }
 
 void NetworkMonitor::stop() {
-    if (!m_running.load()) return;
-
-    m_running = false;   // Signal the capture thread to exit its loop
+    m_running = false;   // Signal the capture threads to exit their loops
 
-    if (m_captureThread.joinable()) {
-        m_captureThread.join();   // Wait for clean exit
+    // Threads that already hit EOF still need joining, so check for
+    // joinable threads rather than the running flag
+    bool stopped = false;
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();   // Wait for clean exit
+            worker->source->close();
+            stopped = true;
+        }
     }
-
-    if (m_handle) {
-        pcap_close(m_handle);
-        m_handle = nullptr;
+    // Analysis threads drain whatever is still queued before exiting
+    for (auto& worker : m_workers) {
+        if (worker->analysisThread.joinable()) {
+            worker->analysisThread.join();
+        }
     }
+    // Stored packets return to the workers' pools once written, so the
+    // pools can't go away with the workers until the writer is done
+    m_dataStore.flush();
+    if (!stopped) return;
+
+    // Detach the XDP programs once no socket is bound to the interfaces
+    m_xdpPrograms.clear();
 
     Logger::getInstance().log(LogLevel::INFO, "Packet capture stopped.");
     emit monitoringStopped();
 }
 
 // ---------------------------------------------------------------------------
-// Capture loop (runs on m_captureThread)
+// Capture backend selection
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<CaptureSource> NetworkMonitor::openCaptureSource(size_t interfaceIndex,
+                                                                 size_t workerIndex,
+                                                                 uint16_t fanoutGroup)
+{
+    // Only the first socket on an interface may fall back to pcap; a pcap
+    // handle next to sharded sockets would see every packet a second time.
+    const bool allowFallback = workerIndex == 0;
+    const std::string& interface = m_interfaces[interfaceIndex];
+    auto& xdpProgram = m_xdpPrograms[interfaceIndex];
+
+    auto& config = ConfigManager::getInstance();
+
+    if (!m_readFile.empty()) {
+        auto source = std::make_unique<ReplayCaptureSource>(
+            config.getDouble("monitoring", "replay_speed").value_or(0.0));
+        if (!source->open(m_readFile)) {
+            Logger::getInstance().log(LogLevel::ERROR, source->getLastError());
+            return nullptr;
+        }
+        return source;
+    }
+
+    const std::string backend =
+        config.getString("monitoring", "capture_backend").value_or("pcap");
+    const bool promiscuous =
+        config.getBool("monitoring", "promiscuous_mode").value_or(true);
+
+    if (backend == "af_xdp") {
+        // The program redirects every frame on a bound queue away from the
+        // kernel, so the host's own traffic on that port would vanish
+        if (!config.getBool("monitoring", "xdp_dedicated_port").value_or(false)) {
+            Logger::getInstance().log(LogLevel::ERROR,
+                "af_xdp takes every frame on " + interface + " away from the host; "
+                "set xdp_dedicated_port = true if the port only receives mirrored traffic");
+            return nullptr;
+        }
+        if (!xdpProgram) {
+            xdpProgram = std::make_shared<XdpRedirectProgram>();
+        }
+
+        // Each worker analyses streams and DNS on its own queue, so the
+        // NIC has to keep both directions of a flow together
+        std::string why;
+        if (workerIndex == 1 && !hasSymmetricRss(interface, why)) {
+            Logger::getInstance().log(LogLevel::WARNING,
+                "Stream and DNS analysis on " + interface + " will miss flows split between "
+                "queues (" + why + "); see the af_xdp notes in the README");
+        }
+
+        XdpConfig xdp;
+        xdp.queue_id    = static_cast<uint32_t>(
+            config.getInt("monitoring", "xdp_queue").value_or(0) + workerIndex);
+        xdp.frame_count = config.getInt("monitoring", "xdp_frame_count").value_or(xdp.frame_count);
+        xdp.ring_size   = config.getInt("monitoring", "xdp_ring_size").value_or(xdp.ring_size);
+        xdp.skb_mode    = config.getString("monitoring", "xdp_mode").value_or("skb") != "native";
+        xdp.zero_copy   = config.getBool("monitoring", "xdp_zero_copy").value_or(false);
+        xdp.program     = xdpProgram;
+
+        auto source = std::make_unique<XdpCaptureSource>(xdp);
+        if (source->open(interface)) {
+            return source;
+        }
+
+        if (!allowFallback) {
+            Logger::getInstance().log(LogLevel::ERROR,
+                "Failed to open AF_XDP socket on " + interface + " queue " +
+                std::to_string(xdp.queue_id) + ": " + source->getLastError());
+            return nullptr;
+        }
+
+        xdpProgram.reset();
+        Logger::getInstance().log(LogLevel::WARNING,
+            "AF_XDP capture unavailable on " + interface + ", falling back to pcap: " +
+            source->getLastError());
+    } else if (backend == "tpacket_v3") {
+        TPacketRingConfig ring;
+        ring.block_size       = config.getInt("monitoring", "ring_block_size").value_or(ring.block_size);
+        ring.block_count      = config.getInt("monitoring", "ring_block_count").value_or(ring.block_count);
+        ring.block_timeout_ms = config.getInt("monitoring", "ring_block_timeout").value_or(ring.block_timeout_ms);
+        ring.promiscuous      = promiscuous;
+        ring.fanout_group     = fanoutGroup;
+
+        auto source = std::make_unique<TPacketCaptureSource>(ring);
+        if (source->open(interface)) {
+            return source;
+        }
+
+        if (!allowFallback) {
+            Logger::getInstance().log(LogLevel::ERROR,
+                "Failed to open fanout capture socket on " + interface + ": " +
+                source->getLastError());
+            return nullptr;
+        }
+
+        // Missing CAP_NET_RAW, non-Linux host, etc. — fall back to libpcap
+        Logger::getInstance().log(LogLevel::WARNING,
+            "TPACKET_V3 capture unavailable on " + interface + ", falling back to pcap: " +
+            source->getLastError());
+    } else if (backend != "pcap") {
+        Logger::getInstance().log(LogLevel::WARNING,
+            "Unknown capture_backend '" + backend + "', using pcap.");
+    }
+
+    // Open the interface in promiscuous mode so we capture all frames,
+    // not just those addressed to this host.
+    auto source = std::make_unique<PcapCaptureSource>(
+        static_cast<int>(m_captureProfile.getSnaplen()),   // Maximum bytes per packet
+        promiscuous,
+        100            // Read timeout in milliseconds
+    );
+    if (!source->open(interface)) {
+        Logger::getInstance().log(LogLevel::ERROR, interface + ": " + source->getLastError());
+        return nullptr;
+    }
+    return source;
+}
+
+// ---------------------------------------------------------------------------
+// Capture and analysis loops (one of each per worker)
 // ---------------------------------------------------------------------------
 
-void NetworkMonitor::captureLoop() {
-    struct pcap_pkthdr* header = nullptr;
-    const u_char*       data   = nullptr;
+// Charges the time since the previous lap to one pipeline stage. Reads no
+// clock unless stages are being profiled.
+class NetworkMonitor::StageClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StageClock(bool enabled)
+        : enabled_(enabled)
+        , mark_(enabled ? Clock::now() : Clock::time_point{}) {
+    }
+
+    void lap(std::atomic<uint64_t>& bucket) {
+        if (!enabled_) return;
+        const Clock::time_point now = Clock::now();
+        bucket.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - mark_).count(),
+                         std::memory_order_relaxed);
+        mark_ = now;
+    }
+
+private:
+    bool enabled_;
+    Clock::time_point mark_;
+};
+
+void NetworkMonitor::captureLoop(CaptureWorker& worker) {
+    // How stale the drop and ring counters other threads see can get
+    constexpr auto CAPTURE_COUNTERS_INTERVAL = std::chrono::milliseconds(100);
+
+    const CaptureSource::BatchHandler handler =
+        [this, &worker](const CaptureFrame* frames, size_t count) {
+            processBatch(worker, frames, count);
+        };
+    // Datagrams the reassembler gives up on while no fragments arrive
+    const FragmentReassembler::Handler dropped =
+        [this, &worker](const PacketView& datagram, uint32_t weight) {
+            StageClock clock(m_profileStages);
+            countPacket(worker, datagram, weight, clock);
+        };
 
     while (m_running.load()) {
-        const int result = pcap_next_ex(m_handle, &header, &data);
+        // Pick up filter changes between batches, on the thread that owns
+        // the capture handle
+        if (worker.filterGeneration != m_filterGeneration.load()) {
+            applyFilter(worker);
+        }
+
+        if (worker.index == 0 && std::chrono::steady_clock::now() >= m_nextLoadCheck) {
+            checkLoad();
+        }
 
-        if (result == 1) {
-            // A complete packet was captured — process it
-            processPacket(header, data);
+        const int result = worker.source->dispatch(handler, 100);
+
+        // Hand readers a fresh copy of this worker's statistics every
+        // statistics_interval, busy or idle
+        const auto now = std::chrono::steady_clock::now();
+        worker.statistics.tick(now);
+        if (now >= worker.nextCaptureCounters) {
+            publishCaptureCounters(worker);
+            worker.nextCaptureCounters = now + CAPTURE_COUNTERS_INTERVAL;
+        }
+
+        if (result > 0) {
+            // A batch of frames was captured and processed
+            continue;
         } else if (result == 0) {
-            // Timeout with no packet — loop around and try again
+            // Timeout with no packet — loop around and try again. Replay
+            // runs on packet time, so only live capture expires here.
+            if (m_readFile.empty()) {
+                const auto now = std::chrono::system_clock::now();
+                if (worker.reassembler) {
+                    worker.reassembler->expire(now, dropped);
+                }
+                if (worker.streams) {
+                    worker.streams->expire(now);
+                }
+                if (worker.dns) {
+                    worker.dns->expire(now, worker.dnsEvents);
+                }
+                worker.statistics.getWorkingCopy().expireConnections(now);
+            }
             continue;
         } else if (result == -1) {
-            // Unrecoverable error from libpcap
-            Logger::getInstance().log(LogLevel::ERROR,
-                "pcap_next_ex error: " + std::string(pcap_geterr(m_handle)));
+            // Unrecoverable error from the capture backend
+            Logger::getInstance().log(LogLevel::ERROR, worker.source->getLastError());
             m_running = false;
             break;
         } else if (result == -2) {
             // EOF (e.g. reading from a pcap file) — stop gracefully
             Logger::getInstance().log(LogLevel::INFO, "Capture EOF reached.");
-            m_running = false;
             break;
         }
     }
+
+    // Incomplete datagrams are still counted, before the analysis thread
+    // is told nothing more is coming
+    if (worker.reassembler) {
+        worker.reassembler->flush(dropped);
+    }
+    // Connections still open are recorded as they stand
+    worker.statistics.getWorkingCopy().flushConnections();
+    worker.statistics.publish();
+    publishCaptureCounters(worker);
+    worker.captureDone.store(true, std::memory_order_release);
+}
+
+void NetworkMonitor::analysisLoop(CaptureWorker& worker) {
+    // Idle polling keeps the capture side free of any wakeup syscall
+    constexpr auto IDLE_WAIT = std::chrono::microseconds(100);
+
+    for (;;) {
+        auto queued = worker.ring->tryPop();
+        if (!queued) {
+            // captureDone is set after the last push, so an empty ring seen
+            // after it means everything has been analysed
+            if (worker.captureDone.load(std::memory_order_acquire) && worker.ring->empty()) {
+                break;
+            }
+            std::this_thread::sleep_for(IDLE_WAIT);
+            continue;
+        }
+        analyzePacket(worker, *queued);
+    }
+
+    finishWorker(worker);
+}
+
+void NetworkMonitor::applyFilter(CaptureWorker& worker) {
+    std::shared_ptr<const PacketFilter> filter;
+    {
+        std::lock_guard<std::mutex> lock(m_filterMutex);
+        filter = m_filter;
+        worker.filterGeneration = m_filterGeneration.load();
+    }
+    if (!filter) {
+        return;
+    }
+
+    if (worker.source->setFilter(*filter)) {
+        worker.userFilter.reset();
+        worker.kernelFilter = !filter->isEmpty();
+    } else {
+        // Backend cannot filter (AF_XDP) or the attach failed — evaluate
+        // the same program in user space before parsing
+        Logger::getInstance().log(LogLevel::DEBUG,
+            "Filtering in user space on " + worker.source->getName() + ": " +
+            worker.source->getLastError());
+        worker.userFilter = filter->isEmpty() ? nullptr : filter;
+        worker.kernelFilter = false;
+    }
+}
+
+void NetworkMonitor::checkLoad() {
+    m_nextLoadCheck = std::chrono::steady_clock::now() + m_loadShedder->getConfig().interval;
+
+    // Ring overflows are drops too, just ones the kernel didn't make
+    const CaptureStats stats = getCaptureStats();
+    const PipelineStats pipeline = getPipelineStats();
+    std::string reason;
+    if (!m_loadShedder->update(stats.packets_received,
+                               stats.packets_dropped + pipeline.analysis_overflows,
+                               pipeline.analysis_queued + pipeline.store_queued, reason)) {
+        return;
+    }
+
+    const uint32_t rate = m_loadShedder->getRate();
+    if (rate == 1) {
+        Logger::getInstance().log(LogLevel::INFO,
+            "Load shedding off (" + reason + "); counts are exact again.");
+    } else {
+        Logger::getInstance().log(LogLevel::WARNING,
+            "Load shedding: sampling 1 in " + std::to_string(rate) + " flows (" +
+            reason + "); statistics are now estimates.");
+    }
+    emit samplingChanged(rate);
+}
+
+void NetworkMonitor::finishWorker(CaptureWorker& worker) {
+    worker.finished = true;
+    if (++m_finishedWorkers != m_workers.size()) {
+        return;
+    }
+
+    // Last worker out reports for the whole run
+    m_finishTime = std::chrono::steady_clock::now();
+    m_running = false;
+    if (m_profileStages) {
+        Logger::getInstance().log(LogLevel::INFO, getCaptureReport());
+    }
+    emit captureFinished();
 }
 
 // ---------------------------------------------------------------------------
 // Packet processing
 // ---------------------------------------------------------------------------
 
-void NetworkMonitor::processPacket(const struct pcap_pkthdr* header,
-                                   const u_char* data)
+void NetworkMonitor::processBatch(CaptureWorker& worker,
+                                  const CaptureFrame* frames, size_t count)
 {
-    if (!header || !data) return;
+    // Frames point into the capture source's buffer, which is only released
+    // back to the kernel once this returns
+    worker.frames.fetch_add(count, std::memory_order_relaxed);
+    const PacketFilter* filter = worker.userFilter.get();
+    for (size_t i = 0; i < count; ++i) {
+        if (filter && !filter->matches(frames[i])) {
+            worker.filtered.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Under load, whole flows are skipped before parsing and the ones
+        // kept are counted with the sampling rate as their weight
+        const uint32_t weight = m_loadShedder->admit(frames[i]);
+        if (weight == 0) {
+            worker.shed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        processPacket(worker, frames[i], weight);
+    }
+}
+
+void NetworkMonitor::processPacket(CaptureWorker& worker, const CaptureFrame& frame,
+                                   uint32_t weight) {
+    if (!frame.data) return;
+
+    StageClock clock(m_profileStages);
+
+    // Parse the frame in place. Backends without kernel truncation (AF_XDP,
+    // replay) deliver whole frames, so apply the profile's snaplen here.
+    PacketView view(frame.data, std::min<size_t>(frame.caplen, m_captureProfile.getSnaplen()),
+                    frame.wire_length, frame.timestamp);
+    view.interface = worker.interface;
+    view.checksum_verified = frame.checksum_verified;
+    view.checksum_partial = frame.checksum_partial;
+    // Sent from this host, so the NIC may not have filled the checksum in yet
+    if (worker.skipLocalChecksums && !frame.checksum_verified &&
+        std::find(m_localAddresses.begin(), m_localAddresses.end(), view.sourceAddress()) !=
+            m_localAddresses.end()) {
+        view.checksum_partial = true;
+    }
+    if (m_eagerDecode) {
+        view.decode(PacketView::Layer::APPLICATION);
+    }
+    clock.lap(worker.timings.parse_ns);
+
+    // Per-worker totals avoid bouncing a shared cache line between threads.
+    // Byte counts use the wire length so truncation doesn't skew throughput.
+    const uint64_t packets = worker.packets.fetch_add(1, std::memory_order_relaxed) + 1;
+    worker.bytes.fetch_add(view.length, std::memory_order_relaxed);
 
-    // Parse raw bytes into a structured Packet object
-    Packet packet = Packet::parse(data, header->caplen, header->ts);
+    if (worker.reassembler && view.isFragmented()) {
+        // Fragments are held until their datagram is whole, so that ports
+        // and connections are seen for all of it. Whatever comes out (this
+        // datagram, or older ones dropped to make room) is counted as it
+        // leaves.
+        worker.reassembler->add(view, weight,
+            [this, &worker, &clock](const PacketView& datagram, uint32_t datagramWeight) {
+                clock.lap(worker.timings.reassembly_ns);
+                countPacket(worker, datagram, datagramWeight, clock);
+            });
+        clock.lap(worker.timings.reassembly_ns);
+    } else {
+        countPacket(worker, view, weight, clock);
+    }
+
+    // Periodically tell listeners to refresh their statistics
+    if (worker.index == 0 && packets % 100 == 0) {
+        emit statsUpdated();
+    }
+}
+
+void NetworkMonitor::countPacket(CaptureWorker& worker, const PacketView& view, uint32_t weight,
+                                 StageClock& clock) {
+    // A connection's reassembled bytes name its application more reliably
+    // than its ports, even when the header that gives it away spans
+    // segments or arrives out of order
+    if (worker.streams) {
+        if (const TcpFlow* flow = worker.streams->add(view)) {
+            view.stream_protocol = flow->application;
+            view.signature = flow->signature;
+            view.server_name = flow->getServerName();
+        }
+        clock.lap(worker.timings.streams_ns);
+    }
+
+    if (worker.dns) {
+        worker.dns->add(view, weight, worker.dnsEvents);
+        clock.lap(worker.timings.dns_ns);
+    }
 
-    // Update running totals (thread-safe via atomics)
-    ++m_totalPackets;
-    m_totalBytes += header->caplen;
+    // Forward to this worker's statistics shard for aggregation
+    worker.statistics.getWorkingCopy().update(view, weight);
+    clock.lap(worker.timings.statistics_ns);
 
-    // Forward to statistics engine for aggregation
-    m_statistics.addPacket(packet);
+    worker.decodedLayers[static_cast<size_t>(view.getDecodedLayer())]
+        .fetch_add(1, std::memory_order_relaxed);
+    if (!m_retainPackets) {
+        return;
+    }
+
+    if (!m_readFile.empty()) {
+        // A file can wait for the analysis thread, so replay never loses
+        // packets to a full ring
+        while (worker.ring->size() >= worker.ring->capacity()) {
+            std::this_thread::yield();
+        }
+    }
 
-    // Persist to the data store for historical queries
-    m_dataStore.store(packet);
+    // The frame goes back to the kernel once the batch is done, so storage
+    // and notification get their own copy of what the capture profile
+    // keeps, in a recycled packet whose buffers are already allocated
+    Packet packet = worker.pool ? worker.pool->acquire() : Packet();
+    packet.assign(view, &m_captureProfile);
+    worker.copiedBytes.fetch_add(packet.raw_data.size(), std::memory_order_relaxed);
+    clock.lap(worker.timings.materialize_ns);
+
+    // Never blocks on a live interface; a full ring is counted and the
+    // packet dropped here instead of in the kernel
+    worker.ring->tryPush(std::move(packet));
+}
+
+void NetworkMonitor::analyzePacket(CaptureWorker& worker, Packet& packet) {
+    StageClock clock(m_profileStages);
 
     // Emit Qt signal — connected slots run on the GUI thread via queued connection
     emit packetCaptured(packet);
+    clock.lap(worker.timings.notify_ns);
 
-    // Periodically emit updated statistics (~every second worth of packets)
-    if (m_totalPackets % 100 == 0) {
-        emit statsUpdated(m_statistics.getSnapshot());
+    // Persist to the data store for historical queries. Live capture hands
+    // off without waiting; replay waits for room so every packet is stored.
+    if (m_readFile.empty()) {
+        m_dataStore.tryStore(std::move(packet));
+    } else {
+        m_dataStore.store(std::move(packet));
     }
+    clock.lap(worker.timings.store_ns);
+}
+
+// ---------------------------------------------------------------------------
+// Capture filter
+// ---------------------------------------------------------------------------
+
+void NetworkMonitor::setFilter(const std::string& expression) {
+    // Compile first so a bad expression leaves the current filter in place
+    auto filter = PacketFilter::compile(expression, m_captureProfile.getSnaplen());
+    const FilterBaseline baseline = takeFilterBaseline();
+    {
+        std::lock_guard<std::mutex> lock(m_filterMutex);
+        m_filter = std::move(filter);
+        m_filterBaseline = baseline;
+        ++m_filterGeneration;
+    }
+
+    Logger::getInstance().log(LogLevel::INFO, expression.empty()
+        ? std::string("Capture filter cleared.")
+        : "Capture filter set: " + expression);
+}
+
+std::string NetworkMonitor::getFilter() const {
+    std::lock_guard<std::mutex> lock(m_filterMutex);
+    return m_filter ? m_filter->getExpression() : std::string();
+}
+
+namespace {
+
+// Frames the interfaces have seen in either direction, from sysfs. Returns 0
+// when unavailable (non-Linux, or replaying a file).
+uint64_t readInterfacePackets(const std::vector<std::string>& interfaces) {
+    uint64_t total = 0;
+    for (const auto& interface : interfaces) {
+        for (const char* counter : {"rx_packets", "tx_packets"}) {
+            std::ifstream in("/sys/class/net/" + interface + "/statistics/" + counter);
+            uint64_t value = 0;
+            if (!(in >> value)) {
+                return 0;
+            }
+            total += value;
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+NetworkMonitor::FilterBaseline NetworkMonitor::takeFilterBaseline() const {
+    FilterBaseline baseline;
+    baseline.interface_packets = readInterfacePackets(m_interfaces);
+    baseline.valid             = baseline.interface_packets != 0;
+    baseline.captured          = getDeliveredFrames();
+    baseline.dropped           = getCaptureStats().packets_dropped;
+    return baseline;
+}
+
+uint64_t NetworkMonitor::getFilteredPackets() const {
+    uint64_t filtered = 0;
+    bool kernel = false;
+    for (const auto& worker : m_workers) {
+        filtered += worker->filtered.load(std::memory_order_relaxed);
+        kernel = kernel || worker->kernelFilter.load();
+    }
+
+    FilterBaseline baseline;
+    {
+        std::lock_guard<std::mutex> lock(m_filterMutex);
+        baseline = m_filterBaseline;
+    }
+
+    // The kernel keeps no count of frames a socket filter rejects, so
+    // estimate it as traffic seen by the interface but neither delivered
+    // nor dropped since the filter went in
+    if (kernel && baseline.valid) {
+        const uint64_t seen    = readInterfacePackets(m_interfaces) - baseline.interface_packets;
+        const uint64_t handled = (getDeliveredFrames() - baseline.captured) +
+                                 (getCaptureStats().packets_dropped - baseline.dropped);
+        if (seen > handled) {
+            filtered += seen - handled;
+        }
+    }
+    return filtered;
+}
+
+// ---------------------------------------------------------------------------
+// Load shedding
+// ---------------------------------------------------------------------------
+
+uint32_t NetworkMonitor::getSamplingRate() const {
+    return m_loadShedder ? m_loadShedder->getRate() : 1;
+}
+
+uint64_t NetworkMonitor::getShedPackets() const {
+    uint64_t shed = 0;
+    for (const auto& worker : m_workers) {
+        shed += worker->shed.load(std::memory_order_relaxed);
+    }
+    return shed;
 }
 
 // ---------------------------------------------------------------------------
@@ -186,18 +961,318 @@ bool NetworkMonitor::isRunning() const {
     return m_running.load();
 }
 
+uint64_t NetworkMonitor::getDeliveredFrames() const {
+    uint64_t frames = 0;
+    for (const auto& worker : m_workers) {
+        frames += worker->frames.load(std::memory_order_relaxed);
+    }
+    return frames;
+}
+
 uint64_t NetworkMonitor::getTotalPackets() const {
-    return m_totalPackets.load();
+    uint64_t total = 0;
+    for (const auto& worker : m_workers) {
+        total += worker->packets.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
 uint64_t NetworkMonitor::getTotalBytes() const {
-    return m_totalBytes.load();
+    uint64_t total = 0;
+    for (const auto& worker : m_workers) {
+        total += worker->bytes.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
 std::string NetworkMonitor::getInterface() const {
-    return m_interface;
+    std::string joined;
+    for (const auto& interface : m_interfaces) {
+        joined += (joined.empty() ? "" : ",") + interface;
+    }
+    return joined;
+}
+
+std::string NetworkMonitor::getCaptureBackend() const {
+    return m_workers.empty() ? std::string() : m_workers.front()->source->getName();
+}
+
+void NetworkMonitor::publishCaptureCounters(CaptureWorker& worker) {
+    const CaptureStats stats = worker.source->getStats();
+    CaptureCounters& counters = worker.captureCounters;
+    counters.received.store(stats.packets_received, std::memory_order_relaxed);
+    counters.dropped.store(stats.packets_dropped, std::memory_order_relaxed);
+    counters.batches.store(stats.batches, std::memory_order_relaxed);
+    counters.queueId.store(stats.queue_id, std::memory_order_relaxed);
+    counters.ringSize.store(stats.ring_size, std::memory_order_relaxed);
+    counters.fillRingUsed.store(stats.fill_ring_used, std::memory_order_relaxed);
+    counters.completionRingUsed.store(stats.completion_ring_used, std::memory_order_relaxed);
+}
+
+CaptureStats NetworkMonitor::readCaptureCounters(const CaptureWorker& worker) {
+    const CaptureCounters& counters = worker.captureCounters;
+    CaptureStats stats;
+    stats.interface            = worker.interface;
+    stats.packets_received     = counters.received.load(std::memory_order_relaxed);
+    stats.packets_dropped      = counters.dropped.load(std::memory_order_relaxed);
+    stats.batches              = counters.batches.load(std::memory_order_relaxed);
+    stats.queue_id             = counters.queueId.load(std::memory_order_relaxed);
+    stats.ring_size            = counters.ringSize.load(std::memory_order_relaxed);
+    stats.fill_ring_used       = counters.fillRingUsed.load(std::memory_order_relaxed);
+    stats.completion_ring_used = counters.completionRingUsed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Both read what the capture threads last published, never the sources
+// themselves, so any thread may call them
+CaptureStats NetworkMonitor::getCaptureStats() const {
+    CaptureStats total;
+    for (const auto& worker : m_workers) {
+        const CaptureStats stats = readCaptureCounters(*worker);
+        total.packets_received += stats.packets_received;
+        total.packets_dropped  += stats.packets_dropped;
+        total.batches          += stats.batches;
+    }
+    return total;
+}
+
+std::vector<CaptureStats> NetworkMonitor::getCaptureQueueStats() const {
+    std::vector<CaptureStats> result;
+    result.reserve(m_workers.size());
+    for (const auto& worker : m_workers) {
+        result.push_back(readCaptureCounters(*worker));
+    }
+    return result;
+}
+
+bool NetworkMonitor::isReplay() const {
+    return !m_readFile.empty();
+}
+
+std::string NetworkMonitor::getCaptureReport() const {
+    const auto end = m_finishedWorkers.load() == m_workers.size() && !m_workers.empty()
+        ? m_finishTime : std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - m_startTime).count();
+
+    uint64_t packets = 0, bytes = 0, copied = 0;
+    uint64_t parse = 0, reassembly = 0, streams = 0, dns = 0, statistics = 0, materialize = 0, store = 0, notify = 0;
+    std::array<uint64_t, 5> decoded{};
+    for (const auto& worker : m_workers) {
+        for (size_t layer = 0; layer < decoded.size(); ++layer) {
+            decoded[layer] += worker->decodedLayers[layer].load();
+        }
+        packets    += worker->packets.load();
+        bytes      += worker->bytes.load();
+        copied     += worker->copiedBytes.load();
+        parse      += worker->timings.parse_ns.load();
+        reassembly += worker->timings.reassembly_ns.load();
+        streams    += worker->timings.streams_ns.load();
+        dns        += worker->timings.dns_ns.load();
+        statistics += worker->timings.statistics_ns.load();
+        materialize += worker->timings.materialize_ns.load();
+        store      += worker->timings.store_ns.load();
+        notify     += worker->timings.notify_ns.load();
+    }
+
+    auto perPacket = [packets](uint64_t ns) {
+        return packets ? static_cast<double>(ns) / packets : 0.0;
+    };
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3)
+        << "Processed " << packets << " packets (" << bytes << " bytes) in "
+        << seconds << " s: "
+        << std::setprecision(0)
+        << (seconds > 0 ? packets / seconds : 0.0) << " pps, "
+        << std::setprecision(2)
+        << (seconds > 0 ? bytes * 8.0 / seconds / 1e6 : 0.0) << " Mbps"
+        << "\nCapture profile " << m_captureProfile.getName() << ": copied "
+        << std::setprecision(1)
+        << (packets ? static_cast<double>(copied) / packets : 0.0) << " bytes/packet ("
+        << (bytes ? copied * 100.0 / bytes : 0.0) << "% of wire bytes)";
+
+    if (m_loadShedder && m_loadShedder->getTransitions() > 0) {
+        oss << "\nLoad shedding: " << getShedPackets() << " packets skipped, "
+            << m_loadShedder->getTransitions() << " rate changes, ending at 1 in "
+            << m_loadShedder->getRate() << " flows";
+    }
+
+    // Share of packets statistics decoded at least as deep as each layer.
+    // Reassembled datagrams count once, not once per fragment.
+    uint64_t counted = 0;
+    for (const uint64_t count : decoded) {
+        counted += count;
+    }
+    auto decodedTo = [&](PacketView::Layer layer) {
+        uint64_t count = 0;
+        for (size_t i = static_cast<size_t>(layer); i < decoded.size(); ++i) {
+            count += decoded[i];
+        }
+        return counted ? count * 100.0 / counted : 0.0;
+    };
+    oss << "\nDecode " << (m_eagerDecode ? "eager" : "lazy") << ": "
+        << decodedTo(PacketView::Layer::NETWORK) << "% of packets to network, "
+        << decodedTo(PacketView::Layer::TRANSPORT) << "% to transport, "
+        << decodedTo(PacketView::Layer::APPLICATION) << "% to application"
+        << (m_retainPackets ? " before materialize" : "");
+
+    const FragmentReassembler::Stats fragments = getReassemblyStats();
+    if (fragments.fragments > 0) {
+        oss << "\nReassembly: " << fragments.reassembled << " datagrams from "
+            << fragments.fragments << " fragments; " << fragments.timed_out << " timed out, "
+            << fragments.evicted << " evicted, " << fragments.invalid << " invalid, "
+            << fragments.passed << " fragments passed alone";
+    }
+
+    const StreamReassembler::Stats tcp = getStreamStats();
+    if (tcp.flows > 0) {
+        oss << "\nStreams: " << tcp.flows << " TCP connections followed, "
+            << tcp.delivered << " bytes to analyzers, " << tcp.out_of_order
+            << " segments held out of order, " << tcp.truncated << " streams cut short; "
+            << tcp.closed << " closed, " << tcp.timed_out << " timed out, "
+            << tcp.evicted << " evicted";
+    }
+
+    const DnsTracker::Stats lookups = getDnsStats();
+    if (lookups.queries > 0) {
+        oss << "\nDNS: " << lookups.queries << " queries timed, " << lookups.answered
+            << " answered, " << lookups.timed_out << " unanswered, " << lookups.retried
+            << " retried; " << lookups.unmatched << " unmatched responses, "
+            << lookups.malformed << " malformed, " << lookups.evicted << " evicted";
+    }
+
+    const PipelineStats pipeline = getPipelineStats();
+    if (const uint64_t acquired = pipeline.pool_hits + pipeline.pool_misses) {
+        oss << "\nPacket pool: " << pipeline.pool_hits * 100.0 / acquired << "% reused ("
+            << pipeline.pool_misses << " allocated)";
+    }
+    if (pipeline.analysis_overflows > 0 || pipeline.store_overflows > 0) {
+        oss << "\nRing overflows: " << pipeline.analysis_overflows << " before analysis, "
+            << pipeline.store_overflows << " before storage";
+    }
+
+    if (m_profileStages) {
+        oss << std::setprecision(1)
+            << "\nPer-packet stage time: parse " << perPacket(parse) << " ns"
+            << ", reassembly " << perPacket(reassembly) << " ns"
+            << ", streams " << perPacket(streams) << " ns"
+            << ", dns " << perPacket(dns) << " ns"
+            << ", statistics " << perPacket(statistics) << " ns"
+            << ", materialize " << perPacket(materialize) << " ns"
+            << ", store " << perPacket(store) << " ns"
+            << ", notify " << perPacket(notify) << " ns";
+    }
+    return oss.str();
+}
+
+NetworkMonitor::PipelineStats NetworkMonitor::getPipelineStats() const {
+    PipelineStats stats;
+    for (const auto& worker : m_workers) {
+        stats.analysis_queued    += worker->ring->size();
+        stats.analysis_capacity  += worker->ring->capacity();
+        stats.analysis_overflows += worker->ring->getOverflows();
+        if (worker->pool) {
+            stats.pool_hits   += worker->pool->getHits();
+            stats.pool_misses += worker->pool->getMisses();
+        }
+    }
+    stats.store_queued    = m_dataStore.getBacklog();
+    stats.store_capacity  = m_dataStore.getCapacity();
+    stats.store_overflows = m_dataStore.getOverflows();
+    return stats;
+}
+
+bool NetworkMonitor::isReassembling() const {
+    return !m_workers.empty() && m_workers.front()->reassembler != nullptr;
+}
+
+FragmentReassembler::Stats NetworkMonitor::getReassemblyStats() const {
+    FragmentReassembler::Stats total;
+    for (const auto& worker : m_workers) {
+        if (!worker->reassembler) {
+            continue;
+        }
+        const FragmentReassembler::Stats stats = worker->reassembler->getStats();
+        total.fragments       += stats.fragments;
+        total.reassembled     += stats.reassembled;
+        total.timed_out       += stats.timed_out;
+        total.evicted         += stats.evicted;
+        total.invalid         += stats.invalid;
+        total.passed          += stats.passed;
+        total.pending         += stats.pending;
+        total.memory_used     += stats.memory_used;
+        total.memory_capacity += stats.memory_capacity;
+    }
+    return total;
+}
+
+bool NetworkMonitor::isFollowingStreams() const {
+    return !m_workers.empty() && m_workers.front()->streams != nullptr;
 }
 
-Statistics NetworkMonitor::getStatistics() const {
-    return m_statistics;
+StreamReassembler::Stats NetworkMonitor::getStreamStats() const {
+    StreamReassembler::Stats total;
+    for (const auto& worker : m_workers) {
+        if (!worker->streams) {
+            continue;
+        }
+        const StreamReassembler::Stats stats = worker->streams->getStats();
+        total.flows           += stats.flows;
+        total.closed          += stats.closed;
+        total.timed_out       += stats.timed_out;
+        total.evicted         += stats.evicted;
+        total.delivered       += stats.delivered;
+        total.out_of_order    += stats.out_of_order;
+        total.truncated       += stats.truncated;
+        total.active          += stats.active;
+        total.memory_used     += stats.memory_used;
+        total.memory_capacity += stats.memory_capacity;
+    }
+    return total;
+}
+
+bool NetworkMonitor::isTrackingDns() const {
+    return !m_workers.empty() && m_workers.front()->dns != nullptr;
+}
+
+DnsTracker::Stats NetworkMonitor::getDnsStats() const {
+    DnsTracker::Stats total;
+    for (const auto& worker : m_workers) {
+        if (!worker->dns) {
+            continue;
+        }
+        const DnsTracker::Stats stats = worker->dns->getStats();
+        total.queries   += stats.queries;
+        total.retried   += stats.retried;
+        total.answered  += stats.answered;
+        total.timed_out += stats.timed_out;
+        total.evicted   += stats.evicted;
+        total.unmatched += stats.unmatched;
+        total.malformed += stats.malformed;
+        total.pending   += stats.pending;
+    }
+    return total;
+}
+
+std::shared_ptr<const Statistics> NetworkMonitor::getStatistics() const {
+    // Generations only grow, so their sum only changes when some worker
+    // has published since the last merge
+    uint64_t generation = 0;
+    for (const auto& worker : m_workers) {
+        generation += worker->statistics.getGeneration();
+    }
+
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    if (m_statistics && generation == m_statisticsGeneration) {
+        return m_statistics;
+    }
+
+    // Merge the per-worker snapshots into a single view for the GUI and CLI
+    auto merged = std::make_shared<Statistics>();
+    for (const auto& worker : m_workers) {
+        merged->merge(*worker->statistics.getSnapshot());
+    }
+    m_statistics = merged;
+    m_statisticsGeneration = generation;
+    return merged;
 }
\ No newline at end of file
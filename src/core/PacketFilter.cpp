@@ -0,0 +1,43 @@
+#include "core/PacketFilter.hpp"
+#include <mutex>
+#include <stdexcept>
+
+std::shared_ptr<const PacketFilter> PacketFilter::compile(const std::string& expression,
+                                                          uint32_t snaplen) {
+    // pcap_compile is not thread-safe before libpcap 1.8
+    static std::mutex compile_mutex;
+    std::lock_guard<std::mutex> lock(compile_mutex);
+
+    // Every backend delivers Ethernet frames, so compile against a dead
+    // Ethernet handle rather than a live one
+    pcap_t* dead = pcap_open_dead(DLT_EN10MB, static_cast<int>(snaplen));
+    if (dead == nullptr) {
+        throw std::runtime_error("Failed to create pcap handle for filter compilation");
+    }
+
+    std::shared_ptr<PacketFilter> filter(new PacketFilter());
+    filter->expression_ = expression;
+    filter->snaplen_    = snaplen;
+
+    if (pcap_compile(dead, &filter->program_, expression.c_str(), 1,
+                     PCAP_NETMASK_UNKNOWN) != 0) {
+        const std::string error = pcap_geterr(dead);
+        pcap_close(dead);
+        throw std::runtime_error("Invalid filter '" + expression + "': " + error);
+    }
+
+    pcap_close(dead);
+    return filter;
+}
+
+PacketFilter::~PacketFilter() {
+    pcap_freecode(&program_);
+}
+
+bool PacketFilter::matches(const CaptureFrame& frame) const {
+    struct pcap_pkthdr header{};
+    header.ts     = frame.timestamp;
+    header.caplen = frame.caplen;
+    header.len    = frame.wire_length;
+    return pcap_offline_filter(&program_, &header, frame.data) != 0;
+}
@@ -0,0 +1,85 @@
+#include "core/PcapCaptureSource.hpp"
+#include "core/PacketFilter.hpp"
+
+PcapCaptureSource::PcapCaptureSource(int snaplen, bool promiscuous, int timeout_ms)
+    : handle_(nullptr)
+    , snaplen_(snaplen)
+    , promiscuous_(promiscuous)
+    , timeout_ms_(timeout_ms)
+    , batches_(0) {
+}
+
+PcapCaptureSource::~PcapCaptureSource() {
+    close();
+}
+
+bool PcapCaptureSource::open(const std::string& interface) {
+    char errBuf[PCAP_ERRBUF_SIZE];
+
+    handle_ = pcap_open_live(
+        interface.c_str(),
+        snaplen_,
+        promiscuous_ ? 1 : 0,
+        timeout_ms_,
+        errBuf
+    );
+
+    if (handle_ == nullptr) {
+        last_error_ = "pcap_open_live failed: " + std::string(errBuf);
+        return false;
+    }
+    return true;
+}
+
+void PcapCaptureSource::close() {
+    if (handle_) {
+        pcap_close(handle_);
+        handle_ = nullptr;
+    }
+}
+
+int PcapCaptureSource::dispatch(const BatchHandler& handler, int /*timeout_ms*/) {
+    struct pcap_pkthdr* header = nullptr;
+    const u_char*       data   = nullptr;
+
+    // The read timeout is fixed when the handle is opened
+    const int result = pcap_next_ex(handle_, &header, &data);
+
+    if (result == 1) {
+        CaptureFrame frame;
+        frame.data        = data;
+        frame.caplen      = header->caplen;
+        frame.wire_length = header->len;
+        frame.timestamp   = header->ts;
+
+        ++batches_;
+        handler(&frame, 1);
+        return 1;
+    }
+
+    if (result == -1) {
+        last_error_ = "pcap_next_ex error: " + std::string(pcap_geterr(handle_));
+    }
+    return result;
+}
+
+bool PcapCaptureSource::setFilter(const PacketFilter& filter) {
+    // pcap_setfilter copies the program, so the filter need not outlive us
+    if (pcap_setfilter(handle_, const_cast<struct bpf_program*>(filter.getProgram())) != 0) {
+        last_error_ = "pcap_setfilter failed: " + std::string(pcap_geterr(handle_));
+        return false;
+    }
+    return true;
+}
+
+CaptureStats PcapCaptureSource::getStats() const {
+    CaptureStats stats;
+    stats.batches = batches_.load();
+
+    struct pcap_stat ps{};
+    if (handle_ && pcap_stats(handle_, &ps) == 0) {
+        stats.packets_received = ps.ps_recv;
+        stats.packets_dropped  = ps.ps_drop + ps.ps_ifdrop;
+    }
+    return stats;
+}
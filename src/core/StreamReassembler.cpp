@@ -0,0 +1,383 @@
+#include "core/StreamReassembler.hpp"
+#include "config/ConfigManager.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MAX_CUTOFF = 1 << 20;
+
+size_t direction(StreamDirection direction) {
+    return static_cast<size_t>(direction);
+}
+
+} // namespace
+
+StreamReassembler::StreamReassembler(const StreamReassemblerConfig& config,
+                                     std::vector<std::unique_ptr<StreamAnalyzer>> analyzers)
+    : config_(config)
+    , analyzers_(std::move(analyzers))
+    , slots_(config.flows)
+{
+    if (analyzers_.size() > MAX_ANALYZERS) {
+        throw std::invalid_argument("StreamReassembler takes at most 16 analyzers");
+    }
+    all_analyzers_ = static_cast<uint16_t>((1u << analyzers_.size()) - 1);
+
+    config_.flows = slots_.capacity();
+    config_.cutoff = std::clamp<size_t>(config_.cutoff, 1, MAX_CUTOFF);
+
+    // No buffers at all still leaves each direction's first segment
+    const size_t buffers = std::min<size_t>(config_.memory / config_.cutoff, NONE - 1);
+    arena_.resize(buffers * config_.cutoff);
+    free_buffers_.reserve(buffers);
+    for (size_t i = buffers; i > 0; --i) {
+        free_buffers_.push_back(static_cast<uint32_t>(i - 1));
+    }
+}
+
+StreamReassemblerConfig StreamReassembler::configFromSettings() {
+    auto& config = ConfigManager::getInstance();
+    StreamReassemblerConfig streams;
+    streams.flows   = static_cast<size_t>(std::max(1,
+        config.getInt("analysis", "stream_flows").value_or(static_cast<int>(streams.flows))));
+    streams.cutoff  = static_cast<size_t>(std::max(1,
+        config.getInt("analysis", "stream_cutoff").value_or(static_cast<int>(streams.cutoff))));
+    streams.memory  = static_cast<size_t>(std::max(0,
+        config.getInt("analysis", "stream_memory").value_or(static_cast<int>(streams.memory))));
+    streams.timeout = std::chrono::seconds(std::max(1,
+        config.getInt("analysis", "stream_timeout")
+            .value_or(static_cast<int>(streams.timeout.count()))));
+    return streams;
+}
+
+// ---------------------------------------------------------------------------
+// Segments in
+// ---------------------------------------------------------------------------
+
+const TcpFlow* StreamReassembler::add(const PacketView& packet) {
+    if (!packet.isTCP()) {
+        return nullptr;
+    }
+    expire(packet.timestamp);
+
+    const IpAddress source = packet.sourceAddress();
+    const IpAddress destination = packet.destinationAddress();
+    const uint16_t source_port = packet.getSourcePort();
+    const uint16_t destination_port = packet.getDestinationPort();
+    const uint8_t flags = packet.getTcpFlags();
+    uint32_t sequence = packet.getSequenceNumber();
+
+    const size_t bucket = bucketOf(source, source_port, destination, destination_port);
+    uint32_t index = find(source, source_port, destination, destination_port, bucket);
+
+    // A fresh SYN on a tracked connection means its ports were reused
+    const bool opening = (flags & (PacketView::TCP_SYN | PacketView::TCP_ACK)) == PacketView::TCP_SYN;
+    if (index != NONE && opening) {
+        const Slot& slot = slots_[index];
+        const Stream& client = slot.streams[direction(StreamDirection::CLIENT)];
+        if (slot.flow.midstream || slot.flow.client != source || slot.flow.client_port != source_port ||
+            client.base != sequence + 1) {
+            release(index, closed_);
+            index = NONE;
+        }
+    }
+
+    if (index == NONE) {
+        // Nothing to follow in a stray ACK or a RST, e.g. the last ACK of
+        // a connection already closed
+        if ((flags & PacketView::TCP_RST) ||
+            (!(flags & PacketView::TCP_SYN) && packet.getPayloadLength() == 0)) {
+            return nullptr;
+        }
+        index = allocate(packet, flags, bucket);
+    } else {
+        slots_.touch(index);
+    }
+
+    Slot& slot = slots_[index];
+    slot.flow.last_seen = packet.timestamp;
+    const StreamDirection side = slot.flow.client == source && slot.flow.client_port == source_port
+        ? StreamDirection::CLIENT : StreamDirection::SERVER;
+    Stream& stream = slot.streams[direction(side)];
+
+    if (flags & PacketView::TCP_SYN) {
+        // The SYN takes a sequence number; data starts after it
+        ++sequence;
+        if (!stream.have_base) {
+            stream.base = sequence;
+            stream.have_base = true;
+        }
+    }
+    if (stream.pending != 0 && packet.getPayloadLength() > 0) {
+        receive(index, side, packet, sequence);
+    }
+
+    if (flags & PacketView::TCP_FIN) {
+        stream.fin = true;
+    }
+    // The record stays readable until the slot is reused
+    if ((flags & PacketView::TCP_RST) || (slot.streams[0].fin && slot.streams[1].fin)) {
+        release(index, closed_);
+    }
+    return &slot.flow;
+}
+
+void StreamReassembler::expire(std::chrono::system_clock::time_point now) {
+    while (slots_.oldest() != NONE && now - slots_[slots_.oldest()].flow.last_seen > config_.timeout) {
+        release(slots_.oldest(), timed_out_);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Table
+// ---------------------------------------------------------------------------
+
+// The same for both directions of a connection
+size_t StreamReassembler::bucketOf(const IpAddress& a, uint16_t a_port,
+                                   const IpAddress& b, uint16_t b_port) const {
+    auto endpoint = [](const IpAddress& address, uint16_t port) {
+        const uint64_t h = (address.hash() ^ (static_cast<uint64_t>(port) << 48)) * 0x9e3779b97f4a7c15ull;
+        return h ^ (h >> 29);
+    };
+    uint64_t h = (endpoint(a, a_port) + endpoint(b, b_port)) * 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return slots_.bucketOf(h);
+}
+
+uint32_t StreamReassembler::find(const IpAddress& source, uint16_t source_port,
+                                 const IpAddress& destination, uint16_t destination_port,
+                                 size_t bucket) const {
+    return slots_.find(bucket, [&](const Slot& slot) {
+        const TcpFlow& flow = slot.flow;
+        return (flow.client_port == source_port && flow.server_port == destination_port &&
+                flow.client == source && flow.server == destination) ||
+               (flow.client_port == destination_port && flow.server_port == source_port &&
+                flow.client == destination && flow.server == source);
+    });
+}
+
+uint32_t StreamReassembler::allocate(const PacketView& packet, uint8_t flags, size_t bucket) {
+    const uint32_t index = slots_.allocate(bucket, [this](uint32_t oldest) {
+        release(oldest, evicted_);
+    });
+    Slot& slot = slots_[index];
+
+    // A bare SYN comes from the client and a SYN-ACK from the server.
+    // Without them, guess the client is on the higher, ephemeral port.
+    const bool syn = flags & PacketView::TCP_SYN;
+    const bool from_client = syn ? !(flags & PacketView::TCP_ACK)
+                                 : packet.getSourcePort() > packet.getDestinationPort();
+    TcpFlow& flow = slot.flow;
+    flow = TcpFlow();
+    flow.client      = from_client ? packet.sourceAddress() : packet.destinationAddress();
+    flow.server      = from_client ? packet.destinationAddress() : packet.sourceAddress();
+    flow.client_port = from_client ? packet.getSourcePort() : packet.getDestinationPort();
+    flow.server_port = from_client ? packet.getDestinationPort() : packet.getSourcePort();
+    flow.midstream   = !syn;
+    flow.first_seen  = packet.timestamp;
+    flow.last_seen   = packet.timestamp;
+    for (Stream& stream : slot.streams) {
+        stream = Stream();
+        stream.pending = all_analyzers_;
+    }
+
+    flows_.store(flows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    active_.store(active_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return index;
+}
+
+void StreamReassembler::release(uint32_t index, std::atomic<uint64_t>& counter) {
+    Slot& slot = slots_[index];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slots_.release(index);
+
+    for (Stream& stream : slot.streams) {
+        finish(stream, false);
+    }
+    active_.store(active_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+// ---------------------------------------------------------------------------
+// Stream data
+// ---------------------------------------------------------------------------
+
+void StreamReassembler::receive(uint32_t index, StreamDirection side, const PacketView& packet,
+                                uint32_t sequence) {
+    Stream& stream = slots_[index].streams[direction(side)];
+    const uint32_t cutoff = static_cast<uint32_t>(config_.cutoff);
+    if (!stream.have_base) {
+        stream.base = sequence;
+        stream.have_base = true;
+    }
+
+    // Offsets wrap for data from before the stream start, which is skipped
+    // along with anything past the cutoff
+    const uint32_t offset = sequence - stream.base;
+    if (offset >= cutoff) {
+        return;
+    }
+    const size_t payload_offset = packet.getPayloadOffset();
+    const size_t length = std::min<size_t>(packet.getPayloadLength(), cutoff - offset);
+    const size_t captured = packet.captured_length > payload_offset
+        ? std::min(length, packet.captured_length - payload_offset) : 0;
+    const uint8_t* data = packet.data + payload_offset;
+    const uint32_t end = offset + static_cast<uint32_t>(captured);
+    // The capture cut the segment short, so nothing after it can follow in
+    // order: hand on what is there and stop
+    const bool cut = captured < length;
+
+    if (end > stream.delivered) {
+        if (offset == 0 && stream.buffer == NONE) {
+            // The usual case: a direction's first segment, handed on
+            // straight from the frame. Only copied if analyzers want more.
+            stream.delivered = end;
+            deliver(slots_[index], side, data, end);
+            if (stream.pending != 0 && !cut && end < cutoff) {
+                if (!takeBuffer(index, stream)) {
+                    finish(stream, true);
+                    return;
+                }
+                std::memcpy(arena_.data() + static_cast<size_t>(stream.buffer) * cutoff, data, end);
+            }
+        } else {
+            if (stream.buffer == NONE && !takeBuffer(index, stream)) {
+                finish(stream, true);
+                return;
+            }
+            uint8_t* buffer = arena_.data() + static_cast<size_t>(stream.buffer) * cutoff;
+            const uint32_t begin = std::max(offset, stream.delivered);
+            std::memcpy(buffer + begin, data + (begin - offset), end - begin);
+
+            if (begin == stream.delivered) {
+                // Fills the gap at the front: hand on everything now in
+                // order, including held runs it reaches
+                uint32_t reached = end;
+                size_t joined = 0;
+                while (joined < stream.range_count && stream.ranges[joined].begin <= reached) {
+                    reached = std::max(reached, stream.ranges[joined].end);
+                    ++joined;
+                }
+                std::copy(stream.ranges + joined, stream.ranges + stream.range_count, stream.ranges);
+                stream.range_count -= joined;
+                const size_t fresh = reached - stream.delivered;
+                stream.delivered = reached;
+                deliver(slots_[index], side, buffer, fresh);
+            } else if (insertRange(stream, begin, end)) {
+                out_of_order_.store(out_of_order_.load(std::memory_order_relaxed) + 1,
+                                    std::memory_order_relaxed);
+            } else {
+                finish(stream, true);
+                return;
+            }
+        }
+    }
+
+    if (stream.pending == 0 || stream.delivered >= cutoff) {
+        finish(stream, false);
+    } else if (cut) {
+        finish(stream, true);
+    }
+}
+
+// data holds the direction from offset 0 to stream.delivered
+void StreamReassembler::deliver(Slot& slot, StreamDirection side, const uint8_t* data, size_t fresh) {
+    Stream& stream = slot.streams[direction(side)];
+    const std::span<const uint8_t> bytes(data, stream.delivered);
+    for (uint16_t pending = stream.pending; pending != 0; pending &= pending - 1) {
+        const int i = std::countr_zero(pending);
+        if (analyzers_[i]->onData(slot.flow, side, bytes, fresh) == StreamAnalyzer::Verdict::DONE) {
+            stream.pending &= static_cast<uint16_t>(~(1u << i));
+        }
+    }
+    delivered_.store(delivered_.load(std::memory_order_relaxed) + fresh, std::memory_order_relaxed);
+}
+
+bool StreamReassembler::takeBuffer(uint32_t index, Stream& stream) {
+    // Out of memory: the least recently active streams holding a buffer
+    // give it up, as they are the least likely to complete
+    uint32_t victim = slots_.oldest();
+    for (size_t scanned = 0; free_buffers_.empty() && victim != NONE && scanned < STEAL_SCAN;
+         ++scanned, victim = slots_.newer(victim)) {
+        if (victim == index) {
+            continue;
+        }
+        for (Stream& other : slots_[victim].streams) {
+            if (other.buffer != NONE) {
+                finish(other, true);
+                break;
+            }
+        }
+    }
+    if (free_buffers_.empty()) {
+        return false;
+    }
+
+    stream.buffer = free_buffers_.back();
+    free_buffers_.pop_back();
+    buffers_used_.store(buffers_used_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+// Stops reassembling a direction; truncated when analyzers still wanted it
+void StreamReassembler::finish(Stream& stream, bool truncated) {
+    if (truncated && stream.pending != 0) {
+        truncated_.store(truncated_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    stream.pending = 0;
+    stream.range_count = 0;
+    if (stream.buffer != NONE) {
+        free_buffers_.push_back(stream.buffer);
+        stream.buffer = NONE;
+        buffers_used_.store(buffers_used_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+}
+
+// Adds a run past the delivered data, merging it with any it overlaps or
+// touches. False when that would need more than MAX_RANGES runs.
+bool StreamReassembler::insertRange(Stream& stream, uint32_t begin, uint32_t end) const {
+    Range* ranges = stream.ranges;
+    size_t& count = stream.range_count;
+
+    size_t first = 0;
+    while (first < count && ranges[first].end < begin) {
+        ++first;
+    }
+    size_t last = first;
+    while (last < count && ranges[last].begin <= end) {
+        begin = std::min(begin, ranges[last].begin);
+        end = std::max(end, ranges[last].end);
+        ++last;
+    }
+
+    if (first == last) {
+        if (count == MAX_RANGES) {
+            return false;
+        }
+        std::copy_backward(ranges + first, ranges + count, ranges + count + 1);
+        ++count;
+    } else {
+        std::copy(ranges + last, ranges + count, ranges + first + 1);
+        count -= last - first - 1;
+    }
+    ranges[first] = {begin, end};
+    return true;
+}
+
+StreamReassembler::Stats StreamReassembler::getStats() const {
+    Stats stats;
+    stats.flows           = flows_.load(std::memory_order_relaxed);
+    stats.closed          = closed_.load(std::memory_order_relaxed);
+    stats.timed_out       = timed_out_.load(std::memory_order_relaxed);
+    stats.evicted         = evicted_.load(std::memory_order_relaxed);
+    stats.delivered       = delivered_.load(std::memory_order_relaxed);
+    stats.out_of_order    = out_of_order_.load(std::memory_order_relaxed);
+    stats.truncated       = truncated_.load(std::memory_order_relaxed);
+    stats.active          = active_.load(std::memory_order_relaxed);
+    stats.memory_used     = buffers_used_.load(std::memory_order_relaxed) * config_.cutoff;
+    stats.memory_capacity = arena_.size();
+    return stats;
+}
@@ -0,0 +1,270 @@
+#include "core/TPacketCaptureSource.hpp"
+#include "core/PacketFilter.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Status bits from newer kernel headers
+#ifndef TP_STATUS_CSUMNOTREADY
+#define TP_STATUS_CSUMNOTREADY (1 << 3)
+#endif
+#ifndef TP_STATUS_CSUM_VALID
+#define TP_STATUS_CSUM_VALID (1 << 7)
+#endif
+#endif
+
+TPacketCaptureSource::TPacketCaptureSource(const TPacketRingConfig& config)
+    : config_(config)
+    , fd_(-1)
+    , ring_(nullptr)
+    , ring_size_(0)
+    , current_block_(0) {
+}
+
+TPacketCaptureSource::~TPacketCaptureSource() {
+    close();
+}
+
+void TPacketCaptureSource::fail(const std::string& what) {
+    last_error_ = what + ": " + std::strerror(errno);
+    close();
+}
+
+#ifdef __linux__
+
+bool TPacketCaptureSource::open(const std::string& interface) {
+    fd_ = ::socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd_ < 0) {
+        fail("socket(AF_PACKET)");
+        return false;
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        fail("PACKET_VERSION TPACKET_V3");
+        return false;
+    }
+
+    if (!setupRing()) {
+        return false;
+    }
+
+    const unsigned int ifindex = if_nametoindex(interface.c_str());
+    if (ifindex == 0) {
+        fail("if_nametoindex(" + interface + ")");
+        return false;
+    }
+
+    struct sockaddr_ll addr{};
+    addr.sll_family   = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex  = static_cast<int>(ifindex);
+    if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        fail("bind(" + interface + ")");
+        return false;
+    }
+
+    if (config_.promiscuous) {
+        struct packet_mreq mreq{};
+        mreq.mr_ifindex = static_cast<int>(ifindex);
+        mreq.mr_type    = PACKET_MR_PROMISC;
+        if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            fail("PACKET_ADD_MEMBERSHIP");
+            return false;
+        }
+    }
+
+    if (config_.fanout_group != 0) {
+        // PACKET_FANOUT_HASH uses the kernel's symmetric flow hash, so both
+        // directions of a connection are delivered to the same socket
+        const int fanout = config_.fanout_group |
+            ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+        if (setsockopt(fd_, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+            fail("PACKET_FANOUT group " + std::to_string(config_.fanout_group));
+            return false;
+        }
+    }
+
+    frames_.reserve(config_.block_size / TPACKET_ALIGNMENT);
+    return true;
+}
+
+bool TPacketCaptureSource::setupRing() {
+    struct tpacket_req3 req{};
+    req.tp_block_size       = config_.block_size;
+    req.tp_block_nr         = config_.block_count;
+    req.tp_frame_size       = config_.frame_size;
+    req.tp_frame_nr         = (config_.block_size * config_.block_count) / config_.frame_size;
+    req.tp_retire_blk_tov   = config_.block_timeout_ms;
+    req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        fail("PACKET_RX_RING");
+        return false;
+    }
+
+    ring_size_ = static_cast<size_t>(req.tp_block_size) * req.tp_block_nr;
+    void* mapped = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_LOCKED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        // MAP_LOCKED needs RLIMIT_MEMLOCK headroom; retry without it
+        mapped = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    }
+    if (mapped == MAP_FAILED) {
+        ring_size_ = 0;
+        fail("mmap(PACKET_RX_RING)");
+        return false;
+    }
+
+    ring_ = static_cast<uint8_t*>(mapped);
+    current_block_ = 0;
+    return true;
+}
+
+void TPacketCaptureSource::close() {
+    if (ring_) {
+        munmap(ring_, ring_size_);
+        ring_ = nullptr;
+        ring_size_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int TPacketCaptureSource::dispatch(const BatchHandler& handler, int timeout_ms) {
+    auto* block = reinterpret_cast<struct tpacket_block_desc*>(
+        ring_ + static_cast<size_t>(current_block_) * config_.block_size);
+    // The kernel fills a block before it sets the status, so read the status
+    // with acquire to see the frames; pairs with the release store below
+    auto retired = [block] {
+        return (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) != 0;
+    };
+
+    if (!retired()) {
+        // Nothing retired yet — sleep until the kernel hands us a block
+        struct pollfd pfd{};
+        pfd.fd     = fd_;
+        pfd.events = POLLIN | POLLERR;
+
+        const int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0) {
+            if (errno == EINTR) return 0;
+            last_error_ = std::string("poll: ") + std::strerror(errno);
+            return -1;
+        }
+        if (!retired()) {
+            return 0;
+        }
+    }
+
+    const uint32_t count = block->hdr.bh1.num_pkts;
+    frames_.clear();
+
+    auto* hdr = reinterpret_cast<struct tpacket3_hdr*>(
+        reinterpret_cast<uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        CaptureFrame frame;
+        frame.data              = reinterpret_cast<const uint8_t*>(hdr) + hdr->tp_mac;
+        frame.caplen            = hdr->tp_snaplen;
+        frame.wire_length       = hdr->tp_len;
+        frame.timestamp.tv_sec  = hdr->tp_sec;
+        frame.timestamp.tv_usec = hdr->tp_nsec / 1000;
+        frame.checksum_verified = (hdr->tp_status & TP_STATUS_CSUM_VALID) != 0;
+        frame.checksum_partial  = (hdr->tp_status & TP_STATUS_CSUMNOTREADY) != 0;
+        frames_.push_back(frame);
+
+        hdr = reinterpret_cast<struct tpacket3_hdr*>(
+            reinterpret_cast<uint8_t*>(hdr) + hdr->tp_next_offset);
+    }
+
+    if (!frames_.empty()) {
+        handler(frames_.data(), frames_.size());
+    }
+
+    // Return the block to the kernel only after the pipeline is done with it
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    current_block_ = (current_block_ + 1) % config_.block_count;
+    ++batches_;
+
+    return static_cast<int>(count);
+}
+
+bool TPacketCaptureSource::setFilter(const PacketFilter& filter) {
+    // An empty expression still needs attaching when it truncates frames
+    if (filter.isEmpty() && filter.getSnaplen() >= PacketFilter::MAX_SNAPLEN) {
+        // Nothing attached is not an error when clearing
+        if (setsockopt(fd_, SOL_SOCKET, SO_DETACH_FILTER, nullptr, 0) < 0 && errno != ENOENT) {
+            last_error_ = std::string("SO_DETACH_FILTER: ") + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // struct bpf_insn from libpcap and the kernel's struct sock_filter share
+    // a layout. SO_ATTACH_FILTER replaces any previous filter atomically, so
+    // there is no window where the socket runs unfiltered.
+    const struct bpf_program* program = filter.getProgram();
+    struct sock_fprog fprog{};
+    fprog.len    = static_cast<unsigned short>(program->bf_len);
+    fprog.filter = reinterpret_cast<struct sock_filter*>(program->bf_insns);
+    if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+        last_error_ = std::string("SO_ATTACH_FILTER: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+CaptureStats TPacketCaptureSource::getStats() const {
+    if (fd_ >= 0) {
+        struct tpacket_stats_v3 ks{};
+        socklen_t len = sizeof(ks);
+        if (getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &ks, &len) == 0) {
+            packets_received_ += ks.tp_packets;
+            packets_dropped_  += ks.tp_drops;
+        }
+    }
+
+    CaptureStats stats;
+    stats.packets_received = packets_received_.load();
+    stats.packets_dropped  = packets_dropped_.load();
+    stats.batches          = batches_.load();
+    return stats;
+}
+
+#else // !__linux__
+
+bool TPacketCaptureSource::open(const std::string&) {
+    last_error_ = "TPACKET_V3 is only available on Linux";
+    return false;
+}
+
+void TPacketCaptureSource::close() {
+}
+
+int TPacketCaptureSource::dispatch(const BatchHandler&, int) {
+    return -1;
+}
+
+bool TPacketCaptureSource::setFilter(const PacketFilter&) {
+    return false;
+}
+
+CaptureStats TPacketCaptureSource::getStats() const {
+    return CaptureStats{};
+}
+
+#endif
@@ -0,0 +1,495 @@
+#include "core/XdpCaptureSource.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/bpf.h>
+#include <linux/ethtool.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+#ifndef ETH_RSS_HASH_TOP
+#define ETH_RSS_HASH_TOP 1
+#endif
+#endif
+
+#ifdef __linux__
+
+namespace {
+
+long bpfSyscall(int cmd, union bpf_attr* attr) {
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// RSS
+// ---------------------------------------------------------------------------
+
+bool hasSymmetricRss(const std::string& interface, std::string& why) {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        why = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    struct ifreq request{};
+    std::strncpy(request.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+
+    // The first call only reports the sizes of the table and the key
+    struct ethtool_rxfh sizes{};
+    sizes.cmd = ETHTOOL_GRSSH;
+    request.ifr_data = reinterpret_cast<char*>(&sizes);
+    if (ioctl(fd, SIOCETHTOOL, &request) < 0) {
+        why = std::string("ETHTOOL_GRSSH: ") + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(sizeof(ethtool_rxfh) + sizes.indir_size * sizeof(uint32_t) + sizes.key_size);
+    auto* rxfh = reinterpret_cast<ethtool_rxfh*>(buffer.data());
+    rxfh->cmd        = ETHTOOL_GRSSH;
+    rxfh->indir_size = sizes.indir_size;
+    rxfh->key_size   = sizes.key_size;
+    request.ifr_data = reinterpret_cast<char*>(rxfh);
+    const bool read = ioctl(fd, SIOCETHTOOL, &request) == 0;
+    ::close(fd);
+    if (!read) {
+        why = std::string("ETHTOOL_GRSSH: ") + std::strerror(errno);
+        return false;
+    }
+
+    // Drivers that don't report the function leave it 0; Toeplitz is the default
+    if (rxfh->hfunc != 0 && rxfh->hfunc != ETH_RSS_HASH_TOP) {
+        why = "RSS hash is not Toeplitz";
+        return false;
+    }
+    const uint8_t* key = reinterpret_cast<const uint8_t*>(rxfh->rss_config + rxfh->indir_size);
+    if (rxfh->key_size == 0 || rxfh->key_size % 2 != 0) {
+        why = "RSS key is not readable";
+        return false;
+    }
+    for (uint32_t i = 0; i < rxfh->key_size; i += 2) {
+        if (key[i] != 0x6d || key[i + 1] != 0x5a) {
+            why = "RSS key is not symmetric";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// XdpRedirectProgram
+// ---------------------------------------------------------------------------
+
+XdpRedirectProgram::~XdpRedirectProgram() {
+    detach();
+}
+
+bool XdpRedirectProgram::attach(unsigned int ifindex, bool skb_mode) {
+    union bpf_attr attr{};
+    attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(int);
+    attr.max_entries = MAX_QUEUES;
+    map_fd_ = static_cast<int>(bpfSyscall(BPF_MAP_CREATE, &attr));
+    if (map_fd_ < 0) {
+        last_error_ = std::string("BPF_MAP_CREATE(XSKMAP): ") + std::strerror(errno);
+        detach();
+        return false;
+    }
+
+    // return bpf_redirect_map(&xsks, ctx->rx_queue_index, XDP_PASS);
+    const struct bpf_insn insns[] = {
+        { BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1,
+          static_cast<__s16>(offsetof(struct xdp_md, rx_queue_index)), 0 },
+        { BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd_ },
+        { 0, 0, 0, 0, 0 },
+        { BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS },
+        { BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map },
+        { BPF_JMP | BPF_EXIT, 0, 0, 0, 0 },
+    };
+    static const char license[] = "Dual MIT/GPL";
+
+    attr = {};
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns     = reinterpret_cast<uint64_t>(insns);
+    attr.insn_cnt  = sizeof(insns) / sizeof(insns[0]);
+    attr.license   = reinterpret_cast<uint64_t>(license);
+    prog_fd_ = static_cast<int>(bpfSyscall(BPF_PROG_LOAD, &attr));
+    if (prog_fd_ < 0) {
+        last_error_ = std::string("BPF_PROG_LOAD(XDP): ") + std::strerror(errno);
+        detach();
+        return false;
+    }
+
+    attr = {};
+    attr.link_create.prog_fd        = static_cast<uint32_t>(prog_fd_);
+    attr.link_create.target_ifindex = ifindex;
+    attr.link_create.attach_type    = BPF_XDP;
+    attr.link_create.flags          = skb_mode ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE;
+    link_fd_ = static_cast<int>(bpfSyscall(BPF_LINK_CREATE, &attr));
+    if (link_fd_ < 0) {
+        last_error_ = std::string("BPF_LINK_CREATE(XDP): ") + std::strerror(errno);
+        detach();
+        return false;
+    }
+    return true;
+}
+
+bool XdpRedirectProgram::registerSocket(uint32_t queue_id, int xsk_fd) {
+    if (queue_id >= MAX_QUEUES) {
+        last_error_ = "queue id " + std::to_string(queue_id) + " exceeds XSKMAP size";
+        return false;
+    }
+
+    union bpf_attr attr{};
+    attr.map_fd = static_cast<uint32_t>(map_fd_);
+    attr.key    = reinterpret_cast<uint64_t>(&queue_id);
+    attr.value  = reinterpret_cast<uint64_t>(&xsk_fd);
+    attr.flags  = BPF_ANY;
+    if (bpfSyscall(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        last_error_ = std::string("BPF_MAP_UPDATE_ELEM(XSKMAP): ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void XdpRedirectProgram::detach() {
+    // Closing the link fd detaches the program from the interface
+    for (int* fd : {&link_fd_, &prog_fd_, &map_fd_}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// XdpCaptureSource
+// ---------------------------------------------------------------------------
+
+XdpCaptureSource::XdpCaptureSource(const XdpConfig& config)
+    : config_(config)
+    , fd_(-1)
+    , umem_(nullptr)
+    , umem_size_(0) {
+}
+
+XdpCaptureSource::~XdpCaptureSource() {
+    close();
+}
+
+void XdpCaptureSource::fail(const std::string& what) {
+    last_error_ = what + ": " + std::strerror(errno);
+    close();
+}
+
+bool XdpCaptureSource::open(const std::string& interface) {
+    if (!config_.program) {
+        last_error_ = "AF_XDP capture requires a redirect program";
+        return false;
+    }
+
+    const unsigned int ifindex = if_nametoindex(interface.c_str());
+    if (ifindex == 0) {
+        fail("if_nametoindex(" + interface + ")");
+        return false;
+    }
+
+    fd_ = ::socket(AF_XDP, SOCK_RAW, 0);
+    if (fd_ < 0) {
+        fail("socket(AF_XDP)");
+        return false;
+    }
+
+    if (!setupUmem()) {
+        return false;
+    }
+
+    struct sockaddr_xdp addr{};
+    addr.sxdp_family   = AF_XDP;
+    addr.sxdp_ifindex  = ifindex;
+    addr.sxdp_queue_id = config_.queue_id;
+    addr.sxdp_flags    = (config_.zero_copy ? XDP_ZEROCOPY : XDP_COPY) | XDP_USE_NEED_WAKEUP;
+    if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        fail("bind(" + interface + " queue " + std::to_string(config_.queue_id) + ")");
+        return false;
+    }
+
+    if (!config_.program->isAttached() &&
+        !config_.program->attach(ifindex, config_.skb_mode)) {
+        last_error_ = config_.program->getLastError();
+        close();
+        return false;
+    }
+    if (!config_.program->registerSocket(config_.queue_id, fd_)) {
+        last_error_ = config_.program->getLastError();
+        close();
+        return false;
+    }
+
+    frames_.reserve(config_.batch_size);
+    addrs_.reserve(config_.batch_size);
+    return true;
+}
+
+bool XdpCaptureSource::setupUmem() {
+    umem_size_ = static_cast<size_t>(config_.frame_size) * config_.frame_count;
+    void* area = mmap(nullptr, umem_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        umem_size_ = 0;
+        fail("mmap(UMEM)");
+        return false;
+    }
+    umem_ = static_cast<uint8_t*>(area);
+
+    struct xdp_umem_reg reg{};
+    reg.addr       = reinterpret_cast<uint64_t>(umem_);
+    reg.len        = umem_size_;
+    reg.chunk_size = config_.frame_size;
+    reg.headroom   = 0;
+    if (setsockopt(fd_, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0) {
+        fail("XDP_UMEM_REG");
+        return false;
+    }
+
+    const int ring_size = static_cast<int>(config_.ring_size);
+    if (setsockopt(fd_, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(fd_, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) < 0) {
+        fail("XDP ring setup");
+        return false;
+    }
+
+    struct xdp_mmap_offsets offsets{};
+    socklen_t len = sizeof(offsets);
+    if (getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &len) < 0) {
+        fail("XDP_MMAP_OFFSETS");
+        return false;
+    }
+
+    if (!mapRing(fill_, XDP_UMEM_PGOFF_FILL_RING, &offsets.fr, sizeof(uint64_t)) ||
+        !mapRing(completion_, XDP_UMEM_PGOFF_COMPLETION_RING, &offsets.cr, sizeof(uint64_t)) ||
+        !mapRing(rx_, XDP_PGOFF_RX_RING, &offsets.rx, sizeof(struct xdp_desc))) {
+        return false;
+    }
+
+    // Hand the kernel as many empty frames as the fill ring can hold
+    const uint32_t initial = std::min(config_.frame_count, config_.ring_size);
+    auto* fill = static_cast<uint64_t*>(fill_.descs);
+    for (uint32_t i = 0; i < initial; ++i) {
+        fill[i & fill_.mask] = static_cast<uint64_t>(i) * config_.frame_size;
+    }
+    __atomic_store_n(fill_.producer, initial, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool XdpCaptureSource::mapRing(Ring& ring, uint64_t pgoff, const void* offsets,
+                               size_t desc_size)
+{
+    const auto* off = static_cast<const struct xdp_ring_offset*>(offsets);
+
+    ring.map_size = off->desc + config_.ring_size * desc_size;
+    ring.map = mmap(nullptr, ring.map_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, static_cast<off_t>(pgoff));
+    if (ring.map == MAP_FAILED) {
+        ring.map = nullptr;
+        ring.map_size = 0;
+        fail("mmap(XDP ring)");
+        return false;
+    }
+
+    auto* base    = static_cast<uint8_t*>(ring.map);
+    ring.producer = reinterpret_cast<uint32_t*>(base + off->producer);
+    ring.consumer = reinterpret_cast<uint32_t*>(base + off->consumer);
+    ring.flags    = reinterpret_cast<uint32_t*>(base + off->flags);
+    ring.descs    = base + off->desc;
+    ring.mask     = config_.ring_size - 1;
+    return true;
+}
+
+void XdpCaptureSource::unmapRing(Ring& ring) {
+    if (ring.map) {
+        munmap(ring.map, ring.map_size);
+    }
+    ring = Ring{};
+}
+
+void XdpCaptureSource::close() {
+    unmapRing(rx_);
+    unmapRing(fill_);
+    unmapRing(completion_);
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (umem_) {
+        munmap(umem_, umem_size_);
+        umem_ = nullptr;
+        umem_size_ = 0;
+    }
+}
+
+void XdpCaptureSource::kick() {
+    // With XDP_USE_NEED_WAKEUP the kernel only refills from the fill ring
+    // after a syscall when it has flagged that it ran dry
+    if (__atomic_load_n(fill_.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP) {
+        recvfrom(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+    }
+}
+
+int XdpCaptureSource::dispatch(const BatchHandler& handler, int timeout_ms) {
+    const uint32_t consumer = *rx_.consumer;
+    uint32_t available = __atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) - consumer;
+
+    if (available == 0) {
+        kick();
+
+        struct pollfd pfd{};
+        pfd.fd     = fd_;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeout_ms) < 0) {
+            if (errno == EINTR) return 0;
+            last_error_ = std::string("poll: ") + std::strerror(errno);
+            return -1;
+        }
+
+        available = __atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) - consumer;
+        if (available == 0) {
+            return 0;
+        }
+    }
+
+    const uint32_t count = std::min(available, config_.batch_size);
+
+    // AF_XDP carries no kernel timestamp; stamp the batch on arrival
+    struct timeval now{};
+    gettimeofday(&now, nullptr);
+
+    frames_.clear();
+    addrs_.clear();
+    const auto* descs = static_cast<const struct xdp_desc*>(rx_.descs);
+    for (uint32_t i = 0; i < count; ++i) {
+        const struct xdp_desc& desc = descs[(consumer + i) & rx_.mask];
+
+        CaptureFrame frame;
+        frame.data        = umem_ + desc.addr;
+        frame.caplen      = desc.len;
+        frame.wire_length = desc.len;
+        frame.timestamp   = now;
+        frames_.push_back(frame);
+        addrs_.push_back(desc.addr - (desc.addr % config_.frame_size));
+    }
+
+    handler(frames_.data(), frames_.size());
+
+    // The pipeline is done with these frames; return them to the fill ring.
+    // Every frame came out of the fill ring, so there is always room.
+    const uint32_t producer = *fill_.producer;
+    auto* fill = static_cast<uint64_t*>(fill_.descs);
+    for (uint32_t i = 0; i < count; ++i) {
+        fill[(producer + i) & fill_.mask] = addrs_[i];
+    }
+    __atomic_store_n(fill_.producer, producer + count, __ATOMIC_RELEASE);
+    __atomic_store_n(rx_.consumer, consumer + count, __ATOMIC_RELEASE);
+    kick();
+
+    packets_received_ += count;
+    ++batches_;
+    return static_cast<int>(count);
+}
+
+CaptureStats XdpCaptureSource::getStats() const {
+    CaptureStats stats;
+    stats.packets_received = packets_received_.load();
+    stats.batches          = batches_.load();
+    stats.queue_id         = static_cast<int>(config_.queue_id);
+
+    if (fd_ < 0) {
+        return stats;
+    }
+
+    struct xdp_statistics ks{};
+    socklen_t len = sizeof(ks);
+    if (getsockopt(fd_, SOL_XDP, XDP_STATISTICS, &ks, &len) == 0) {
+        stats.packets_dropped = ks.rx_dropped + ks.rx_ring_full;
+    }
+
+    auto occupancy = [](const Ring& ring) -> uint32_t {
+        return __atomic_load_n(ring.producer, __ATOMIC_ACQUIRE) -
+               __atomic_load_n(ring.consumer, __ATOMIC_ACQUIRE);
+    };
+    stats.fill_ring_used       = occupancy(fill_);
+    stats.completion_ring_used = occupancy(completion_);
+    stats.ring_size            = config_.ring_size;
+    return stats;
+}
+
+#else // !__linux__
+
+bool hasSymmetricRss(const std::string&, std::string& why) {
+    why = "RSS is only read on Linux";
+    return false;
+}
+
+XdpRedirectProgram::~XdpRedirectProgram() {
+}
+
+bool XdpRedirectProgram::attach(unsigned int, bool) {
+    last_error_ = "XDP is only available on Linux";
+    return false;
+}
+
+bool XdpRedirectProgram::registerSocket(uint32_t, int) {
+    return false;
+}
+
+void XdpRedirectProgram::detach() {
+}
+
+XdpCaptureSource::XdpCaptureSource(const XdpConfig& config)
+    : config_(config)
+    , fd_(-1)
+    , umem_(nullptr)
+    , umem_size_(0) {
+}
+
+XdpCaptureSource::~XdpCaptureSource() {
+}
+
+bool XdpCaptureSource::open(const std::string&) {
+    last_error_ = "AF_XDP is only available on Linux";
+    return false;
+}
+
+void XdpCaptureSource::close() {
+}
+
+int XdpCaptureSource::dispatch(const BatchHandler&, int) {
+    return -1;
+}
+
+CaptureStats XdpCaptureSource::getStats() const {
+    return CaptureStats{};
+}
+
+#endif
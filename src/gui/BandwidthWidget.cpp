@@ -1,5 +1,29 @@
 #include "gui/BandwidthWidget.hpp"
-#include <QDateTime>
+#include <chrono>
+#include <iterator>
+
+namespace {
+
+// Each range reads the history at the finest resolution that still
+// covers it, so no range draws more than a few thousand points
+struct TimeRange {
+    const char* label;
+    int seconds;
+    std::chrono::seconds resolution;
+};
+
+constexpr TimeRange TIME_RANGES[] = {
+    {"Last Minute", 60, std::chrono::seconds(1)},
+    {"Last 5 Minutes", 300, std::chrono::seconds(1)},
+    {"Last 15 Minutes", 900, std::chrono::seconds(1)},
+    {"Last Hour", 3600, std::chrono::seconds(1)},
+    {"Last Day", 86400, std::chrono::minutes(1)},
+    {"Last Week", 604800, std::chrono::hours(1)},
+    {"Last 30 Days", 2592000, std::chrono::hours(1)},
+    {"Last Year", 31536000, std::chrono::hours(24)},
+};
+
+} // namespace
 
 BandwidthWidget::BandwidthWidget(NetworkMonitor* monitor, QWidget* parent)
     : QWidget(parent)
@@ -18,7 +42,9 @@ void BandwidthWidget::setupUI() {
     average_bandwidth_label_ = new QLabel("Average Bandwidth: 0 bps", this);
     
     time_range_combo_ = new QComboBox(this);
-    time_range_combo_->addItems({"Last Minute", "Last 5 Minutes", "Last 15 Minutes", "Last Hour"});
+    for (const TimeRange& range : TIME_RANGES) {
+        time_range_combo_->addItem(range.label);
+    }
     time_range_combo_->setCurrentIndex(0);
     
     top_bar->addWidget(current_bandwidth_label_);
@@ -69,21 +95,16 @@ void BandwidthWidget::update() {
 }
 
 void BandwidthWidget::updateTimeRange(int index) {
-    int seconds;
-    switch (index) {
-        case 0: seconds = 60; break;      // Last minute
-        case 1: seconds = 300; break;     // Last 5 minutes
-        case 2: seconds = 900; break;     // Last 15 minutes
-        case 3: seconds = 3600; break;    // Last hour
-        default: seconds = 60;
-    }
+    const int count = static_cast<int>(std::size(TIME_RANGES));
+    time_range_ = index >= 0 && index < count ? index : 0;
     
-    axis_x_->setRange(0, seconds);
+    axis_x_->setRange(0, TIME_RANGES[time_range_].seconds);
     updateChart();
 }
 
 void BandwidthWidget::updateChart() {
-    auto bandwidth_data = monitor_->getBandwidthHistory();
+    const TimeRange& range = TIME_RANGES[time_range_];
+    auto bandwidth_data = monitor_->getStatistics()->getBandwidthHistory(range.resolution);
     if (bandwidth_data.empty()) {
         return;
     }
@@ -91,15 +112,12 @@ void BandwidthWidget::updateChart() {
     // Clear existing data
     bandwidth_series_->clear();
     
-    // Get current time range
-    int max_seconds = axis_x_->max();
-    uint64_t current_time = QDateTime::currentSecsSinceEpoch();
-    
     // Add data points
+    const auto now = std::chrono::system_clock::now();
     for (const auto& [timestamp, bandwidth] : bandwidth_data) {
-        int seconds_ago = current_time - timestamp;
-        if (seconds_ago <= max_seconds) {
-            bandwidth_series_->append(max_seconds - seconds_ago, bandwidth);
+        const auto seconds_ago = std::chrono::duration_cast<std::chrono::seconds>(now - timestamp).count();
+        if (seconds_ago <= range.seconds) {
+            bandwidth_series_->append(static_cast<double>(range.seconds - seconds_ago), bandwidth);
         }
     }
     
@@ -115,10 +133,10 @@ void BandwidthWidget::updateLabels() {
     auto stats = monitor_->getStatistics();
     
     current_bandwidth_label_->setText(QString("Current Bandwidth: %1")
-        .arg(formatBandwidth(stats.getCurrentBandwidth())));
+        .arg(formatBandwidth(stats->getCurrentBandwidth())));
     
     average_bandwidth_label_->setText(QString("Average Bandwidth: %1")
-        .arg(formatBandwidth(stats.getAverageBandwidth())));
+        .arg(formatBandwidth(stats->getAverageBandwidth())));
 }
 
 void BandwidthWidget::clearChart() {
@@ -10,7 +10,7 @@ FilterDialog::FilterDialog(QWidget* parent)
     auto* layout = new QVBoxLayout(this);
 
     // Add description label
-    auto* label = new QLabel("Enter BPF filter expression:", this);
+    auto* label = new QLabel("Enter BPF filter expression (applied without restarting capture):", this);
     layout->addWidget(label);
 
     // Create filter input
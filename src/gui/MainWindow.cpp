@@ -200,13 +200,19 @@ void MainWindow::updateDisplay() {
 
     // Update status bar
     auto stats = monitor_->getStatistics();
-    statusBar()->showMessage(QString("Packets: %1 | Bandwidth: %2 bps")
-        .arg(stats.getTotalPackets())
-        .arg(stats.getCurrentBandwidth()));
+    QString status = QString("Packets: %1 | Bandwidth: %2 bps")
+        .arg(stats->getTotalPackets())
+        .arg(stats->getCurrentBandwidth());
+    const uint32_t rate = monitor_->getSamplingRate();
+    if (rate > 1) {
+        status += QString(" | Sampling 1 in %1 flows (estimated)").arg(rate);
+    }
+    statusBar()->showMessage(status);
 }
 
 void MainWindow::showFilterDialog() {
     FilterDialog dialog(this);
+    dialog.setFilter(QString::fromStdString(monitor_->getFilter()));
     if (dialog.exec() == QDialog::Accepted) {
         QString filter = dialog.getFilter();
         try {
@@ -74,7 +74,7 @@ void PacketsWidget::updateTable() {
 
 void PacketsWidget::updateLabels() {
     total_packets_label_->setText(QString("Total Packets: %1")
-        .arg(monitor_->getStatistics().getTotalPackets()));
+        .arg(monitor_->getStatistics()->getTotalPackets()));
 }
 
 void PacketsWidget::clearPackets() {
@@ -41,7 +41,7 @@ void StatisticsWidget::update() {
 
 void StatisticsWidget::updateTable() {
     auto stats = monitor_->getStatistics();
-    auto protocol_stats = stats.getProtocolStatistics();
+    auto protocol_stats = stats->getProtocolStatistics();
 
     stats_table_->setRowCount(protocol_stats.size());
     int row = 0;
@@ -51,8 +51,8 @@ void StatisticsWidget::updateTable() {
         stats_table_->setItem(row, 1, new QTableWidgetItem(QString::number(count)));
         
         // Calculate bytes and percentage
-        uint64_t bytes = stats.getProtocolBytes(protocol);
-        double percentage = (count * 100.0) / stats.getTotalPackets();
+        uint64_t bytes = stats->getProtocolBytes(protocol);
+        double percentage = (count * 100.0) / stats->getTotalPackets();
         
         stats_table_->setItem(row, 2, new QTableWidgetItem(QString::number(bytes)));
         stats_table_->setItem(row, 3, new QTableWidgetItem(QString::number(percentage, 'f', 2) + "%"));
@@ -65,16 +65,16 @@ void StatisticsWidget::updateLabels() {
     auto stats = monitor_->getStatistics();
     
     total_packets_label_->setText(QString("Total Packets: %1")
-        .arg(stats.getTotalPackets()));
+        .arg(stats->getTotalPackets()));
     
     total_bytes_label_->setText(QString("Total Bytes: %1")
-        .arg(stats.getTotalBytes()));
+        .arg(stats->getTotalBytes()));
     
     current_bandwidth_label_->setText(QString("Current Bandwidth: %1 bps")
-        .arg(stats.getCurrentBandwidth()));
+        .arg(stats->getCurrentBandwidth()));
     
-    if (stats.getTotalPackets() > 0) {
-        double avg_size = static_cast<double>(stats.getTotalBytes()) / stats.getTotalPackets();
+    if (stats->getTotalPackets() > 0) {
+        double avg_size = static_cast<double>(stats->getTotalBytes()) / stats->getTotalPackets();
         average_packet_size_label_->setText(QString("Average Packet Size: %1 bytes")
             .arg(avg_size, 0, 'f', 2));
     } else {
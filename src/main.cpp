@@ -57,7 +57,8 @@ int main(int argc, char *argv[]) {
 
     QCommandLineOption interfaceOption(
         QStringList() << "i" << "interface",
-        "Network interface to capture packets on (e.g. eth0, en0).",
+        "Network interface to capture packets on (e.g. eth0, en0), or a "
+        "comma-separated list to capture several at once (e.g. eth1,eth2).",
         "interface"
     );
     parser.addOption(interfaceOption);
@@ -70,6 +71,21 @@ int main(int argc, char *argv[]) {
     );
     parser.addOption(logLevelOption);
 
+    QCommandLineOption readOption(
+        QStringList() << "r" << "read",
+        "Replay a pcap/pcapng file through the pipeline instead of capturing live.",
+        "file"
+    );
+    parser.addOption(readOption);
+
+    QCommandLineOption speedOption(
+        QStringList() << "speed",
+        "Replay speed: max (as fast as possible), original, or a multiplier such as 4.",
+        "speed",
+        "max"
+    );
+    parser.addOption(speedOption);
+
     parser.process(app);
 
     // -------------------------------------------------------------------------
@@ -101,6 +117,24 @@ int main(int argc, char *argv[]) {
         config.setInterface(parser.value(interfaceOption).toStdString());
     }
 
+    // Offline replay replaces the live interface with a capture file
+    if (parser.isSet(readOption)) {
+        const QString speed = parser.value(speedOption);
+        double factor = 0.0;   // 0 = as fast as possible
+        if (speed == "original") {
+            factor = 1.0;
+        } else if (speed != "max") {
+            bool ok = false;
+            factor = QString(speed).remove('x').toDouble(&ok);
+            if (!ok || factor <= 0.0) {
+                logger.log(LogLevel::ERROR, "Invalid --speed value: " + speed.toStdString());
+                return EXIT_FAILURE;
+            }
+        }
+        config.setValue("monitoring", "read_file", parser.value(readOption).toStdString());
+        config.setValue("monitoring", "replay_speed", factor);
+    }
+
     // -------------------------------------------------------------------------
     // Core monitor initialisation
     // -------------------------------------------------------------------------
@@ -115,7 +149,16 @@ int main(int argc, char *argv[]) {
     // -------------------------------------------------------------------------
     // Launch GUI or CLI
     // -------------------------------------------------------------------------
-    if (parser.isSet(cliOption)) {
+    if (parser.isSet(cliOption) && monitor->isReplay()) {
+        // Headless replay — no interactive prompt; print the throughput
+        // report and exit once the file is exhausted
+        logger.log(LogLevel::INFO, "Starting headless replay.");
+        QObject::connect(monitor.get(), &NetworkMonitor::captureFinished, &app, [&monitor]() {
+            std::cout << monitor->getCaptureReport() << std::endl;
+            QCoreApplication::quit();
+        }, Qt::QueuedConnection);
+        monitor->start();
+    } else if (parser.isSet(cliOption)) {
         // Headless / CLI mode — useful for servers and scripted environments
         logger.log(LogLevel::INFO, "Starting in CLI mode.");
         CommandLineInterface cli(monitor.get());
@@ -0,0 +1,132 @@
+#include "protocols/Checksum.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_X86 1
+#endif
+
+namespace {
+
+using SumFunction = uint64_t (*)(const uint8_t*, size_t);
+
+// Adds 32-bit words into a 64-bit accumulator; carries are folded back in
+// at the end, which is equivalent to ones' complement addition of the
+// 16-bit words
+uint64_t sumScalar(const uint8_t* data, size_t length) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        sum += word;
+    }
+    if (i + 2 <= length) {
+        uint16_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        sum += word;
+        i += 2;
+    }
+    if (i < length) {
+        // The odd byte is the first of a zero-padded word
+        const uint8_t last[2] = {data[i], 0};
+        uint16_t word;
+        std::memcpy(&word, last, sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+#ifdef CHECKSUM_X86
+
+// Widens 16-bit words into 32-bit lanes. A lane takes at most 0xffff per
+// step, so it can't overflow within BLOCK steps; blocks are drained into a
+// 64-bit total.
+constexpr size_t BLOCK_STEPS = 0x8000;
+
+__attribute__((target("sse2")))
+uint64_t sumSse2(const uint8_t* data, size_t length) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t total = 0;
+    size_t i = 0;
+    while (length - i >= 16) {
+        __m128i acc = _mm_setzero_si128();
+        for (size_t step = 0; step < BLOCK_STEPS && length - i >= 16; ++step, i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+        }
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        total += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+    return total + sumScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+uint64_t sumAvx2(const uint8_t* data, size_t length) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t total = 0;
+    size_t i = 0;
+    while (length - i >= 32) {
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t step = 0; step < BLOCK_STEPS && length - i >= 32; ++step, i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+        }
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        for (const uint32_t lane : lanes) {
+            total += lane;
+        }
+    }
+    return total + sumScalar(data + i, length - i);
+}
+
+#endif
+
+struct Implementation {
+    SumFunction function;
+    const char* name;
+};
+
+Implementation select() {
+#ifdef CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {sumAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {sumSse2, "sse2"};
+    }
+#endif
+    return {sumScalar, "scalar"};
+}
+
+const Implementation& implementation() {
+    static const Implementation selected = select();
+    return selected;
+}
+
+} // namespace
+
+uint64_t InternetChecksum::sum(const uint8_t* data, size_t length, uint64_t initial) {
+    // Short regions (headers, pseudo-headers) aren't worth the vector setup
+    if (length < 64) {
+        return initial + sumScalar(data, length);
+    }
+    return initial + implementation().function(data, length);
+}
+
+uint16_t InternetChecksum::fold(uint64_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(sum);
+}
+
+const char* InternetChecksum::getImplementation() {
+    return implementation().name;
+}
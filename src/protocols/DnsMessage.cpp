@@ -0,0 +1,90 @@
+#include "protocols/DnsMessage.hpp"
+
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t POINTER = 0xc0;
+
+uint16_t readU16(std::span<const uint8_t> message, size_t offset) {
+    return static_cast<uint16_t>(message[offset] << 8 | message[offset + 1]);
+}
+
+constexpr std::string_view RCODE_NAMES[16] = {
+    "NOERROR", "FORMERR", "SERVFAIL", "NXDOMAIN", "NOTIMP", "REFUSED",
+    "YXDOMAIN", "YXRRSET", "NXRRSET", "NOTAUTH", "NOTZONE",
+    "RCODE11", "RCODE12", "RCODE13", "RCODE14", "RCODE15"
+};
+
+} // namespace
+
+bool DnsMessage::parse(std::span<const uint8_t> message) {
+    if (message.size() < HEADER_LENGTH) {
+        return false;
+    }
+    id_ = readU16(message, 0);
+    flags_ = readU16(message, 2);
+    question_count_ = readU16(message, 4);
+    answer_count_ = readU16(message, 6);
+    name_length_ = 0;
+    type_ = 0;
+    class_ = 0;
+    if (question_count_ == 0) {
+        return true;
+    }
+
+    const size_t end = readName(message, HEADER_LENGTH, name_, name_length_);
+    if (end == 0 || end + 4 > message.size()) {
+        return false;
+    }
+    type_ = readU16(message, end);
+    class_ = readU16(message, end + 2);
+    return true;
+}
+
+size_t DnsMessage::readName(std::span<const uint8_t> message, size_t offset,
+                            char* name, size_t& length) {
+    length = 0;
+    size_t end = 0;             // Past the name where it appears, once a pointer is followed
+    size_t segment = offset;    // Start of the labels being read; pointers must go below it
+    size_t position = offset;
+    while (position < message.size()) {
+        const uint8_t label = message[position];
+        if ((label & POINTER) == POINTER) {
+            if (position + 1 >= message.size()) {
+                return 0;
+            }
+            const size_t target = static_cast<size_t>(label & ~POINTER) << 8 | message[position + 1];
+            if (target >= segment) {
+                return 0;
+            }
+            if (end == 0) {
+                end = position + 2;
+            }
+            segment = position = target;
+            continue;
+        }
+        if (label & POINTER) {
+            return 0;           // Extended label types (RFC 6891 retired them)
+        }
+        if (label == 0) {
+            return end ? end : position + 1;
+        }
+
+        const size_t separator = length ? 1 : 0;
+        if (position + 1 + label > message.size() || length + separator + label > MAX_NAME_LENGTH) {
+            return 0;
+        }
+        if (separator) {
+            name[length++] = '.';
+        }
+        std::memcpy(name + length, message.data() + position + 1, label);
+        length += label;
+        position += 1 + label;
+    }
+    return 0;
+}
+
+std::string_view DnsMessage::getRcodeString(uint8_t rcode) {
+    return RCODE_NAMES[rcode & 0x0f];
+}
@@ -0,0 +1,95 @@
+#include "protocols/FlowKey.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+static_assert(sizeof(FlowKey) == 44, "FlowKey should stay packed");
+
+namespace {
+
+// Same finaliser as IpAddress: the addresses are hashed already, so this
+// only has to fold in the ports and protocol
+uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+} // namespace
+
+bool FlowKey::isForward(const IpAddress& source, uint16_t source_port,
+                        const IpAddress& destination, uint16_t destination_port) {
+    if (source == destination) {
+        return source_port <= destination_port;
+    }
+    return source < destination;
+}
+
+FlowKey::FlowKey(const IpAddress& source, uint16_t source_port,
+                 const IpAddress& destination, uint16_t destination_port,
+                 Packet::Protocol transport)
+    : family_(source.getFamily())
+    , transport_(static_cast<uint8_t>(transport))
+{
+    const bool forward = isForward(source, source_port, destination, destination_port);
+    const IpAddress& first = forward ? source : destination;
+    const IpAddress& second = forward ? destination : source;
+    std::memcpy(first_.data(), first.data(), first.size());
+    std::memcpy(second_.data(), second.data(), second.size());
+    first_port_ = forward ? source_port : destination_port;
+    second_port_ = forward ? destination_port : source_port;
+
+    const uint64_t hash = mix((static_cast<uint64_t>(first.hash()) << 32 | second.hash()) ^
+                              mix(static_cast<uint64_t>(first_port_) << 24 |
+                                  static_cast<uint64_t>(second_port_) << 8 | transport_));
+    hash_ = static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+IpAddress FlowKey::makeAddress(const std::array<uint8_t, 16>& bytes) const {
+    switch (family_) {
+        case IpAddress::Family::V4: return IpAddress::fromV4(bytes.data());
+        case IpAddress::Family::V6: return IpAddress::fromV6(bytes.data());
+        case IpAddress::Family::NONE: break;
+    }
+    return IpAddress();
+}
+
+IpAddress FlowKey::getFirstAddress() const {
+    return makeAddress(first_);
+}
+
+IpAddress FlowKey::getSecondAddress() const {
+    return makeAddress(second_);
+}
+
+std::string FlowKey::toString() const {
+    IpAddress::Text first_text, second_text;
+    const std::string_view first = getFirstAddress().format(first_text);
+    const std::string_view second = getSecondAddress().format(second_text);
+    const bool v6 = family_ == IpAddress::Family::V6;
+    const char* transport = getTransport() == Packet::Protocol::TCP ? "tcp"
+                          : getTransport() == Packet::Protocol::UDP ? "udp" : "ip";
+
+    char buffer[128];
+    const int written = std::snprintf(buffer, sizeof(buffer), "%s%.*s%s:%u-%s%.*s%s:%u/%s",
+                                      v6 ? "[" : "", static_cast<int>(first.size()), first.data(),
+                                      v6 ? "]" : "", static_cast<unsigned>(first_port_),
+                                      v6 ? "[" : "", static_cast<int>(second.size()), second.data(),
+                                      v6 ? "]" : "", static_cast<unsigned>(second_port_), transport);
+    return std::string(buffer, std::min(static_cast<size_t>(std::max(written, 0)), sizeof(buffer) - 1));
+}
+
+bool FlowKey::operator==(const FlowKey& other) const {
+    return hash_ == other.hash_ && first_port_ == other.first_port_ &&
+           second_port_ == other.second_port_ && transport_ == other.transport_ &&
+           family_ == other.family_ && first_ == other.first_ && second_ == other.second_;
+}
+
+std::ostream& operator<<(std::ostream& os, const FlowKey& key) {
+    return os << key.toString();
+}
@@ -0,0 +1,106 @@
+#include "protocols/IpAddress.hpp"
+
+#include <arpa/inet.h>       // inet_ntop, inet_pton
+#include <netinet/in.h>
+#include <cstring>
+#include <ostream>
+
+namespace {
+
+static_assert(std::tuple_size_v<IpAddress::Text> >= INET6_ADDRSTRLEN,
+              "IpAddress::Text must hold any address inet_ntop can produce");
+
+uint64_t load64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Final mix of MurmurHash3's 64-bit variant: cheap, and every input bit
+// affects every output bit, so consecutive addresses spread across buckets
+uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+} // namespace
+
+IpAddress::IpAddress(Family family, const uint8_t* bytes, size_t length)
+    : family_(family)
+{
+    std::memcpy(bytes_.data(), bytes, length);
+    const uint64_t hash = mix(load64(bytes_.data()) ^ mix(load64(bytes_.data() + 8)) ^
+                              static_cast<uint64_t>(family));
+    hash_ = static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+IpAddress IpAddress::fromV4(const uint8_t* bytes) {
+    return IpAddress(Family::V4, bytes, 4);
+}
+
+IpAddress IpAddress::fromV6(const uint8_t* bytes) {
+    return IpAddress(Family::V6, bytes, 16);
+}
+
+std::optional<IpAddress> IpAddress::parse(std::string_view text) {
+    if (text.empty()) {
+        return IpAddress();
+    }
+
+    // inet_pton needs a terminated string
+    Text buffer;
+    if (text.size() >= buffer.size()) {
+        return std::nullopt;
+    }
+    std::memcpy(buffer.data(), text.data(), text.size());
+    buffer[text.size()] = '\0';
+
+    uint8_t bytes[16];
+    if (inet_pton(AF_INET, buffer.data(), bytes) == 1) {
+        return fromV4(bytes);
+    }
+    if (inet_pton(AF_INET6, buffer.data(), bytes) == 1) {
+        return fromV6(bytes);
+    }
+    return std::nullopt;
+}
+
+size_t IpAddress::size() const {
+    switch (family_) {
+        case Family::V4:   return 4;
+        case Family::V6:   return 16;
+        case Family::NONE: break;
+    }
+    return 0;
+}
+
+std::string_view IpAddress::format(Text& buffer) const {
+    // The view always points into buffer and is terminated, so callers can
+    // hand data() to C APIs even for an empty address
+    if (isEmpty() ||
+        inet_ntop(isV4() ? AF_INET : AF_INET6, bytes_.data(), buffer.data(), buffer.size()) == nullptr) {
+        buffer[0] = '\0';
+    }
+    return std::string_view(buffer.data());
+}
+
+std::string IpAddress::toString() const {
+    Text buffer;
+    return std::string(format(buffer));
+}
+
+bool IpAddress::operator<(const IpAddress& other) const {
+    if (family_ != other.family_) {
+        return family_ < other.family_;
+    }
+    return std::memcmp(bytes_.data(), other.bytes_.data(), bytes_.size()) < 0;
+}
+
+std::ostream& operator<<(std::ostream& os, const IpAddress& address) {
+    IpAddress::Text buffer;
+    return os << address.format(buffer);
+}
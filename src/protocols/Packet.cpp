@@ -1,29 +1,116 @@
-/**
 #include "protocols/Packet.hpp"
-#include "utils/Logger.hpp"
-
-#include <netinet/ether.h>   // Ethernet header structures
-#include <netinet/ip.h>      // IPv4 header structures
-#include <netinet/ip6.h>     // IPv6 header structures
-#include <netinet/tcp.h>     // TCP header structures
-#include <netinet/udp.h>     // UDP header structures
-#include <netinet/ip_icmp.h> // ICMP header structures
-#include <arpa/inet.h>       // inet_ntop, ntohs, ntohl
-#include <cstring>
-#include <sstream>
-#include <iomanip>
+#include "protocols/PacketPool.hpp"
+#include "protocols/PacketView.hpp"
+#include "core/CaptureProfile.hpp"
+
+#include <algorithm>
 
 // ---------------------------------------------------------------------------
-// Static factory
+// Construction
 // ---------------------------------------------------------------------------
 
-/**
-Packet Packet::parse(const uint8_t* data, uint32_t length,
-                     const struct timeval& ts)
+Packet::Packet(const uint8_t* data, size_t caplen, size_t wire_length,
+               const struct timeval& ts, const CaptureProfile* profile)
+    // Backends without kernel truncation (AF_XDP, replay) deliver whole
+    // frames; apply the profile's snaplen here so every backend keeps the same
+    : Packet(PacketView(data, profile ? std::min<size_t>(caplen, profile->getSnaplen()) : caplen,
+                        wire_length, ts),
+             profile)
 {
-    Packet pkt;
-    pkt.m_rawLength  = length;
-    pkt.m_timestamp  = ts;
-    pkt.m_protocol   = Protocol::UNKNOWN;
+}
+
+Packet::Packet(const PacketView& view, const CaptureProfile* profile) {
+    assign(view, profile);
+}
+
+Packet::~Packet() {
+    if (pool_link_.pool != nullptr) {
+        pool_link_.pool->release(std::move(*this));
+    }
+}
+
+void Packet::assign(const PacketView& view, const CaptureProfile* profile) {
+    length                = view.length;
+    captured_length       = view.captured_length;
+    timestamp             = view.timestamp;
+    interface.assign(view.interface);
+    protocol              = view.getProtocol();
+    network_protocol      = view.getNetworkProtocol();
+    transport_protocol    = view.getTransportProtocol();
+    source_address        = view.sourceAddress();
+    destination_address   = view.destinationAddress();
+    source_port           = view.getSourcePort();
+    destination_port      = view.getDestinationPort();
+    is_fragmented         = view.isFragmented();
+    is_malformed          = view.isMalformed();
+    sequence_number       = view.getSequenceNumber();
+    acknowledgment_number = view.getAcknowledgmentNumber();
+    window_size           = view.getWindowSize();
+    ttl                   = view.getTtl();
+    tos                   = view.getTos();
+    payload_offset        = view.getPayloadOffset();
+    payload_length        = view.getPayloadLength();
+
+    if (view.data == nullptr) {
+        raw_data.clear();
+        return;
+    }
+
+    // Copy every parsed header, then only as much payload as the profile
+    // allows for this flow
+    const size_t header_end = std::min(payload_offset, captured_length);
+    const size_t budget = profile
+        ? profile->getPayloadBudget(source_port, destination_port)
+        : CaptureProfile::UNLIMITED;
+    const size_t kept = std::min(captured_length - header_end, budget);
+
+    raw_data.assign(view.data, view.data + header_end + kept);
+}
+
+std::span<const uint8_t> Packet::getPayload() const {
+    const size_t offset = std::min(payload_offset, raw_data.size());
+    return std::span<const uint8_t>(raw_data).subspan(offset);
+}
+
+PacketView Packet::view() const {
+    PacketView view(raw_data.data(), raw_data.size(), length, timestamp);
+    view.interface = interface;
+    return view;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+std::string Packet::getProtocolString(Protocol protocol) {
+    switch (protocol) {
+        case Protocol::ETHERNET: return "Ethernet";
+        case Protocol::IPV4:     return "IPv4";
+        case Protocol::IPV6:     return "IPv6";
+        case Protocol::TCP:      return "TCP";
+        case Protocol::UDP:      return "UDP";
+        case Protocol::ICMP:     return "ICMP";
+        case Protocol::HTTP:     return "HTTP";
+        case Protocol::HTTPS:    return "HTTPS";
+        case Protocol::TLS:      return "TLS";
+        case Protocol::DNS:      return "DNS";
+        case Protocol::DHCP:     return "DHCP";
+        case Protocol::ARP:      return "ARP";
+        case Protocol::UNKNOWN:  break;
+    }
+    return "Unknown";
+}
+
+std::string Packet::getProtocolString() const {
+    return getProtocolString(protocol);
+}
 
-    if (!data || length < sizeof(struct ethhdr)) {
\ No newline at end of file
+bool Packet::isTCP() const   { return transport_protocol == Protocol::TCP; }
+bool Packet::isUDP() const   { return transport_protocol == Protocol::UDP; }
+bool Packet::isICMP() const  { return transport_protocol == Protocol::ICMP; }
+bool Packet::isHTTP() const  { return protocol == Protocol::HTTP; }
+bool Packet::isHTTPS() const { return protocol == Protocol::HTTPS; }
+bool Packet::isDNS() const   { return protocol == Protocol::DNS; }
+bool Packet::isARP() const   { return network_protocol == Protocol::ARP; }
+bool Packet::isIPv4() const  { return network_protocol == Protocol::IPV4; }
+bool Packet::isIPv6() const  { return network_protocol == Protocol::IPV6; }
@@ -0,0 +1,29 @@
+#include "protocols/PacketPool.hpp"
+
+PacketPool::PacketPool(size_t capacity)
+    : free_(capacity)
+{
+}
+
+Packet PacketPool::acquire() {
+    auto recycled = free_.tryPop();
+    if (recycled) {
+        hits_.store(hits_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        misses_.store(misses_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        recycled.emplace();
+    }
+    Packet packet(std::move(*recycled));
+    packet.pool_link_.pool = this;
+    return packet;
+}
+
+void PacketPool::release(Packet&& packet) {
+    // Unlink first, so the copy in the ring and anything left behind when
+    // the ring is full are destroyed normally
+    packet.pool_link_.pool = nullptr;
+    if (packet.raw_data.capacity() > MAX_RETAINED_BYTES) {
+        return;
+    }
+    free_.tryPush(std::move(packet));
+}
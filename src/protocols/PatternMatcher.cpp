@@ -0,0 +1,425 @@
+#include "protocols/PatternMatcher.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PATTERN_X86 1
+#endif
+
+namespace {
+
+constexpr uint32_t NONE = UINT32_MAX;
+constexpr size_t BUCKETS = 8;
+constexpr size_t MAX_FINGERPRINT = 3;
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Teddy
+// ---------------------------------------------------------------------------
+
+// For each of the first fingerprint bytes of a string, the bucket bits of
+// every string whose byte there has a given low nibble, and a given high
+// nibble. A position is a candidate for a bucket when all of its bytes
+// pass both tables. Each table is 16 bytes repeated twice, for the two
+// 128-bit lanes of AVX2 shuffles.
+struct PatternMatcher::Teddy {
+    using Scan = size_t (*)(const Teddy&, const std::vector<Pattern>&, const uint8_t*,
+                            size_t size, size_t from, size_t& start);
+
+    size_t fingerprint = 1;
+    alignas(32) uint8_t low[MAX_FINGERPRINT][32] = {};
+    alignas(32) uint8_t high[MAX_FINGERPRINT][32] = {};
+    std::array<std::vector<uint32_t>, BUCKETS> buckets;     // In index order
+    Scan scan = nullptr;
+    const char* name = "";
+};
+
+namespace {
+
+using Teddy = PatternMatcher::Teddy;
+using Pattern = PatternMatcher::Pattern;
+
+uint8_t candidateBuckets(const Teddy& teddy, const uint8_t* at) {
+    uint8_t bits = 0xff;
+    for (size_t k = 0; k < teddy.fingerprint; ++k) {
+        bits &= teddy.low[k][at[k] & 0x0f] & teddy.high[k][at[k] >> 4];
+    }
+    return bits;
+}
+
+// Lowest index among the strings of the given buckets found at position
+size_t verify(const Teddy& teddy, const std::vector<Pattern>& patterns, const uint8_t* data,
+              size_t size, size_t position, uint32_t bits) {
+    size_t best = PatternMatcher::NO_MATCH;
+    for (; bits != 0; bits &= bits - 1) {
+        for (const uint32_t index : teddy.buckets[std::countr_zero(bits)]) {
+            if (index >= best) {
+                break;
+            }
+            const std::string& bytes = patterns[index].bytes;
+            if (bytes.size() <= size - position &&
+                std::memcmp(data + position, bytes.data(), bytes.size()) == 0) {
+                best = index;
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+// Positions too close to the end for a full vector
+size_t teddyScalar(const Teddy& teddy, const std::vector<Pattern>& patterns, const uint8_t* data,
+                   size_t size, size_t from, size_t& start) {
+    for (size_t position = from; position + teddy.fingerprint <= size; ++position) {
+        const uint8_t bits = candidateBuckets(teddy, data + position);
+        if (bits != 0) {
+            const size_t found = verify(teddy, patterns, data, size, position, bits);
+            if (found != PatternMatcher::NO_MATCH) {
+                start = position;
+                return found;
+            }
+        }
+    }
+    return PatternMatcher::NO_MATCH;
+}
+
+#ifdef PATTERN_X86
+
+template <size_t M>
+__attribute__((target("ssse3")))
+size_t teddySsse3(const Teddy& teddy, const std::vector<Pattern>& patterns, const uint8_t* data,
+                  size_t size, size_t from, size_t& start) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i low[M];
+    __m128i high[M];
+    for (size_t k = 0; k < M; ++k) {
+        low[k] = _mm_load_si128(reinterpret_cast<const __m128i*>(teddy.low[k]));
+        high[k] = _mm_load_si128(reinterpret_cast<const __m128i*>(teddy.high[k]));
+    }
+
+    size_t i = from;
+    for (; i + 16 + M - 1 <= size; i += 16) {
+        __m128i bits = _mm_set1_epi8(-1);
+        for (size_t k = 0; k < M; ++k) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + k));
+            const __m128i l = _mm_shuffle_epi8(low[k], _mm_and_si128(v, nibble));
+            const __m128i h = _mm_shuffle_epi8(high[k], _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+            bits = _mm_and_si128(bits, _mm_and_si128(l, h));
+        }
+        uint32_t hits = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bits, zero))) & 0xffff;
+        if (hits == 0) {
+            continue;
+        }
+        alignas(16) uint8_t lanes[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), bits);
+        for (; hits != 0; hits &= hits - 1) {
+            const size_t j = std::countr_zero(hits);
+            const size_t found = verify(teddy, patterns, data, size, i + j, lanes[j]);
+            if (found != PatternMatcher::NO_MATCH) {
+                start = i + j;
+                return found;
+            }
+        }
+    }
+    return teddyScalar(teddy, patterns, data, size, i, start);
+}
+
+template <size_t M>
+__attribute__((target("avx2")))
+size_t teddyAvx2(const Teddy& teddy, const std::vector<Pattern>& patterns, const uint8_t* data,
+                 size_t size, size_t from, size_t& start) {
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i low[M];
+    __m256i high[M];
+    for (size_t k = 0; k < M; ++k) {
+        low[k] = _mm256_load_si256(reinterpret_cast<const __m256i*>(teddy.low[k]));
+        high[k] = _mm256_load_si256(reinterpret_cast<const __m256i*>(teddy.high[k]));
+    }
+
+    size_t i = from;
+    for (; i + 32 + M - 1 <= size; i += 32) {
+        __m256i bits = _mm256_set1_epi8(-1);
+        for (size_t k = 0; k < M; ++k) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + k));
+            const __m256i l = _mm256_shuffle_epi8(low[k], _mm256_and_si256(v, nibble));
+            const __m256i h = _mm256_shuffle_epi8(high[k],
+                                                  _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+            bits = _mm256_and_si256(bits, _mm256_and_si256(l, h));
+        }
+        uint32_t hits = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, zero)));
+        if (hits == 0) {
+            continue;
+        }
+        alignas(32) uint8_t lanes[32];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), bits);
+        for (; hits != 0; hits &= hits - 1) {
+            const size_t j = std::countr_zero(hits);
+            const size_t found = verify(teddy, patterns, data, size, i + j, lanes[j]);
+            if (found != PatternMatcher::NO_MATCH) {
+                start = i + j;
+                return found;
+            }
+        }
+    }
+    return teddySsse3<M>(teddy, patterns, data, size, i, start);
+}
+
+#endif
+
+// The vector loop for the CPU and fingerprint length, or nullptr without
+// SSSE3
+Teddy::Scan selectTeddy(size_t fingerprint, const char*& name) {
+#ifdef PATTERN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        name = "teddy-avx2";
+        return fingerprint == 1 ? teddyAvx2<1> : fingerprint == 2 ? teddyAvx2<2> : teddyAvx2<3>;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        name = "teddy-ssse3";
+        return fingerprint == 1 ? teddySsse3<1> : fingerprint == 2 ? teddySsse3<2> : teddySsse3<3>;
+    }
+#endif
+    (void)fingerprint;
+    return nullptr;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Aho-Corasick
+// ---------------------------------------------------------------------------
+
+// Bytes that appear in no string share class 0, which keeps the table
+// narrow: rows are as wide as the number of distinct bytes, not 256
+struct PatternMatcher::AhoCorasick {
+    std::array<uint16_t, 256> byte_class{};
+    size_t classes = 1;
+    size_t max_length = 0;
+    std::vector<uint32_t> next;             // state * classes + class
+    std::vector<uint32_t> output;           // Lowest index of a string ending here, or NONE
+    std::vector<uint32_t> output_link;      // Nearest shorter suffix state with an output
+};
+
+// ---------------------------------------------------------------------------
+// Matcher
+// ---------------------------------------------------------------------------
+
+PatternMatcher::PatternMatcher(std::vector<Pattern> patterns, Engine engine)
+    : patterns_(std::move(patterns))
+{
+    size_t min_floating = SIZE_MAX;
+    for (uint32_t i = 0; i < patterns_.size(); ++i) {
+        const Pattern& pattern = patterns_[i];
+        if (pattern.bytes.empty()) {
+            throw std::invalid_argument("PatternMatcher: empty pattern");
+        }
+        max_length_ = std::max(max_length_, pattern.bytes.size());
+        if (pattern.anchored) {
+            anchored_[static_cast<uint8_t>(pattern.bytes[0])].push_back(i);
+        } else {
+            floating_.push_back(i);
+            min_floating = std::min(min_floating, pattern.bytes.size());
+        }
+    }
+
+    if (engine == Engine::AUTO) {
+        engine = floating_.size() <= TEDDY_MAX_PATTERNS ? Engine::TEDDY : Engine::AHO_CORASICK;
+    }
+
+    if (engine == Engine::TEDDY) {
+        teddy_ = std::make_unique<Teddy>();
+        Teddy& teddy = *teddy_;
+        teddy.fingerprint = std::min(MAX_FINGERPRINT, floating_.empty() ? 1 : min_floating);
+        teddy.scan = selectTeddy(teddy.fingerprint, teddy.name);
+        if (teddy.scan == nullptr) {
+            teddy_.reset();
+            engine = Engine::AHO_CORASICK;
+        } else {
+            // Strings with the same leading bytes share a bucket, so each
+            // bucket's masks stay tight
+            std::vector<uint32_t> order = floating_;
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return patterns_[a].bytes.compare(0, teddy.fingerprint, patterns_[b].bytes,
+                                                  0, teddy.fingerprint) < 0;
+            });
+            for (size_t rank = 0; rank < order.size(); ++rank) {
+                const size_t bucket = rank * BUCKETS / order.size();
+                const std::string& bytes = patterns_[order[rank]].bytes;
+                teddy.buckets[bucket].push_back(order[rank]);
+                for (size_t k = 0; k < teddy.fingerprint; ++k) {
+                    const uint8_t byte = static_cast<uint8_t>(bytes[k]);
+                    for (size_t lane = 0; lane < 32; lane += 16) {
+                        teddy.low[k][lane + (byte & 0x0f)] |= static_cast<uint8_t>(1u << bucket);
+                        teddy.high[k][lane + (byte >> 4)] |= static_cast<uint8_t>(1u << bucket);
+                    }
+                }
+            }
+            for (auto& bucket : teddy.buckets) {
+                std::sort(bucket.begin(), bucket.end());
+            }
+        }
+    }
+
+    if (engine == Engine::AHO_CORASICK) {
+        aho_corasick_ = std::make_unique<AhoCorasick>();
+        AhoCorasick& ac = *aho_corasick_;
+        for (const uint32_t index : floating_) {
+            for (const char c : patterns_[index].bytes) {
+                uint16_t& byte_class = ac.byte_class[static_cast<uint8_t>(c)];
+                if (byte_class == 0) {
+                    byte_class = static_cast<uint16_t>(ac.classes++);
+                }
+            }
+            ac.max_length = std::max(ac.max_length, patterns_[index].bytes.size());
+        }
+
+        // Trie of the strings
+        const size_t width = ac.classes;
+        ac.next.assign(width, NONE);
+        ac.output.assign(1, NONE);
+        ac.output_link.assign(1, NONE);
+        for (const uint32_t index : floating_) {
+            uint32_t state = 0;
+            for (const char c : patterns_[index].bytes) {
+                uint32_t& child = ac.next[state * width + ac.byte_class[static_cast<uint8_t>(c)]];
+                if (child == NONE) {
+                    child = static_cast<uint32_t>(ac.output.size());
+                    ac.next.resize(ac.next.size() + width, NONE);
+                    ac.output.push_back(NONE);
+                    ac.output_link.push_back(NONE);
+                }
+                state = ac.next[state * width + ac.byte_class[static_cast<uint8_t>(c)]];
+            }
+            ac.output[state] = std::min(ac.output[state], index);
+        }
+
+        // Breadth first, fill in failure transitions so every state has a
+        // move on every class
+        std::vector<uint32_t> fail(ac.output.size(), 0);
+        std::deque<uint32_t> queue;
+        for (size_t c = 0; c < width; ++c) {
+            uint32_t& child = ac.next[c];
+            if (child == NONE) {
+                child = 0;
+            } else {
+                queue.push_back(child);
+            }
+        }
+        while (!queue.empty()) {
+            const uint32_t state = queue.front();
+            queue.pop_front();
+            for (size_t c = 0; c < width; ++c) {
+                uint32_t& child = ac.next[state * width + c];
+                const uint32_t fallback = ac.next[fail[state] * width + c];
+                if (child == NONE) {
+                    child = fallback;
+                    continue;
+                }
+                fail[child] = fallback;
+                ac.output_link[child] = ac.output[fallback] != NONE ? fallback : ac.output_link[fallback];
+                queue.push_back(child);
+            }
+        }
+    }
+    engine_ = engine;
+}
+
+PatternMatcher::~PatternMatcher() = default;
+
+size_t PatternMatcher::find(std::span<const uint8_t> data, size_t from) const {
+    const size_t anchored = data.empty() ? NO_MATCH : findAnchored(data);
+
+    size_t start = NO_MATCH;
+    size_t floating = NO_MATCH;
+    if (!floating_.empty() && from < data.size()) {
+        switch (engine_) {
+            case Engine::TEDDY:
+                floating = teddy_->scan(*teddy_, patterns_, data.data(), data.size(), from, start);
+                break;
+            case Engine::AHO_CORASICK: {
+                const AhoCorasick& ac = *aho_corasick_;
+                uint32_t state = 0;
+                for (size_t position = from; position < data.size(); ++position) {
+                    // Nothing ending later can start before what was found
+                    if (floating != NO_MATCH && position >= start + ac.max_length) {
+                        break;
+                    }
+                    state = ac.next[state * ac.classes + ac.byte_class[data[position]]];
+                    for (uint32_t hit = ac.output[state] != NONE ? state : ac.output_link[state];
+                         hit != NONE; hit = ac.output_link[hit]) {
+                        const size_t index = ac.output[hit];
+                        const size_t begin = position + 1 - patterns_[index].bytes.size();
+                        if (begin < start || (begin == start && index < floating)) {
+                            start = begin;
+                            floating = index;
+                        }
+                    }
+                }
+                break;
+            }
+            case Engine::AUTO:
+            case Engine::MEMMEM:
+                floating = findMemmem(data, from, start);
+                break;
+        }
+    }
+
+    if (anchored != NO_MATCH && (floating == NO_MATCH || start > 0 || anchored < floating)) {
+        return anchored;
+    }
+    return floating;
+}
+
+size_t PatternMatcher::findAnchored(std::span<const uint8_t> data) const {
+    for (const uint32_t index : anchored_[data[0]]) {
+        const std::string& bytes = patterns_[index].bytes;
+        if (bytes.size() <= data.size() && std::memcmp(data.data(), bytes.data(), bytes.size()) == 0) {
+            return index;
+        }
+    }
+    return NO_MATCH;
+}
+
+size_t PatternMatcher::findMemmem(std::span<const uint8_t> data, size_t from, size_t& start) const {
+    size_t best = NO_MATCH;
+    for (const uint32_t index : floating_) {
+        const std::string& bytes = patterns_[index].bytes;
+        const void* found = ::memmem(data.data() + from, data.size() - from, bytes.data(), bytes.size());
+        if (found != nullptr) {
+            const size_t begin = static_cast<const uint8_t*>(found) - data.data();
+            if (begin < start) {
+                start = begin;
+                best = index;
+            }
+        }
+    }
+    return best;
+}
+
+const char* PatternMatcher::getEngine() const {
+    switch (engine_) {
+        case Engine::TEDDY:        return teddy_->name;
+        case Engine::AHO_CORASICK: return "aho-corasick";
+        case Engine::AUTO:
+        case Engine::MEMMEM:       break;
+    }
+    return "memmem";
+}
+
+PatternMatcher::Engine PatternMatcher::engineFromString(const std::string& name) {
+    if (name == "auto")         return Engine::AUTO;
+    if (name == "teddy")        return Engine::TEDDY;
+    if (name == "aho-corasick") return Engine::AHO_CORASICK;
+    if (name == "memmem")       return Engine::MEMMEM;
+    throw std::invalid_argument("Unknown signature engine '" + name +
+                                "' (expected auto, teddy, aho-corasick or memmem)");
+}
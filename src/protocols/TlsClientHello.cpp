@@ -0,0 +1,147 @@
+#include "protocols/TlsClientHello.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint8_t TLS_HANDSHAKE = 22;
+constexpr uint8_t CLIENT_HELLO = 1;
+constexpr uint16_t EXTENSION_SERVER_NAME = 0;
+constexpr uint16_t EXTENSION_ALPN = 16;
+constexpr uint8_t HOST_NAME = 0;
+
+// Reads big-endian fields off a span. A read past the end yields zeros
+// and clears ok, so a run of reads can be checked once at the end.
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) : data_(data) {}
+
+    uint8_t u8() {
+        return take(1) ? data_[position_ - 1] : 0;
+    }
+
+    uint16_t u16() {
+        return take(2) ? static_cast<uint16_t>(data_[position_ - 2] << 8 | data_[position_ - 1]) : 0;
+    }
+
+    uint32_t u24() {
+        return take(3)
+            ? static_cast<uint32_t>(data_[position_ - 3]) << 16 |
+              static_cast<uint32_t>(data_[position_ - 2]) << 8 | data_[position_ - 1]
+            : 0;
+    }
+
+    std::span<const uint8_t> bytes(size_t length) {
+        return take(length) ? data_.subspan(position_ - length, length) : std::span<const uint8_t>();
+    }
+
+    bool ok() const { return ok_; }
+    bool done() const { return position_ == data_.size(); }
+
+private:
+    bool take(size_t length) {
+        if (!ok_ || length > data_.size() - position_) {
+            ok_ = false;
+            return false;
+        }
+        position_ += length;
+        return true;
+    }
+
+    std::span<const uint8_t> data_;
+    size_t position_ = 0;
+    bool ok_ = true;
+};
+
+// Host names and protocol ids are shown and used as map keys, so anything
+// but printable ASCII is dropped
+std::string_view printable(std::span<const uint8_t> bytes) {
+    const bool clean = !bytes.empty() && std::all_of(bytes.begin(), bytes.end(),
+        [](uint8_t c) { return c > 0x20 && c < 0x7f; });
+    return clean ? std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size())
+                 : std::string_view();
+}
+
+std::string_view readServerName(Reader extension) {
+    Reader names(extension.bytes(extension.u16()));
+    while (names.ok() && !names.done()) {
+        const uint8_t type = names.u8();
+        const std::span<const uint8_t> name = names.bytes(names.u16());
+        if (names.ok() && type == HOST_NAME) {
+            return printable(name);
+        }
+    }
+    return {};
+}
+
+std::string_view readAlpn(Reader extension) {
+    Reader protocols(extension.bytes(extension.u16()));
+    const std::span<const uint8_t> first = protocols.bytes(protocols.u8());
+    return protocols.ok() ? printable(first) : std::string_view();
+}
+
+} // namespace
+
+TlsClientHello::Result TlsClientHello::parse(std::span<const uint8_t> data) {
+    server_name_ = {};
+    alpn_ = {};
+    record_length_ = 0;
+
+    // Reject on whatever of the record header has arrived: type, version
+    // 3.x and a handshake type of ClientHello
+    if ((data.size() > 0 && data[0] != TLS_HANDSHAKE) ||
+        (data.size() > 1 && data[1] != 3) ||
+        (data.size() > 5 && data[5] != CLIENT_HELLO)) {
+        return Result::INVALID;
+    }
+    if (data.size() < RECORD_HEADER_LENGTH) {
+        return Result::INCOMPLETE;
+    }
+    const size_t length = static_cast<size_t>(data[3] << 8 | data[4]);
+    if (length > MAX_RECORD_LENGTH) {
+        return Result::INVALID;
+    }
+    record_length_ = RECORD_HEADER_LENGTH + length;
+    if (data.size() < record_length_) {
+        return Result::INCOMPLETE;
+    }
+
+    Reader record(data.subspan(RECORD_HEADER_LENGTH, length));
+    record.u8();    // Handshake type, checked above
+    Reader hello(record.bytes(record.u24()));
+    if (!record.ok()) {
+        return Result::INVALID;     // Continues in another record
+    }
+
+    hello.u16();                            // legacy_version
+    hello.bytes(32);                        // random
+    hello.bytes(hello.u8());                // legacy_session_id
+    hello.bytes(hello.u16());               // cipher_suites
+    hello.bytes(hello.u8());                // legacy_compression_methods
+    if (!hello.ok()) {
+        return Result::INVALID;
+    }
+    if (hello.done()) {
+        return Result::COMPLETE;            // No extensions (SSL 3.0 style)
+    }
+
+    Reader extensions(hello.bytes(hello.u16()));
+    while (extensions.ok() && !extensions.done()) {
+        const uint16_t type = extensions.u16();
+        const Reader extension(extensions.bytes(extensions.u16()));
+        if (!extensions.ok()) {
+            break;
+        }
+        if (type == EXTENSION_SERVER_NAME && server_name_.empty()) {
+            server_name_ = readServerName(extension);
+        } else if (type == EXTENSION_ALPN && alpn_.empty()) {
+            alpn_ = readAlpn(extension);
+        }
+    }
+    if (!hello.ok() || !extensions.ok()) {
+        server_name_ = {};
+        alpn_ = {};
+        return Result::INVALID;
+    }
+    return Result::COMPLETE;
+}
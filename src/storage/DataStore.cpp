@@ -4,10 +4,12 @@
 #include <iomanip>
 #include <ctime>
 
-DataStore::DataStore(const std::string& db_path)
+DataStore::DataStore(const std::string& db_path, size_t ring_depth)
     : db_(nullptr)
     , db_path_(db_path)
-    , running_(false) {
+    , running_(false)
+    , packet_ring_(ring_depth)
+    , flow_ring_(FLOW_RING_DEPTH) {
     initializeDatabase();
     running_ = true;
     store_thread_ = std::thread(&DataStore::storeThread, this);
@@ -30,6 +32,7 @@ void DataStore::createTables() {
         CREATE TABLE IF NOT EXISTS packets (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             timestamp INTEGER NOT NULL,
+            interface TEXT,
             protocol TEXT NOT NULL,
             source_address TEXT NOT NULL,
             destination_address TEXT NOT NULL,
@@ -50,6 +53,26 @@ void DataStore::createTables() {
         CREATE INDEX IF NOT EXISTS idx_packets_protocol ON packets(protocol);
         CREATE INDEX IF NOT EXISTS idx_packets_source ON packets(source_address);
         CREATE INDEX IF NOT EXISTS idx_packets_destination ON packets(destination_address);
+
+        CREATE TABLE IF NOT EXISTS flows (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            start_time INTEGER NOT NULL,
+            end_time INTEGER NOT NULL,
+            protocol TEXT NOT NULL,
+            first_address TEXT NOT NULL,
+            first_port INTEGER NOT NULL,
+            second_address TEXT NOT NULL,
+            second_port INTEGER NOT NULL,
+            packets INTEGER NOT NULL,
+            bytes INTEGER NOT NULL,
+            retransmissions INTEGER NOT NULL,
+            out_of_order INTEGER NOT NULL,
+            zero_windows INTEGER NOT NULL,
+            rtt_us INTEGER,
+            interface TEXT
+        );
+
+        CREATE INDEX IF NOT EXISTS idx_flows_start_time ON flows(start_time);
     )";
 
     char* err_msg = nullptr;
@@ -59,27 +82,96 @@ void DataStore::createTables() {
         sqlite3_free(err_msg);
         throw std::runtime_error("Failed to create tables: " + error);
     }
+
+    // Databases created before multi-interface capture lack the column;
+    // the ALTER fails harmlessly when it already exists
+    sqlite3_exec(db_, "ALTER TABLE packets ADD COLUMN interface TEXT", nullptr, nullptr, nullptr);
+    // Likewise for flows tables from before TCP tracking. Old rows read as
+    // no reordering or zero windows, and as an unknown round trip.
+    sqlite3_exec(db_, "ALTER TABLE flows ADD COLUMN out_of_order INTEGER NOT NULL DEFAULT 0",
+                 nullptr, nullptr, nullptr);
+    sqlite3_exec(db_, "ALTER TABLE flows ADD COLUMN zero_windows INTEGER NOT NULL DEFAULT 0",
+                 nullptr, nullptr, nullptr);
+    sqlite3_exec(db_, "ALTER TABLE flows ADD COLUMN rtt_us INTEGER", nullptr, nullptr, nullptr);
+    rc = sqlite3_exec(db_, "CREATE INDEX IF NOT EXISTS idx_packets_interface ON packets(interface)",
+                      nullptr, nullptr, &err_msg);
+    if (rc != SQLITE_OK) {
+        std::string error = err_msg;
+        sqlite3_free(err_msg);
+        throw std::runtime_error("Failed to create tables: " + error);
+    }
+}
+
+bool DataStore::tryStore(Packet&& packet) {
+    return packet_ring_.tryPush(std::move(packet));
+}
+
+void DataStore::store(Packet&& packet) {
+    // Wait for room before pushing so that waiting isn't counted as an
+    // overflow; another producer can still win the race, hence the loop
+    do {
+        while (packet_ring_.size() >= packet_ring_.capacity()) {
+            std::this_thread::sleep_for(IDLE_WAIT);
+        }
+    } while (!packet_ring_.tryPush(std::move(packet)));
 }
 
 void DataStore::store(const Packet& packet) {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    packet_queue_.push(packet);
-    queue_cv_.notify_one();
+    store(Packet(packet));
+}
+
+bool DataStore::tryStoreFlow(FlowRecord&& flow) {
+    return flow_ring_.tryPush(std::move(flow));
+}
+
+void DataStore::storeFlow(FlowRecord&& flow) {
+    do {
+        while (flow_ring_.size() >= flow_ring_.capacity()) {
+            std::this_thread::sleep_for(IDLE_WAIT);
+        }
+    } while (!flow_ring_.tryPush(std::move(flow)));
+}
+
+size_t DataStore::getBacklog() const {
+    return packet_ring_.size();
+}
+
+size_t DataStore::getCapacity() const {
+    return packet_ring_.capacity();
+}
+
+uint64_t DataStore::getOverflows() const {
+    return packet_ring_.getOverflows();
 }
 
 void DataStore::flush() {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    batchInsert();
+    // Only the writer thread drains the ring; ask it to write what is
+    // queued now and wait until it has. Rows queued after this call don't
+    // hold it up, so producers that keep the ring full can't keep it
+    // waiting.
+    if (!running_) {
+        return;
+    }
+    const uint64_t ticket = flush_requested_.fetch_add(1) + 1;
+    while (flush_completed_.load() < ticket && running_) {
+        std::this_thread::sleep_for(IDLE_WAIT);
+    }
 }
 
 void DataStore::close() {
     if (running_) {
         running_ = false;
-        queue_cv_.notify_all();
         if (store_thread_.joinable()) {
-            store_thread_.join();
+            store_thread_.join();   // Writes out everything still queued
+        }
+        if (insert_stmt_) {
+            sqlite3_finalize(insert_stmt_);
+            insert_stmt_ = nullptr;
+        }
+        if (flow_insert_stmt_) {
+            sqlite3_finalize(flow_insert_stmt_);
+            flow_insert_stmt_ = nullptr;
         }
-        flush();
         if (db_) {
             sqlite3_close(db_);
             db_ = nullptr;
@@ -88,17 +180,71 @@ void DataStore::close() {
 }
 
 void DataStore::storeThread() {
-    while (running_) {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        queue_cv_.wait_for(lock, FLUSH_INTERVAL, [this] {
-            return !running_ || packet_queue_.size() >= BATCH_SIZE;
-        });
+    std::vector<Packet> batch;
+    batch.reserve(BATCH_SIZE);
+    std::vector<FlowRecord> flows;
+    flows.reserve(BATCH_SIZE);
+    auto last_write = std::chrono::steady_clock::now();
+    // A flush is done once everything queued when it was seen has been
+    // taken from the rings and written. The rings are FIFO, so that is
+    // when the count taken reaches the count taken then plus the backlog.
+    uint64_t taken = 0;
+    uint64_t flush_serving = 0;
+    uint64_t flush_target = 0;
+
+    for (;;) {
+        const bool stopping = !running_;
+        const uint64_t requested = flush_requested_.load();
+        if (requested != flush_serving) {
+            flush_serving = requested;
+            flush_target = taken + packet_ring_.size() + flow_ring_.size();
+        }
 
-        if (!running_ && packet_queue_.empty()) {
-            break;
+        while (batch.size() < BATCH_SIZE) {
+            auto packet = packet_ring_.tryPop();
+            if (!packet) {
+                break;
+            }
+            batch.push_back(std::move(*packet));
+            ++taken;
+        }
+        while (flows.size() < BATCH_SIZE) {
+            auto flow = flow_ring_.tryPop();
+            if (!flow) {
+                break;
+            }
+            flows.push_back(std::move(*flow));
+            ++taken;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool flushing = flush_completed_.load() != flush_serving;
+        const bool pending = !batch.empty() || !flows.empty();
+        const bool drained = packet_ring_.empty() && flow_ring_.empty();
+        if (batch.size() >= BATCH_SIZE || flows.size() >= BATCH_SIZE || stopping || flushing ||
+            (pending && now - last_write >= FLUSH_INTERVAL)) {
+            // Rows that fail are skipped inside batchInsert. A batch that
+            // fails as a whole is rolled back and lost, but the writer
+            // keeps going; letting the exception out would end the process.
+            const size_t rows = batch.size() + flows.size();
+            try {
+                batchInsert(batch, flows);
+            } catch (const std::exception& e) {
+                Logger::getInstance().log(LogLevel::ERROR,
+                    "Failed to store " + std::to_string(rows) + " rows: " + e.what());
+            }
+            last_write = now;
+            if (flushing && taken >= flush_target) {
+                flush_completed_ = flush_serving;
+            }
         }
 
-        batchInsert();
+        if (stopping && drained && batch.empty() && flows.empty()) {
+            break;
+        }
+        if (batch.empty() && flows.empty() && drained) {
+            std::this_thread::sleep_for(IDLE_WAIT);
+        }
     }
 }
 
@@ -108,23 +254,35 @@ void DataStore::insertPacket(const Packet& packet) {
             timestamp, protocol, source_address, destination_address,
             source_port, destination_port, length, is_fragmented,
             is_malformed, sequence_number, acknowledgment_number,
-            window_size, ttl, tos, payload
-        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+            window_size, ttl, tos, payload, interface
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
 
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db_)));
+    // Preparing allocates inside sqlite, so it is done once and the
+    // statement reset after every row
+    if (insert_stmt_ == nullptr) {
+        const int rc = sqlite3_prepare_v2(db_, sql, -1, &insert_stmt_, nullptr);
+        if (rc != SQLITE_OK) {
+            insert_stmt_ = nullptr;
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db_)));
+        }
     }
+    sqlite3_stmt* stmt = insert_stmt_;
 
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         packet.timestamp.time_since_epoch()).count();
 
+    // Bound as static, so the text must live until the row is stepped
+    const std::string protocol = protocolToString(packet.protocol);
     sqlite3_bind_int64(stmt, 1, timestamp);
-    sqlite3_bind_text(stmt, 2, protocolToString(packet.protocol).c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, packet.source_address.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 4, packet.destination_address.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, protocol.c_str(), -1, SQLITE_STATIC);
+    // Addresses travel in binary form and only become text here, on the
+    // writer thread, so the table stays readable and queryable as before
+    IpAddress::Text source_text, destination_text;
+    const std::string_view source = packet.source_address.format(source_text);
+    const std::string_view destination = packet.destination_address.format(destination_text);
+    sqlite3_bind_text(stmt, 3, source.data(), static_cast<int>(source.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, destination.data(), static_cast<int>(destination.size()), SQLITE_STATIC);
     sqlite3_bind_int(stmt, 5, packet.source_port);
     sqlite3_bind_int(stmt, 6, packet.destination_port);
     sqlite3_bind_int64(stmt, 7, packet.length);
@@ -136,37 +294,149 @@ void DataStore::insertPacket(const Packet& packet) {
     sqlite3_bind_int(stmt, 13, packet.ttl);
     sqlite3_bind_int(stmt, 14, packet.tos);
     
-    if (!packet.payload.empty()) {
-        sqlite3_bind_blob(stmt, 15, packet.payload.data(), packet.payload.size(), SQLITE_STATIC);
+    const auto payload = packet.getPayload();
+    if (!payload.empty()) {
+        sqlite3_bind_blob(stmt, 15, payload.data(), static_cast<int>(payload.size()), SQLITE_STATIC);
     } else {
         sqlite3_bind_null(stmt, 15);
     }
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    if (!packet.interface.empty()) {
+        sqlite3_bind_text(stmt, 16, packet.interface.c_str(), -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, 16);
+    }
+
+    const int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 
     if (rc != SQLITE_DONE) {
         throw std::runtime_error("Failed to insert packet: " + std::string(sqlite3_errmsg(db_)));
     }
 }
 
-void DataStore::batchInsert() {
-    if (packet_queue_.empty()) {
+void DataStore::insertFlow(const FlowRecord& flow) {
+    const char* sql = R"(
+        INSERT INTO flows (
+            start_time, end_time, protocol, first_address, first_port,
+            second_address, second_port, packets, bytes, retransmissions,
+            out_of_order, zero_windows, rtt_us, interface
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )";
+
+    if (flow_insert_stmt_ == nullptr) {
+        const int rc = sqlite3_prepare_v2(db_, sql, -1, &flow_insert_stmt_, nullptr);
+        if (rc != SQLITE_OK) {
+            flow_insert_stmt_ = nullptr;
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db_)));
+        }
+    }
+    sqlite3_stmt* stmt = flow_insert_stmt_;
+
+    const auto milliseconds = [](std::chrono::system_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    };
+    const std::string protocol = protocolToString(flow.connection.getTransport());
+    IpAddress::Text first_text, second_text;
+    const std::string_view first = flow.connection.getFirstAddress().format(first_text);
+    const std::string_view second = flow.connection.getSecondAddress().format(second_text);
+    // A flow seen on several SPAN ports lists them all
+    std::string interfaces;
+    for (const auto& interface : flow.interfaces) {
+        if (!interfaces.empty()) {
+            interfaces += ',';
+        }
+        interfaces += interface;
+    }
+
+    sqlite3_bind_int64(stmt, 1, milliseconds(flow.stats.start_time));
+    sqlite3_bind_int64(stmt, 2, milliseconds(flow.stats.last_seen));
+    sqlite3_bind_text(stmt, 3, protocol.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, first.data(), static_cast<int>(first.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, flow.connection.getFirstPort());
+    sqlite3_bind_text(stmt, 6, second.data(), static_cast<int>(second.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 7, flow.connection.getSecondPort());
+    sqlite3_bind_int64(stmt, 8, static_cast<sqlite3_int64>(flow.stats.packet_count));
+    sqlite3_bind_int64(stmt, 9, static_cast<sqlite3_int64>(flow.stats.byte_count));
+    const TcpAnalyzer::Counters tcp = flow.stats.tcp.getCounters();
+    sqlite3_bind_int64(stmt, 10, static_cast<sqlite3_int64>(tcp.retransmissions));
+    sqlite3_bind_int64(stmt, 11, static_cast<sqlite3_int64>(tcp.out_of_order));
+    sqlite3_bind_int64(stmt, 12, static_cast<sqlite3_int64>(tcp.zero_windows));
+    // Left empty when the handshake wasn't seen
+    const std::chrono::microseconds rtt = flow.stats.tcp.getHandshakeRtt();
+    if (rtt.count() > 0) {
+        sqlite3_bind_int64(stmt, 13, rtt.count());
+    } else {
+        sqlite3_bind_null(stmt, 13);
+    }
+    if (!interfaces.empty()) {
+        sqlite3_bind_text(stmt, 14, interfaces.c_str(), -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, 14);
+    }
+
+    const int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if (rc != SQLITE_DONE) {
+        throw std::runtime_error("Failed to insert flow: " + std::string(sqlite3_errmsg(db_)));
+    }
+}
+
+void DataStore::batchInsert(std::vector<Packet>& batch, std::vector<FlowRecord>& flows) {
+    if (batch.empty() && flows.empty()) {
         return;
     }
 
     sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
 
+    // A row that fails, such as one a constraint rejects, is skipped and
+    // the rest of the batch committed. Errors that end the transaction
+    // (disk full, I/O) make SQLite roll it back itself, and then the batch
+    // is lost as a whole.
+    size_t skipped = 0;
+    std::string first_error;
+    const auto insert = [&](const auto& row, auto method) {
+        try {
+            (this->*method)(row);
+        } catch (const std::exception& e) {
+            if (skipped++ == 0) {
+                first_error = e.what();
+            }
+            if (sqlite3_get_autocommit(db_)) {
+                throw;
+            }
+        }
+    };
+
     try {
-        while (!packet_queue_.empty()) {
-            insertPacket(packet_queue_.front());
-            packet_queue_.pop();
+        for (const auto& packet : batch) {
+            insert(packet, &DataStore::insertPacket);
+        }
+        for (const auto& flow : flows) {
+            insert(flow, &DataStore::insertFlow);
         }
-        sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
-    } catch (const std::exception& e) {
-        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        if (sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            throw std::runtime_error("Failed to commit: " + std::string(sqlite3_errmsg(db_)));
+        }
+    } catch (const std::exception&) {
+        if (!sqlite3_get_autocommit(db_)) {
+            sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        }
+        batch.clear();
+        flows.clear();
         throw;
     }
+
+    if (skipped > 0) {
+        Logger::getInstance().log(LogLevel::WARNING,
+            "Skipped " + std::to_string(skipped) + " of " + std::to_string(batch.size() + flows.size()) +
+            " rows: " + first_error);
+    }
+    batch.clear();
+    flows.clear();
 }
 
 std::string DataStore::protocolToString(Packet::Protocol protocol) const {
@@ -180,6 +450,7 @@ std::string DataStore::protocolToString(Packet::Protocol protocol) const {
         case Packet::Protocol::ICMP: return "ICMP";
         case Packet::Protocol::HTTP: return "HTTP";
         case Packet::Protocol::HTTPS: return "HTTPS";
+        case Packet::Protocol::TLS: return "TLS";
         case Packet::Protocol::DNS: return "DNS";
         case Packet::Protocol::DHCP: return "DHCP";
         case Packet::Protocol::ARP: return "ARP";
@@ -196,6 +467,7 @@ Packet::Protocol DataStore::stringToProtocol(const std::string& str) const {
     if (str == "ICMP") return Packet::Protocol::ICMP;
     if (str == "HTTP") return Packet::Protocol::HTTP;
     if (str == "HTTPS") return Packet::Protocol::HTTPS;
+    if (str == "TLS") return Packet::Protocol::TLS;
     if (str == "DNS") return Packet::Protocol::DNS;
     if (str == "DHCP") return Packet::Protocol::DHCP;
     if (str == "ARP") return Packet::Protocol::ARP;
@@ -0,0 +1,180 @@
+// DnsMessage against crafted messages: truncated at every length, names at
+// and past the length limits, and compression pointers that point forward,
+// at themselves, or off the end.
+
+#include "TestSupport.hpp"
+#include "protocols/DnsMessage.hpp"
+
+namespace {
+
+// Wire form of a dotted name, ending in the root label
+Bytes wireName(const std::string& name) {
+    Bytes result;
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t dot = name.find('.', start);
+        if (dot == std::string::npos) {
+            dot = name.size();
+        }
+        result.push_back(static_cast<uint8_t>(dot - start));
+        result.insert(result.end(), name.begin() + start, name.begin() + dot);
+        start = dot + 1;
+    }
+    result.push_back(0);
+    return result;
+}
+
+Bytes header(uint16_t id, uint16_t flags, uint16_t questions, uint16_t answers = 0) {
+    Bytes result(DnsMessage::HEADER_LENGTH);
+    putU16(result.data(), id);
+    putU16(result.data() + 2, flags);
+    putU16(result.data() + 4, questions);
+    putU16(result.data() + 6, answers);
+    return result;
+}
+
+// Header and one question holding name as given, so tests can pass a
+// malformed one
+Bytes message(const Bytes& name, uint16_t type = 1, uint16_t flags = 0x0100) {
+    Bytes result = header(0x1234, flags, 1);
+    result.insert(result.end(), name.begin(), name.end());
+    result.resize(result.size() + 4);
+    putU16(result.data() + result.size() - 4, type);
+    putU16(result.data() + result.size() - 2, 1);
+    return result;
+}
+
+std::string repeat(char c, size_t count) {
+    return std::string(count, c);
+}
+
+void testQuery() {
+    DnsMessage dns;
+    CHECK(dns.parse(message(wireName("www.example.com"), 28)));
+    CHECK(dns.getId() == 0x1234);
+    CHECK(!dns.isResponse());
+    CHECK(dns.getQuestionCount() == 1);
+    CHECK(dns.getName() == "www.example.com");
+    CHECK(dns.getType() == 28);
+    CHECK(dns.getClass() == 1);
+}
+
+void testResponse() {
+    DnsMessage dns;
+    CHECK(dns.parse(message(wireName("missing.example"), 1, 0x8183)));
+    CHECK(dns.isResponse());
+    CHECK(dns.getRcode() == DnsMessage::NXDOMAIN);
+    CHECK(DnsMessage::getRcodeString(dns.getRcode()) == "NXDOMAIN");
+    CHECK(DnsMessage::getRcodeString(12) == "RCODE12");
+}
+
+void testNoQuestion() {
+    DnsMessage dns;
+    CHECK(dns.parse(header(7, 0x8180, 0)));
+    CHECK(dns.getId() == 7);
+    CHECK(dns.getName().empty());
+
+    // The root itself
+    CHECK(dns.parse(message(wireName(""), 2)));
+    CHECK(dns.getName().empty());
+    CHECK(dns.getType() == 2);
+}
+
+void testTruncated() {
+    const Bytes full = message(wireName("www.example.com"));
+    for (size_t length = 0; length < full.size(); ++length) {
+        DnsMessage dns;
+        CHECK(!dns.parse(std::span(full.data(), length)));
+    }
+}
+
+void testLengthLimits() {
+    DnsMessage dns;
+    const std::string longest_label = repeat('a', DnsMessage::MAX_LABEL_LENGTH);
+    CHECK(dns.parse(message(wireName(longest_label + ".com"))));
+    CHECK(dns.getName().size() == DnsMessage::MAX_LABEL_LENGTH + 4);
+
+    // 64 has the top bits 01, an extended label type
+    Bytes name = wireName(longest_label + "a.com");
+    CHECK(!dns.parse(message(name)));
+
+    // 253 characters of dotted text is the most a 255-byte wire name holds
+    const std::string longest = longest_label + "." + longest_label + "." + longest_label + "." +
+                                repeat('b', 61);
+    CHECK(longest.size() == DnsMessage::MAX_NAME_LENGTH);
+    CHECK(dns.parse(message(wireName(longest))));
+    CHECK(dns.getName() == longest);
+    CHECK(!dns.parse(message(wireName(longest + "b"))));
+    CHECK(!dns.parse(message(wireName(longest + ".b"))));
+
+    // A label running past the end of the message
+    CHECK(!dns.parse(Bytes{0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 10, 'a', 'b'}));
+    // No root label before the end
+    name = wireName("example.com");
+    name.pop_back();
+    Bytes unterminated = header(1, 0, 1);
+    unterminated.insert(unterminated.end(), name.begin(), name.end());
+    CHECK(!dns.parse(unterminated));
+}
+
+void testCompression() {
+    // A response whose answer names the question by pointer, and a second
+    // name sharing its suffix
+    Bytes response = message(wireName("www.example.com"), 1, 0x8180);
+    const size_t answer = response.size();
+    response.insert(response.end(), {0xc0, 12});
+    const size_t mail = response.size();
+    response.insert(response.end(), {4, 'm', 'a', 'i', 'l', 0xc0, 16});
+
+    char name[DnsMessage::MAX_NAME_LENGTH];
+    size_t length = 0;
+    CHECK(DnsMessage::readName(response, answer, name, length) == answer + 2);
+    CHECK(std::string(name, length) == "www.example.com");
+    CHECK(DnsMessage::readName(response, mail, name, length) == mail + 7);
+    CHECK(std::string(name, length) == "mail.example.com");
+
+    // A pointer to a pointer
+    response.insert(response.end(), {0xc0, static_cast<uint8_t>(answer)});
+    CHECK(DnsMessage::readName(response, response.size() - 2, name, length) == response.size());
+    CHECK(std::string(name, length) == "www.example.com");
+}
+
+void testBadPointers() {
+    DnsMessage dns;
+    // At itself
+    CHECK(!dns.parse(message(Bytes{0xc0, 12})));
+    // Forward, past the question
+    CHECK(!dns.parse(message(Bytes{3, 'w', 'w', 'w', 0xc0, 20, 0})));
+    // Back into the labels it was reached from, which would loop
+    Bytes response = message(wireName("a.example"), 1, 0x8180);
+    const size_t answer = response.size();
+    response.insert(response.end(), {1, 'b', 0xc0, static_cast<uint8_t>(answer)});
+    char name[DnsMessage::MAX_NAME_LENGTH];
+    size_t length = 0;
+    CHECK(DnsMessage::readName(response, answer, name, length) == 0);
+    // Cut off after its first byte
+    Bytes cut = header(1, 0, 1);
+    cut.push_back(0xc0);
+    CHECK(!dns.parse(cut));
+    // Expanding past the length limit through pointers to a long name
+    const std::string long_name = repeat('a', 63) + "." + repeat('a', 63) + "." + repeat('a', 63);
+    Bytes expanded = message(wireName(long_name));
+    const size_t second = expanded.size();
+    expanded.insert(expanded.end(), {63});
+    expanded.insert(expanded.end(), 63, 'c');
+    expanded.insert(expanded.end(), {0xc0, 12});
+    CHECK(DnsMessage::readName(expanded, second, name, length) == 0);
+}
+
+} // namespace
+
+int main() {
+    testQuery();
+    testResponse();
+    testNoQuestion();
+    testTruncated();
+    testLengthLimits();
+    testCompression();
+    testBadPointers();
+    return testResult("DnsMessage");
+}
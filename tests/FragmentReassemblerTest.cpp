@@ -0,0 +1,262 @@
+// FragmentReassembler against crafted IPv4 fragments: out of order,
+// duplicated, overlapping, truncated by the capture, left incomplete until
+// they time out, and more datagrams than the table holds.
+
+#include "TestSupport.hpp"
+#include "core/FragmentReassembler.hpp"
+
+namespace {
+
+using std::chrono::seconds;
+using Reassembly = PacketView::Reassembly;
+
+const uint32_t SOURCE = hostAddress(1);
+const uint32_t DESTINATION = hostAddress(2);
+constexpr uint8_t UDP = 17;
+constexpr size_t FRAGMENT = 1480;
+
+// What came out of the handler
+struct Output {
+    int complete = 0;
+    int incomplete = 0;
+    uint32_t weight = 0;
+    Bytes frame;            // Last datagram handed on
+    bool fragmented = false;
+    bool malformed = false;
+    uint16_t destination_port = 0;
+
+    FragmentReassembler::Handler handler() {
+        return [this](const PacketView& datagram, uint32_t datagram_weight) {
+            (datagram.reassembly == Reassembly::COMPLETE ? complete : incomplete)++;
+            weight = datagram_weight;
+            frame.assign(datagram.data, datagram.data + datagram.captured_length);
+            fragmented = datagram.isFragmented();
+            malformed = datagram.isMalformed();
+            destination_port = datagram.getDestinationPort();
+        };
+    }
+};
+
+// A UDP datagram of 3008 bytes, to be cut into three fragments
+Bytes datagram() {
+    Bytes payload(3000);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>(i * 13);
+    }
+    return udpSegment(40000, 53, payload);
+}
+
+// The piece of data from offset, length bytes long or to the end
+Bytes fragment(const Bytes& data, uint16_t id, size_t offset, size_t length = SIZE_MAX) {
+    const size_t end = std::min(data.size(), offset + std::min(length, data.size()));
+    const Bytes piece(data.begin() + offset, data.begin() + end);
+    return ipv4Frame(SOURCE, DESTINATION, UDP, piece, id, offset, end < data.size());
+}
+
+void add(FragmentReassembler& reassembler, const Bytes& frame, Output& output,
+         seconds time = seconds(1), uint32_t weight = 1) {
+    reassembler.add(viewOf(frame, at(time)), weight, output.handler());
+}
+
+// The datagram as one unfragmented frame
+bool isWhole(const Output& output, const Bytes& data) {
+    return output.frame.size() == ETHERNET_LENGTH + IPV4_LENGTH + data.size() &&
+           std::equal(data.begin(), data.end(), output.frame.begin() + ETHERNET_LENGTH + IPV4_LENGTH);
+}
+
+void testInOrder() {
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, fragment(data, 7, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 7, FRAGMENT, FRAGMENT), output);
+    CHECK(output.complete == 0);
+    add(reassembler, fragment(data, 7, 2 * FRAGMENT), output);
+    CHECK(output.complete == 1);
+    CHECK(isWhole(output, data));
+    CHECK(output.fragmented);
+    CHECK(!output.malformed);
+    CHECK(output.destination_port == 53);
+
+    const FragmentReassembler::Stats stats = reassembler.getStats();
+    CHECK(stats.fragments == 3);
+    CHECK(stats.reassembled == 1);
+    CHECK(stats.pending == 0);
+    CHECK(stats.memory_used == 0);
+}
+
+void testOutOfOrder() {
+    // Last fragment first, then the middle one, then the first
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, fragment(data, 7, 2 * FRAGMENT), output, seconds(1), 3);
+    add(reassembler, fragment(data, 7, FRAGMENT, FRAGMENT), output);
+    add(reassembler, fragment(data, 7, 0, FRAGMENT), output);
+    CHECK(output.complete == 1);
+    CHECK(isWhole(output, data));
+    // The first fragment to arrive set the weight
+    CHECK(output.weight == 3);
+    CHECK(output.destination_port == 53);
+}
+
+void testDuplicate() {
+    // A fragment seen twice is harmless
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, fragment(data, 9, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 9, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 9, FRAGMENT), output);
+    CHECK(output.complete == 1);
+    CHECK(isWhole(output, data));
+    CHECK(reassembler.getStats().invalid == 0);
+}
+
+void testOverlap() {
+    // RFC 5722: overlapping fragments are dropped, not merged
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, fragment(data, 8, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 8, 1000, FRAGMENT), output);
+    CHECK(output.complete == 0);
+    CHECK(output.incomplete == 1);
+    CHECK(output.malformed);
+    CHECK(reassembler.getStats().invalid == 1);
+    CHECK(reassembler.getStats().pending == 0);
+
+    // Adjacent fragments are held as one run, so one that falls inside
+    // what is held can't be told from a resend and is ignored: the first
+    // copy of the bytes wins
+    Bytes changed = data;
+    changed[100] ^= 0xff;
+    add(reassembler, fragment(data, 10, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 10, FRAGMENT, FRAGMENT), output);
+    add(reassembler, fragment(changed, 10, 8, 2 * FRAGMENT - 16), output);
+    add(reassembler, fragment(data, 10, 2 * FRAGMENT), output);
+    CHECK(output.complete == 1);
+    CHECK(isWhole(output, data));
+    CHECK(reassembler.getStats().invalid == 1);
+}
+
+void testConflictingEnd() {
+    // Two last fragments that disagree on where the datagram ends
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, fragment(data, 11, FRAGMENT), output);
+    Bytes shorter(data.begin(), data.end() - 8);
+    add(reassembler, fragment(shorter, 11, 2 * FRAGMENT), output);
+    add(reassembler, fragment(data, 11, 0, FRAGMENT), output);
+    CHECK(output.complete == 0);
+    CHECK(reassembler.getStats().invalid == 1);
+}
+
+void testSeparateDatagrams() {
+    // Interleaved fragments of two datagrams told apart by id
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, fragment(data, 1, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 2, FRAGMENT), output);
+    add(reassembler, fragment(data, 2, 0, FRAGMENT), output);
+    CHECK(output.complete == 1);
+    add(reassembler, fragment(data, 1, FRAGMENT), output);
+    CHECK(output.complete == 2);
+    CHECK(isWhole(output, data));
+}
+
+void testTruncatedCapture() {
+    // A fragment the capture cut short can't be stored and goes on alone
+    const Bytes data = datagram();
+    FragmentReassembler reassembler;
+    Output output;
+    const Bytes frame = fragment(data, 12, 0, FRAGMENT);
+    reassembler.add(PacketView(frame.data(), 200, frame.size(), at(seconds(1))), 1, output.handler());
+    CHECK(reassembler.getStats().passed == 1);
+    CHECK(reassembler.getStats().pending == 0);
+}
+
+void testTimeout() {
+    const Bytes data = datagram();
+    FragmentReassembler reassembler({16, 1024 * 1024, seconds(30)});
+    Output output;
+    add(reassembler, fragment(data, 13, 0, FRAGMENT), output, seconds(1));
+    reassembler.expire(at(seconds(30)), output.handler());
+    CHECK(output.incomplete == 0);
+    reassembler.expire(at(seconds(32)), output.handler());
+    CHECK(output.incomplete == 1);
+    CHECK(output.malformed);
+    CHECK(reassembler.getStats().timed_out == 1);
+
+    // The rest arriving late starts a datagram of its own
+    add(reassembler, fragment(data, 13, FRAGMENT), output, seconds(33));
+    CHECK(output.complete == 0);
+    CHECK(reassembler.getStats().pending == 1);
+    reassembler.flush(output.handler());
+    CHECK(output.incomplete == 2);
+    CHECK(reassembler.getStats().pending == 0);
+    CHECK(reassembler.getStats().memory_used == 0);
+}
+
+void testTableFull() {
+    // More half datagrams than slots: the oldest are pushed out, and a
+    // whole datagram still gets through
+    const Bytes data = datagram();
+    FragmentReassembler reassembler({4, 1024 * 1024, seconds(30)});
+    Output output;
+    for (uint16_t id = 100; id < 110; ++id) {
+        add(reassembler, fragment(data, id, FRAGMENT, FRAGMENT), output);
+    }
+    CHECK(output.incomplete == 6);
+    CHECK(reassembler.getStats().evicted == 6);
+    CHECK(reassembler.getStats().pending == 4);
+
+    add(reassembler, fragment(data, 7, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 7, FRAGMENT, FRAGMENT), output);
+    add(reassembler, fragment(data, 7, 2 * FRAGMENT), output);
+    CHECK(output.complete == 1);
+    CHECK(isWhole(output, data));
+}
+
+void testMemoryFull() {
+    // Arena for two blocks: the second datagram's data pushes out the first
+    const Bytes data = datagram();
+    FragmentReassembler reassembler({16, 2 * FragmentReassembler::BLOCK_SIZE, seconds(30)});
+    Output output;
+    add(reassembler, fragment(data, 1, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 2, 0, FRAGMENT), output);
+    add(reassembler, fragment(data, 2, FRAGMENT, FRAGMENT), output);
+    CHECK(output.incomplete >= 1);
+    CHECK(reassembler.getStats().evicted >= 1);
+    CHECK(reassembler.getStats().memory_used <= reassembler.getStats().memory_capacity);
+}
+
+void testOversized() {
+    // Data claimed to end past 64 KB
+    Bytes piece(FRAGMENT, 0);
+    const Bytes frame = ipv4Frame(SOURCE, DESTINATION, UDP, piece, 14, 65528 - 8 * 2, true);
+    FragmentReassembler reassembler;
+    Output output;
+    add(reassembler, frame, output);
+    CHECK(reassembler.getStats().invalid == 1);
+    CHECK(reassembler.getStats().pending == 0);
+}
+
+} // namespace
+
+int main() {
+    testInOrder();
+    testOutOfOrder();
+    testDuplicate();
+    testOverlap();
+    testConflictingEnd();
+    testSeparateDatagrams();
+    testTruncatedCapture();
+    testTimeout();
+    testTableFull();
+    testMemoryFull();
+    testOversized();
+    return testResult("FragmentReassembler");
+}
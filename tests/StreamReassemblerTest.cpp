@@ -0,0 +1,349 @@
+// StreamReassembler against crafted TCP segments: split, reordered,
+// overlapping and resent, cut short by the capture, past the cutoff, with
+// more gaps than a stream can hold, and across the sequence number wrap.
+// An analyzer records the byte stream each direction was handed as.
+
+#include <memory>
+#include "TestSupport.hpp"
+#include "core/StreamReassembler.hpp"
+
+namespace {
+
+using std::chrono::seconds;
+
+const uint32_t CLIENT = hostAddress(1);
+const uint32_t SERVER = hostAddress(2);
+constexpr uint16_t CLIENT_PORT = 40000;
+constexpr uint16_t SERVER_PORT = 8080;
+constexpr uint32_t CLIENT_ISN = 100;
+constexpr uint32_t SERVER_ISN = 900;
+constexpr uint8_t DATA = PacketView::TCP_ACK | PacketView::TCP_PSH;
+
+const std::string REQUEST = "GET /index.html HTTP/1.1\r\nHost: example.com\r\n\r\n";
+
+// What the analyzer was handed, per direction
+struct Record {
+    std::string streams[2];
+    int calls[2] = {0, 0};
+    bool consistent = true;     // Each call extended the last by fresh bytes
+    size_t want = SIZE_MAX;     // Bytes after which the analyzer is done
+};
+
+class Recorder : public StreamAnalyzer {
+public:
+    explicit Recorder(std::shared_ptr<Record> record) : record_(std::move(record)) {}
+
+    Verdict onData(TcpFlow&, StreamDirection direction, std::span<const uint8_t> stream,
+                   size_t fresh) override {
+        const size_t side = static_cast<size_t>(direction);
+        std::string& seen = record_->streams[side];
+        if (fresh == 0 || stream.size() != seen.size() + fresh ||
+            !std::equal(seen.begin(), seen.end(), stream.begin())) {
+            record_->consistent = false;
+        }
+        seen.assign(stream.begin(), stream.end());
+        ++record_->calls[side];
+        return seen.size() >= record_->want ? Verdict::DONE : Verdict::MORE;
+    }
+
+private:
+    std::shared_ptr<Record> record_;
+};
+
+// A reassembler with a Recorder, fed by the client and server of one
+// connection
+class Connection {
+public:
+    explicit Connection(StreamReassemblerConfig config = {64, 1024, 64 * 1024, seconds(120)},
+                        size_t want = SIZE_MAX)
+        : record(std::make_shared<Record>())
+        , reassembler(config, analyzers(record)) {
+        record->want = want;
+    }
+
+    const TcpFlow* client(uint32_t sequence, uint8_t flags, const std::string& payload = {},
+                          seconds time = seconds(1)) {
+        const Bytes frame = tcpFrame(CLIENT, CLIENT_PORT, SERVER, SERVER_PORT, sequence, 0, flags,
+                                     bytesOf(payload));
+        return reassembler.add(viewOf(frame, at(time)));
+    }
+
+    const TcpFlow* server(uint32_t sequence, uint8_t flags, const std::string& payload = {},
+                          seconds time = seconds(1)) {
+        const Bytes frame = tcpFrame(SERVER, SERVER_PORT, CLIENT, CLIENT_PORT, sequence, 0, flags,
+                                     bytesOf(payload));
+        return reassembler.add(viewOf(frame, at(time)));
+    }
+
+    // Client data at offset into its stream, after a handshake from isn
+    const TcpFlow* send(size_t offset, size_t length, uint32_t isn = CLIENT_ISN) {
+        return client(isn + 1 + static_cast<uint32_t>(offset), DATA, REQUEST.substr(offset, length));
+    }
+
+    void handshake(uint32_t isn = CLIENT_ISN) {
+        client(isn, PacketView::TCP_SYN);
+        server(SERVER_ISN, PacketView::TCP_SYN | PacketView::TCP_ACK);
+    }
+
+    const std::string& sent() const { return record->streams[0]; }
+    const std::string& received() const { return record->streams[1]; }
+
+    std::shared_ptr<Record> record;
+    StreamReassembler reassembler;
+
+private:
+    static std::vector<std::unique_ptr<StreamAnalyzer>> analyzers(const std::shared_ptr<Record>& record) {
+        std::vector<std::unique_ptr<StreamAnalyzer>> result;
+        result.push_back(std::make_unique<Recorder>(record));
+        return result;
+    }
+};
+
+void testInOrder() {
+    Connection connection;
+    connection.handshake();
+    const TcpFlow* flow = connection.send(0, 2);
+    CHECK(flow != nullptr && !flow->midstream);
+    CHECK(flow != nullptr && flow->client_port == CLIENT_PORT && flow->server_port == SERVER_PORT);
+    connection.send(2, 20);
+    connection.send(22, std::string::npos);
+    connection.server(SERVER_ISN + 1, DATA, "HTTP/1.1 200 OK\r\n");
+    CHECK(connection.sent() == REQUEST);
+    CHECK(connection.received() == "HTTP/1.1 200 OK\r\n");
+    CHECK(connection.record->calls[0] == 3);
+    CHECK(connection.record->consistent);
+    CHECK(connection.reassembler.getStats().delivered == REQUEST.size() + 17);
+    CHECK(connection.reassembler.getStats().out_of_order == 0);
+}
+
+void testOutOfOrder() {
+    // Tail, middle, then head: nothing is handed on until the head arrives
+    Connection connection;
+    connection.handshake();
+    connection.send(10, std::string::npos);
+    connection.send(4, 6);
+    CHECK(connection.record->calls[0] == 0);
+    connection.send(0, 4);
+    CHECK(connection.sent() == REQUEST);
+    CHECK(connection.record->calls[0] == 1);
+    CHECK(connection.record->consistent);
+    CHECK(connection.reassembler.getStats().out_of_order == 2);
+    // The analyzer still wants more, so the stream keeps its buffer
+    CHECK(connection.reassembler.getStats().memory_used == 1024);
+}
+
+void testGapFilledFromEitherSide() {
+    // Runs held apart join up as the gaps between them fill
+    Connection connection;
+    connection.handshake();
+    connection.send(0, 5);
+    connection.send(30, 5);
+    connection.send(20, 5);
+    connection.send(10, 5);
+    connection.send(25, 5);     // Joins two held runs
+    CHECK(connection.sent() == REQUEST.substr(0, 5));
+    connection.send(15, 5);     // Joins the front to the held runs, still short of 5..10
+    CHECK(connection.sent() == REQUEST.substr(0, 5));
+    connection.send(5, 5);
+    CHECK(connection.sent() == REQUEST.substr(0, 35));
+    connection.send(35, std::string::npos);
+    CHECK(connection.sent() == REQUEST);
+    CHECK(connection.record->consistent);
+}
+
+void testOverlap() {
+    Connection connection;
+    connection.handshake();
+    connection.send(0, 10);
+    // Resent bytes carrying new ones after them: only the new are handed on
+    connection.send(5, 15);
+    CHECK(connection.sent() == REQUEST.substr(0, 20));
+    // Bytes already handed on, sent again differently, change nothing
+    connection.client(CLIENT_ISN + 1, DATA, "XXXXXXXXXX");
+    CHECK(connection.sent() == REQUEST.substr(0, 20));
+    CHECK(connection.record->calls[0] == 2);
+    // A held run overlapped by the segment that fills the gap before it
+    connection.send(30, 10);
+    connection.send(20, 15);
+    CHECK(connection.sent() == REQUEST.substr(0, 40));
+    CHECK(connection.record->consistent);
+}
+
+void testBeforeStart() {
+    // Data from before the SYN, e.g. a stale segment, is not part of the stream
+    Connection connection;
+    connection.handshake();
+    connection.client(CLIENT_ISN - 10, DATA, "0123456789");
+    CHECK(connection.record->calls[0] == 0);
+    connection.send(0, std::string::npos);
+    CHECK(connection.sent() == REQUEST);
+}
+
+void testSequenceWrap() {
+    const uint32_t isn = 0xfffffff0u;
+    Connection connection;
+    connection.handshake(isn);
+    connection.send(0, 10, isn);
+    connection.send(20, std::string::npos, isn);
+    connection.send(10, 10, isn);   // Crosses 2^32
+    CHECK(connection.sent() == REQUEST);
+}
+
+void testTruncatedCapture() {
+    // A segment cut short: what was captured is handed on, then the
+    // direction is given up on
+    Connection connection;
+    connection.handshake();
+    const Bytes frame = tcpFrame(CLIENT, CLIENT_PORT, SERVER, SERVER_PORT, CLIENT_ISN + 1, 0, DATA,
+                                 bytesOf(REQUEST));
+    const size_t headers = ETHERNET_LENGTH + IPV4_LENGTH + 20;
+    connection.reassembler.add(PacketView(frame.data(), headers + 8, frame.size(), at(seconds(1))));
+    CHECK(connection.sent() == REQUEST.substr(0, 8));
+    CHECK(connection.reassembler.getStats().truncated == 1);
+    connection.client(CLIENT_ISN + 1 + 8, DATA, REQUEST.substr(8));
+    CHECK(connection.sent() == REQUEST.substr(0, 8));
+
+    // Cut off inside the TCP header
+    Connection headerless;
+    headerless.handshake();
+    headerless.reassembler.add(PacketView(frame.data(), headers - 4, frame.size(), at(seconds(1))));
+    CHECK(headerless.record->calls[0] == 0);
+}
+
+void testCutoff() {
+    // Only the first cutoff bytes are reassembled, and that isn't truncation
+    Connection connection({64, 16, 64 * 1024, seconds(120)});
+    connection.handshake();
+    connection.send(0, 10);
+    connection.send(10, std::string::npos);
+    CHECK(connection.sent() == REQUEST.substr(0, 16));
+    // Out of order past the cutoff
+    Connection reordered({64, 16, 64 * 1024, seconds(120)});
+    reordered.handshake();
+    reordered.send(20, std::string::npos);
+    reordered.send(0, 20);
+    CHECK(reordered.sent() == REQUEST.substr(0, 16));
+    CHECK(connection.reassembler.getStats().truncated == 0);
+    CHECK(reordered.reassembler.getStats().truncated == 0);
+    CHECK(reordered.reassembler.getStats().memory_used == 0);
+}
+
+void testTooManyGaps() {
+    // One more held run than a stream has room for
+    Connection connection;
+    connection.handshake();
+    for (size_t i = 0; i <= StreamReassembler::MAX_RANGES; ++i) {
+        connection.send(2 + i * 4, 2);
+    }
+    connection.send(0, 2);
+    CHECK(connection.record->calls[0] == 0);
+    CHECK(connection.reassembler.getStats().truncated == 1);
+    CHECK(connection.reassembler.getStats().memory_used == 0);
+}
+
+void testAnalyzerDone() {
+    // Once the analyzer has enough, nothing more is held for it
+    Connection connection({64, 1024, 64 * 1024, seconds(120)}, 4);
+    connection.handshake();
+    connection.send(0, 2);
+    connection.send(2, 2);
+    connection.send(10, 10);
+    connection.send(4, 6);
+    CHECK(connection.sent() == REQUEST.substr(0, 4));
+    CHECK(connection.record->calls[0] == 2);
+    CHECK(connection.reassembler.getStats().out_of_order == 0);
+    CHECK(connection.reassembler.getStats().memory_used == 0);
+}
+
+void testOutOfBuffers() {
+    // Room for one stream buffer: the second stream needing one takes it
+    // from the first, which is given up on
+    StreamReassemblerConfig config{64, 1024, 1024, seconds(120)};
+    Connection connection(config);
+    const Bytes first = tcpFrame(CLIENT, CLIENT_PORT, SERVER, SERVER_PORT, 1, 0, DATA, bytesOf("GE"));
+    const Bytes second = tcpFrame(CLIENT, CLIENT_PORT + 1, SERVER, SERVER_PORT, 1, 0, DATA, bytesOf("PO"));
+    connection.reassembler.add(viewOf(first, at(seconds(1))));
+    CHECK(connection.reassembler.getStats().memory_used == 1024);
+    connection.reassembler.add(viewOf(second, at(seconds(2))));
+    CHECK(connection.reassembler.getStats().memory_used == 1024);
+    CHECK(connection.reassembler.getStats().truncated == 1);
+}
+
+void testMidstream() {
+    // No handshake: the first payload starts the stream, and the side
+    // sending from the higher port is guessed to be the client
+    Connection connection;
+    const TcpFlow* flow = connection.server(SERVER_ISN + 1, DATA, "HTTP/1.1 200 OK\r\n");
+    CHECK(flow != nullptr && flow->midstream);
+    CHECK(flow != nullptr && flow->client_port == CLIENT_PORT);
+    CHECK(connection.received() == "HTTP/1.1 200 OK\r\n");
+    // A stray ACK doesn't start tracking
+    Connection stray;
+    CHECK(stray.client(CLIENT_ISN + 1, PacketView::TCP_ACK) == nullptr);
+    CHECK(stray.reassembler.getStats().flows == 0);
+}
+
+void testClose() {
+    Connection connection;
+    connection.handshake();
+    connection.send(0, std::string::npos);
+    connection.client(CLIENT_ISN + 1 + REQUEST.size(), PacketView::TCP_FIN | PacketView::TCP_ACK);
+    CHECK(connection.reassembler.getStats().active == 1);
+    connection.server(SERVER_ISN + 1, PacketView::TCP_FIN | PacketView::TCP_ACK);
+    CHECK(connection.reassembler.getStats().active == 0);
+    CHECK(connection.reassembler.getStats().closed == 1);
+    // The last ACK of a closed connection doesn't reopen it
+    CHECK(connection.client(CLIENT_ISN + 2 + REQUEST.size(), PacketView::TCP_ACK) == nullptr);
+
+    Connection reset;
+    reset.handshake();
+    reset.server(SERVER_ISN + 1, PacketView::TCP_RST);
+    CHECK(reset.reassembler.getStats().closed == 1);
+    CHECK(reset.reassembler.getStats().active == 0);
+}
+
+void testTimeout() {
+    Connection connection;
+    connection.handshake();
+    connection.send(0, 4);
+    connection.reassembler.expire(at(seconds(100)));
+    CHECK(connection.reassembler.getStats().active == 1);
+    connection.reassembler.expire(at(seconds(122)));
+    CHECK(connection.reassembler.getStats().active == 0);
+    CHECK(connection.reassembler.getStats().timed_out == 1);
+    CHECK(connection.reassembler.getStats().memory_used == 0);
+}
+
+void testTableFull() {
+    // More connections than slots: the least recently active go
+    Connection connection({4, 1024, 64 * 1024, seconds(120)});
+    for (uint16_t port = 0; port < 10; ++port) {
+        const Bytes frame = tcpFrame(CLIENT, 50000 + port, SERVER, SERVER_PORT, CLIENT_ISN, 0,
+                                     PacketView::TCP_SYN);
+        connection.reassembler.add(viewOf(frame, at(seconds(1))));
+    }
+    CHECK(connection.reassembler.getStats().flows == 10);
+    CHECK(connection.reassembler.getStats().evicted == 6);
+    CHECK(connection.reassembler.getStats().active == 4);
+}
+
+} // namespace
+
+int main() {
+    testInOrder();
+    testOutOfOrder();
+    testGapFilledFromEitherSide();
+    testOverlap();
+    testBeforeStart();
+    testSequenceWrap();
+    testTruncatedCapture();
+    testCutoff();
+    testTooManyGaps();
+    testAnalyzerDone();
+    testOutOfBuffers();
+    testMidstream();
+    testClose();
+    testTimeout();
+    testTableFull();
+    return testResult("StreamReassembler");
+}
@@ -0,0 +1,238 @@
+// TcpAnalyzer against crafted connections: the handshake round trip,
+// reordered and resent segments, duplicate ACKs, closed windows, sequence
+// numbers that wrap, and frames the capture cut short.
+
+#include "TestSupport.hpp"
+#include "analysis/TcpAnalyzer.hpp"
+
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using Side = TcpAnalyzer::Side;
+
+const uint32_t CLIENT = hostAddress(1);
+const uint32_t SERVER = hostAddress(2);
+constexpr uint16_t CLIENT_PORT = 40000;
+constexpr uint16_t SERVER_PORT = 80;
+constexpr uint32_t CLIENT_ISN = 1000;
+constexpr uint32_t SERVER_ISN = 5000;
+const microseconds START = std::chrono::seconds(1);
+
+// One connection fed packet by packet, the client on Side::FIRST
+class Connection {
+public:
+    explicit Connection(uint32_t client_isn = CLIENT_ISN) : client_isn_(client_isn) {}
+
+    void client(microseconds time, uint32_t sequence, uint8_t flags, const Bytes& payload = {},
+                uint16_t window = 65535) {
+        const Bytes frame = tcpFrame(CLIENT, CLIENT_PORT, SERVER, SERVER_PORT, sequence,
+                                     SERVER_ISN + 1, flags, payload, window);
+        analyzer.update(viewOf(frame, at(START + time)), Side::FIRST);
+    }
+
+    void server(microseconds time, uint32_t ack, uint8_t flags, uint16_t window = 65535) {
+        const Bytes frame = tcpFrame(SERVER, SERVER_PORT, CLIENT, CLIENT_PORT, SERVER_ISN + 1, ack,
+                                     flags, {}, window);
+        analyzer.update(viewOf(frame, at(START + time)), Side::SECOND);
+    }
+
+    // SYN, SYN/ACK 10 ms later and the ACK 5 ms after that
+    void handshake() {
+        const Bytes syn = tcpFrame(CLIENT, CLIENT_PORT, SERVER, SERVER_PORT, client_isn_, 0,
+                                   PacketView::TCP_SYN);
+        analyzer.update(viewOf(syn, at(START)), Side::FIRST);
+        const Bytes syn_ack = tcpFrame(SERVER, SERVER_PORT, CLIENT, CLIENT_PORT, SERVER_ISN, client_isn_ + 1,
+                                       PacketView::TCP_SYN | PacketView::TCP_ACK);
+        analyzer.update(viewOf(syn_ack, at(START + milliseconds(10))), Side::SECOND);
+        client(milliseconds(15), client_isn_ + 1, PacketView::TCP_ACK);
+    }
+
+    TcpAnalyzer analyzer;
+
+private:
+    uint32_t client_isn_;
+};
+
+Bytes payload(size_t length) {
+    return Bytes(length, 'x');
+}
+
+void testHandshake() {
+    Connection connection;
+    connection.handshake();
+    CHECK(connection.analyzer.getServerRtt() == milliseconds(10));
+    CHECK(connection.analyzer.getClientRtt() == milliseconds(5));
+    CHECK(connection.analyzer.getHandshakeRtt() == milliseconds(15));
+    // SYN and SYN/ACK take a sequence number each; the bare ACK doesn't
+    CHECK(connection.analyzer.getCounters().segments == 2);
+    CHECK(connection.analyzer.getCounters().retransmissions == 0);
+}
+
+void testNoHandshake() {
+    // Picked up midstream: no round trip, and the first segment only sets
+    // where the direction is
+    Connection connection;
+    connection.client(milliseconds(0), CLIENT_ISN + 1, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(1), CLIENT_ISN + 101, PacketView::TCP_ACK, payload(100));
+    CHECK(connection.analyzer.getHandshakeRtt() == microseconds::zero());
+    CHECK(connection.analyzer.getCounters(Side::FIRST).segments == 2);
+    CHECK(connection.analyzer.getCounters(Side::FIRST).retransmissions == 0);
+}
+
+void testOutOfOrder() {
+    // The segment after a gap arrives first, and the gap fills within a
+    // round trip
+    Connection connection;
+    connection.handshake();
+    const uint32_t data = CLIENT_ISN + 1;
+    connection.client(milliseconds(20), data, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(21), data + 200, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(22), data + 100, PacketView::TCP_ACK, payload(100));
+    const TcpAnalyzer::Counters counters = connection.analyzer.getCounters(Side::FIRST);
+    CHECK(counters.out_of_order == 1);
+    CHECK(counters.retransmissions == 0);
+}
+
+void testGapFilledLate() {
+    // Filling the gap after more than a round trip is a resend
+    Connection connection;
+    connection.handshake();
+    const uint32_t data = CLIENT_ISN + 1;
+    connection.client(milliseconds(20), data, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(21), data + 200, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(300), data + 100, PacketView::TCP_ACK, payload(100));
+    const TcpAnalyzer::Counters counters = connection.analyzer.getCounters(Side::FIRST);
+    CHECK(counters.out_of_order == 0);
+    CHECK(counters.retransmissions == 1);
+}
+
+void testGapFilledInPieces() {
+    // Two reordered segments fill one gap from both ends
+    Connection connection;
+    connection.handshake();
+    const uint32_t data = CLIENT_ISN + 1;
+    connection.client(milliseconds(20), data, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(21), data + 300, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(22), data + 200, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(23), data + 100, PacketView::TCP_ACK, payload(100));
+    // The gap is closed, so the same bytes again are a resend
+    connection.client(milliseconds(24), data + 100, PacketView::TCP_ACK, payload(100));
+    const TcpAnalyzer::Counters counters = connection.analyzer.getCounters(Side::FIRST);
+    CHECK(counters.out_of_order == 2);
+    CHECK(counters.retransmissions == 1);
+}
+
+void testRetransmissions() {
+    Connection connection;
+    connection.handshake();
+    const uint32_t data = CLIENT_ISN + 1;
+    connection.client(milliseconds(20), data, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(300), data, PacketView::TCP_ACK, payload(100));
+    // Overlapping the end of what was sent and carrying new bytes too
+    connection.client(milliseconds(301), data + 50, PacketView::TCP_ACK, payload(100));
+    const TcpAnalyzer::Counters counters = connection.analyzer.getCounters(Side::FIRST);
+    CHECK(counters.segments == 4);
+    CHECK(counters.retransmissions == 2);
+    CHECK(counters.getLossRate() == 0.5);
+}
+
+void testKeepAlive() {
+    // One byte from before next, sent on purpose, isn't a resend
+    Connection connection;
+    connection.handshake();
+    const uint32_t data = CLIENT_ISN + 1;
+    connection.client(milliseconds(20), data, PacketView::TCP_ACK, payload(100));
+    connection.client(milliseconds(5000), data + 99, PacketView::TCP_ACK, payload(1));
+    connection.client(milliseconds(9000), data + 99, PacketView::TCP_ACK);
+    CHECK(connection.analyzer.getCounters(Side::FIRST).retransmissions == 0);
+}
+
+void testDuplicateAcks() {
+    Connection connection;
+    connection.handshake();
+    const uint32_t ack = CLIENT_ISN + 101;
+    connection.server(milliseconds(20), ack, PacketView::TCP_ACK);
+    connection.server(milliseconds(21), ack, PacketView::TCP_ACK);
+    connection.server(milliseconds(22), ack, PacketView::TCP_ACK);
+    // A window update repeats the ACK but says something new
+    connection.server(milliseconds(23), ack, PacketView::TCP_ACK, 30000);
+    connection.server(milliseconds(24), ack + 100, PacketView::TCP_ACK, 30000);
+    CHECK(connection.analyzer.getCounters(Side::SECOND).duplicate_acks == 2);
+}
+
+void testZeroWindow() {
+    Connection connection;
+    connection.handshake();
+    const uint32_t ack = CLIENT_ISN + 1;
+    connection.server(milliseconds(20), ack, PacketView::TCP_ACK, 0);
+    connection.server(milliseconds(21), ack, PacketView::TCP_ACK, 0);
+    connection.server(milliseconds(22), ack, PacketView::TCP_ACK, 1000);
+    connection.server(milliseconds(23), ack, PacketView::TCP_ACK, 0);
+    CHECK(connection.analyzer.getCounters(Side::SECOND).zero_windows == 2);
+}
+
+void testSequenceWrap() {
+    // The client's data crosses 2^32 without looking like a resend
+    Connection connection(0xffffff00u);
+    connection.handshake();
+    const uint32_t data = 0xffffff01u;
+    for (uint32_t i = 0; i < 4; ++i) {
+        connection.client(milliseconds(20 + i), data + i * 100, PacketView::TCP_ACK, payload(100));
+    }
+    const TcpAnalyzer::Counters counters = connection.analyzer.getCounters(Side::FIRST);
+    CHECK(counters.segments == 5);
+    CHECK(counters.retransmissions == 0);
+    CHECK(counters.out_of_order == 0);
+}
+
+void testReset() {
+    // A RST takes no sequence space and its window is meaningless
+    Connection connection;
+    connection.handshake();
+    connection.server(milliseconds(20), CLIENT_ISN + 1, PacketView::TCP_RST | PacketView::TCP_ACK, 0);
+    CHECK(connection.analyzer.getCounters(Side::SECOND).segments == 1);
+    CHECK(connection.analyzer.getCounters(Side::SECOND).zero_windows == 0);
+}
+
+void testTruncated() {
+    // Frames cut short anywhere up to the end of the TCP header are read
+    // no further than they go
+    const Bytes frame = tcpFrame(CLIENT, CLIENT_PORT, SERVER, SERVER_PORT, CLIENT_ISN, 0,
+                                 PacketView::TCP_SYN);
+    for (size_t length = 0; length <= frame.size(); ++length) {
+        TcpAnalyzer analyzer;
+        analyzer.update(PacketView(frame.data(), length, frame.size(), at(START)), Side::FIRST);
+        CHECK(analyzer.getCounters().retransmissions == 0);
+    }
+}
+
+void testMerge() {
+    // Each worker saw one direction
+    Connection first;
+    Connection second;
+    first.handshake();
+    second.server(milliseconds(20), CLIENT_ISN + 1, PacketView::TCP_ACK, 0);
+    first.analyzer.merge(second.analyzer);
+    CHECK(first.analyzer.getHandshakeRtt() == milliseconds(15));
+    CHECK(first.analyzer.getCounters(Side::SECOND).zero_windows == 1);
+}
+
+} // namespace
+
+int main() {
+    testHandshake();
+    testNoHandshake();
+    testOutOfOrder();
+    testGapFilledLate();
+    testGapFilledInPieces();
+    testRetransmissions();
+    testKeepAlive();
+    testDuplicateAcks();
+    testZeroWindow();
+    testSequenceWrap();
+    testReset();
+    testTruncated();
+    testMerge();
+    return testResult("TcpAnalyzer");
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+// What the tests share: a CHECK that reports and counts failures instead
+// of stopping, and builders for the frames fed to the parsers. Frames are
+// Ethernet II with an IPv4 header of 20 bytes and no options.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "protocols/PacketView.hpp"
+
+using Bytes = std::vector<uint8_t>;
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++testFailures();                                                   \
+        }                                                                       \
+    } while (0)
+
+// Returns main()'s exit status
+inline int testResult(const char* name) {
+    if (testFailures() == 0) {
+        std::printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    std::printf("%s: %d checks failed\n", name, testFailures());
+    return 1;
+}
+
+inline Bytes bytesOf(const std::string& text) {
+    return Bytes(text.begin(), text.end());
+}
+
+inline void putU16(uint8_t* p, size_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+inline void putU32(uint8_t* p, uint32_t value) {
+    putU16(p, value >> 16);
+    putU16(p + 2, value & 0xffff);
+}
+
+constexpr size_t ETHERNET_LENGTH = 14;
+constexpr size_t IPV4_LENGTH = 20;
+
+// 10.0.0.host
+constexpr uint32_t hostAddress(uint8_t host) {
+    return 0x0a000000u | host;
+}
+
+// Ethernet and IPv4 headers in front of transport, with the IPv4 checksum
+// filled in. offset is in bytes and must be a multiple of 8 when more is set.
+inline Bytes ipv4Frame(uint32_t source, uint32_t destination, uint8_t protocol, const Bytes& transport,
+                       uint16_t id = 1, size_t offset = 0, bool more = false) {
+    Bytes frame(ETHERNET_LENGTH + IPV4_LENGTH + transport.size());
+    frame[12] = 0x08;
+    uint8_t* ip = frame.data() + ETHERNET_LENGTH;
+    ip[0] = 0x45;
+    putU16(ip + 2, IPV4_LENGTH + transport.size());
+    putU16(ip + 4, id);
+    putU16(ip + 6, offset / 8 | (more ? 0x2000 : 0));
+    ip[8] = 64;
+    ip[9] = protocol;
+    putU32(ip + 12, source);
+    putU32(ip + 16, destination);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < IPV4_LENGTH; i += 2) {
+        sum += static_cast<uint32_t>(ip[i] << 8 | ip[i + 1]);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    putU16(ip + 10, ~sum & 0xffff);
+    std::copy(transport.begin(), transport.end(), ip + IPV4_LENGTH);
+    return frame;
+}
+
+// UDP header and payload; the checksum is left 0, which IPv4 reads as none
+inline Bytes udpSegment(uint16_t source_port, uint16_t destination_port, const Bytes& payload) {
+    Bytes segment(8 + payload.size());
+    putU16(segment.data(), source_port);
+    putU16(segment.data() + 2, destination_port);
+    putU16(segment.data() + 4, segment.size());
+    std::copy(payload.begin(), payload.end(), segment.begin() + 8);
+    return segment;
+}
+
+inline Bytes tcpFrame(uint32_t source, uint16_t source_port, uint32_t destination, uint16_t destination_port,
+                      uint32_t sequence, uint32_t ack, uint8_t flags, const Bytes& payload = {},
+                      uint16_t window = 65535) {
+    Bytes segment(20 + payload.size());
+    putU16(segment.data(), source_port);
+    putU16(segment.data() + 2, destination_port);
+    putU32(segment.data() + 4, sequence);
+    putU32(segment.data() + 8, ack);
+    segment[12] = 0x50;
+    segment[13] = flags;
+    putU16(segment.data() + 14, window);
+    std::copy(payload.begin(), payload.end(), segment.begin() + 20);
+    return ipv4Frame(source, destination, 6, segment);
+}
+
+// Packet time; 0 reads as unset in places, so tests start later
+inline std::chrono::system_clock::time_point at(std::chrono::microseconds since) {
+    return std::chrono::system_clock::time_point(since);
+}
+
+inline PacketView viewOf(const Bytes& frame, std::chrono::system_clock::time_point time = {}) {
+    return PacketView(frame.data(), frame.size(), frame.size(), time);
+}
@@ -0,0 +1,196 @@
+// TlsClientHello against a ClientHello built field by field: whole,
+// truncated at every length, with lengths that overrun what encloses them,
+// and split over two records.
+
+#include "TestSupport.hpp"
+#include "protocols/TlsClientHello.hpp"
+
+namespace {
+
+using Result = TlsClientHello::Result;
+
+void append(Bytes& to, const Bytes& from) {
+    to.insert(to.end(), from.begin(), from.end());
+}
+
+// from with a length of bytes bytes in front
+Bytes prefixed(const Bytes& from, size_t bytes) {
+    Bytes result(bytes);
+    for (size_t i = 0; i < bytes; ++i) {
+        result[i] = static_cast<uint8_t>(from.size() >> (8 * (bytes - 1 - i)));
+    }
+    append(result, from);
+    return result;
+}
+
+Bytes extension(uint16_t type, const Bytes& body) {
+    Bytes result(2);
+    putU16(result.data(), type);
+    append(result, prefixed(body, 2));
+    return result;
+}
+
+Bytes serverNameExtension(const std::string& name) {
+    Bytes entry{0};     // host_name
+    append(entry, prefixed(bytesOf(name), 2));
+    return extension(0, prefixed(entry, 2));
+}
+
+Bytes alpnExtension(const std::string& protocol) {
+    return extension(16, prefixed(prefixed(bytesOf(protocol), 1), 2));
+}
+
+// A TLS 1.2 ClientHello in one handshake record
+Bytes clientHello(const Bytes& extensions) {
+    Bytes body{3, 3};               // client_version
+    body.resize(body.size() + 32, 0x42);    // random
+    body.push_back(0);              // session_id
+    append(body, prefixed({0x13, 0x01, 0xc0, 0x2f}, 2));    // cipher_suites
+    append(body, prefixed({0}, 1)); // compression_methods
+    append(body, prefixed(extensions, 2));
+
+    Bytes handshake{1};             // client_hello
+    append(handshake, prefixed(body, 3));
+    Bytes record{22, 3, 1};
+    append(record, prefixed(handshake, 2));
+    return record;
+}
+
+Bytes standardHello() {
+    Bytes extensions = extension(0xff01, {0});      // renegotiation_info, to be skipped
+    append(extensions, serverNameExtension("www.example.com"));
+    append(extensions, alpnExtension("h2"));
+    return clientHello(extensions);
+}
+
+void testComplete() {
+    const Bytes hello = standardHello();
+    TlsClientHello parser;
+    CHECK(parser.parse(hello) == Result::COMPLETE);
+    CHECK(parser.getServerName() == "www.example.com");
+    CHECK(parser.getAlpn() == "h2");
+    CHECK(parser.getRecordLength() == hello.size());
+
+    // Bytes after the record, such as early data, are left alone
+    Bytes longer = hello;
+    longer.resize(hello.size() + 100, 0xff);
+    CHECK(parser.parse(longer) == Result::COMPLETE);
+    CHECK(parser.getServerName() == "www.example.com");
+}
+
+void testWithoutExtensions() {
+    TlsClientHello parser;
+    CHECK(parser.parse(clientHello({})) == Result::COMPLETE);
+    CHECK(parser.getServerName().empty());
+    CHECK(parser.getAlpn().empty());
+}
+
+void testTruncated() {
+    // Every prefix of a good ClientHello is worth waiting on
+    const Bytes hello = standardHello();
+    for (size_t length = 0; length < hello.size(); ++length) {
+        TlsClientHello parser;
+        CHECK(parser.parse(std::span(hello.data(), length)) == Result::INCOMPLETE);
+    }
+}
+
+void testNotClientHello() {
+    Bytes hello = standardHello();
+    TlsClientHello parser;
+
+    Bytes other = hello;
+    other[0] = 23;      // application_data
+    CHECK(parser.parse(other) == Result::INVALID);
+    // Found from the first byte, before the rest has arrived
+    CHECK(parser.parse(std::span(other.data(), 1)) == Result::INVALID);
+
+    other = hello;
+    other[1] = 2;       // SSL 2 record version
+    CHECK(parser.parse(other) == Result::INVALID);
+
+    other = hello;
+    other[5] = 2;       // server_hello
+    CHECK(parser.parse(other) == Result::INVALID);
+
+    CHECK(parser.parse(bytesOf("GET / HTTP/1.1\r\n\r\n")) == Result::INVALID);
+}
+
+void testOverrun() {
+    const Bytes hello = standardHello();
+    TlsClientHello parser;
+
+    // Record longer than TLS allows
+    Bytes other = hello;
+    putU16(other.data() + 3, TlsClientHello::MAX_RECORD_LENGTH + 1);
+    CHECK(parser.parse(other) == Result::INVALID);
+
+    // Handshake message claiming more than its record holds
+    other = hello;
+    other[8] += 1;
+    CHECK(parser.parse(other) == Result::INVALID);
+
+    // Session id running past the message
+    other = hello;
+    other[9 + 2 + 32] = 0xff;
+    CHECK(parser.parse(other) == Result::INVALID);
+
+    // Extensions block claiming more than the message holds
+    other = hello;
+    const size_t extensions = 9 + 2 + 32 + 1 + 2 + 4 + 1 + 1;
+    putU16(other.data() + extensions, hello.size() - extensions);
+    CHECK(parser.parse(other) == Result::INVALID);
+}
+
+void testOverlappingExtensions() {
+    // An extension whose length reaches into the next one
+    Bytes extensions = extension(0xff01, {0});
+    append(extensions, serverNameExtension("www.example.com"));
+    Bytes hello = clientHello(extensions);
+    const size_t first = hello.size() - extensions.size();
+    putU16(hello.data() + first + 2, 10);
+    TlsClientHello parser;
+    CHECK(parser.parse(hello) == Result::INVALID);
+    CHECK(parser.getServerName().empty());
+
+    // A server name list longer than its extension spoils only the name
+    Bytes name = serverNameExtension("www.example.com");
+    putU16(name.data() + 4, 100);
+    append(name, alpnExtension("h2"));
+    hello = clientHello(name);
+    CHECK(parser.parse(hello) == Result::COMPLETE);
+    CHECK(parser.getServerName().empty());
+    CHECK(parser.getAlpn() == "h2");
+}
+
+void testUnprintableName() {
+    // Read to the end, but the name isn't reported
+    TlsClientHello parser;
+    CHECK(parser.parse(clientHello(serverNameExtension(std::string("bad\0name", 8)))) == Result::COMPLETE);
+    CHECK(parser.getServerName().empty());
+}
+
+void testSplitRecords() {
+    // The handshake message continues in a second record
+    const Bytes hello = standardHello();
+    const size_t first = 60;
+    Bytes split(hello.begin(), hello.begin() + first);
+    putU16(split.data() + 3, first - TlsClientHello::RECORD_HEADER_LENGTH);
+    append(split, {22, 3, 1});
+    append(split, prefixed(Bytes(hello.begin() + first, hello.end()), 2));
+    TlsClientHello parser;
+    CHECK(parser.parse(split) == Result::INVALID);
+}
+
+} // namespace
+
+int main() {
+    testComplete();
+    testWithoutExtensions();
+    testTruncated();
+    testNotClientHello();
+    testOverrun();
+    testOverlappingExtensions();
+    testUnprintableName();
+    testSplitRecords();
+    return testResult("TlsClientHello");
+}